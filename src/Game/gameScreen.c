@@ -134,6 +134,12 @@ static void clearFlavorText( void )
 #define LEVEL_MAX_SIZE ( LEVEL_MAX_WIDTH * LEVEL_MAX_HEIGHT )
 static Tile level[LEVEL_MAX_SIZE];
 
+// the tiles that have an image, built when the level is generated so the whole level can be drawn in one batch
+static int levelDrawImages[LEVEL_MAX_SIZE];
+static Vector2 levelDrawPositions[LEVEL_MAX_SIZE];
+static float levelDrawRotations[LEVEL_MAX_SIZE];
+static int levelDrawCount;
+
 static void centerGameCameraOnTile( int idx )
 {
 	// actual center of the view area is at <485,235> on the screen
@@ -1213,17 +1219,22 @@ static void createLevel( void )
 		}
 	}
 
+	levelDrawCount = 0;
+	for( int i = 0; i < LEVEL_MAX_SIZE; ++i ) {
+		if( level[i].image != -1 ) {
+			levelDrawImages[levelDrawCount] = level[i].image;
+			levelDrawPositions[levelDrawCount] = level[i].renderPos;
+			levelDrawRotations[levelDrawCount] = level[i].rotation;
+			++levelDrawCount;
+		}
+	}
+
 	centerGameCameraOnTile( LEVEL_TILE_IDX( playerX, playerY ) );
 }
 
 static void drawLevel( void )
 {
-	for( int i = 0; i < LEVEL_MAX_SIZE; ++i ) {
-		Tile* tile = &( level[i] );
-		if( tile->image != -1 ) {
-			img_Draw_r( tile->image, GAME_CAM_FLAGS, tile->renderPos, tile->renderPos, tile->rotation, tile->rotation, 0 );
-		}
-	}
+	img_DrawBatch_r( levelDrawImages, GAME_CAM_FLAGS, levelDrawPositions, NULL, levelDrawRotations, NULL, levelDrawCount, 0 );
 }
 
 static void drawWindow( Vector2 upperLeft, Vector2 lowerRight, Color clr, char depth )
@@ -1298,9 +1309,10 @@ static void drawWindow( Vector2 upperLeft, Vector2 lowerRight, Color clr, char d
 
 static int gameScreen_Enter( void )
 {
-	// render ui over game
+	// render ui over game, the game is only visible in the area the ui windows don't cover
 	cam_TurnOnFlags( 0, GAME_CAM_FLAGS );
 	cam_TurnOnFlags( 1, UI_CAM_FLAGS );
+	cam_SetViewport( 0, 170, 0, 630, 430 );
 
 	if( !mute ) {
 		playSong( "Music/game.it" );
@@ -1321,6 +1333,7 @@ static int gameScreen_Exit( void )
 {
 	cam_TurnOffFlags( 0, GAME_CAM_FLAGS );
 	cam_TurnOffFlags( 1, UI_CAM_FLAGS );
+	cam_ClearViewport( 0 );
 	
 	return 1;
 }
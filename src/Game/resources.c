@@ -1,39 +1,71 @@
 #include "resources.h"
 
 #include <SDL_log.h>
+#include <SDL_timer.h>
 
 #include "../UI/text.h"
 #include "../Graphics/imageSheets.h"
 #include "../Graphics/images.h"
 #include "../Graphics/shaderManager.h"
+#include "../Graphics/assetPack.h"
 
 #define LOAD_AND_TEST( file, func, id ) \
 	id = func( file ); if( id < 0 ) { \
 		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error loading resource file %s.", file ); }
 
+// created by the packAssets tool, anything not in it is loaded from the original files
+#define ASSET_PACK_FILE "assets.pak"
+
 #define LOAD_AND_TEST_IMG( file, shaderType, id ) \
-	id = img_Load( file, shaderType ); if( id < 0 ) { \
+	id = loadImage( file, shaderType ); if( id < 0 ) { \
 		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error loading resource file %s.", file ); }
 
 #define LOAD_AND_TEST_FNT( file, size, id ) \
-	id = txt_LoadFont( file, size ); if( id < 0 ) { \
+	id = txt_LoadFont( file, size, FONT_SDF ); if( id < 0 ) { \
 		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error loading resource file %s.", file ); }
 
 #define LOAD_AND_TEST_SS( file, ids ) \
-	{ ids = NULL; int ret = img_LoadSpriteSheet( file, ST_DEFAULT, &ids ); if( ret < 0 ) { \
+	{ ids = NULL; int ret = loadSpriteSheet( file, ST_DEFAULT, &ids ); if( ret < 0 ) { \
 		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error loading resource file %s.", file ); } }
 
+// images not in the asset pack are decoded in the background, they'll show a placeholder until they're ready
+static int loadImage( const char* fileName, ShaderType shaderType )
+{
+	if( assetPack_HasAsset( fileName ) ) {
+		return assetPack_LoadImage( fileName, shaderType );
+	}
+	return img_LoadAsync( fileName, shaderType );
+}
+
+static int loadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArray )
+{
+	if( assetPack_HasAsset( fileName ) ) {
+		return assetPack_LoadSpriteSheet( fileName, shaderType, imgOutArray );
+	}
+	return img_LoadSpriteSheetAsync( fileName, shaderType, imgOutArray );
+}
 
 void loadAllResources( void )
 {
 	txt_Init( );
 
+	assetPack_Open( ASSET_PACK_FILE );
+
 	mute = 0;
 
+	// everything the game displays is visible ASCII, get it ready up front, after the first run the glyphs are read
+	//  from the cache instead of being rasterized
+	for( int c = 0x20; c <= 0x7E; ++c ) {
+		txt_AddCharacterToLoad( c );
+	}
+
+	Uint64 fontStart = SDL_GetPerformanceCounter( );
 	LOAD_AND_TEST_FNT( "Fonts/kenpixel_blocks.ttf", 128.0f, fontLargeTitle );
 	LOAD_AND_TEST_FNT( "Fonts/kenpixel_blocks.ttf", 64.0f, fontSmallTitle );
 	LOAD_AND_TEST_FNT( "Fonts/kenpixel_mini_square.ttf", 32.0f, fontLargeText );
 	LOAD_AND_TEST_FNT( "Fonts/kenpixel_mini_square.ttf", 16.0f, fontSmallText );
+	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "Fonts loaded in %.2f ms",
+		(double)( SDL_GetPerformanceCounter( ) - fontStart ) * 1000.0 / (double)SDL_GetPerformanceFrequency( ) );
 	LOAD_AND_TEST_SS( "Images/window_border.ss", windowEdgeImages );
 	
 	LOAD_AND_TEST_IMG( "Images/floor.png", ST_DEFAULT, floorImage );
@@ -59,4 +91,6 @@ void loadAllResources( void )
 	LOAD_AND_TEST_IMG( "Images/brave.png", ST_DEFAULT, braveStatusImage );
 
 	LOAD_AND_TEST_IMG( "Images/highlight.png", ST_DEFAULT, highlightImage );
+
+	assetPack_Close( );
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "assetPack.h"
+
+#include <SDL_log.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "images.h"
+#include "gfxUtil.h"
+#include "../System/memory.h"
+#include "../System/mappedFile.h"
+
+static MappedFile packFile = { 0 };
+static const uint8_t* packData = NULL;
+static size_t packSize = 0;
+static const PackHeader* packHeader = NULL;
+static const PackEntry* packEntries = NULL;
+
+static void unmapFile( void )
+{
+	mappedFile_Close( &packFile );
+
+	packData = NULL;
+	packSize = 0;
+	packHeader = NULL;
+	packEntries = NULL;
+}
+
+static int mapFile( const char* fileName )
+{
+	if( mappedFile_Open( fileName, &packFile ) < 0 ) {
+		return -1;
+	}
+
+	packData = packFile.data;
+	packSize = packFile.size;
+	return 0;
+}
+
+/*
+Makes sure everything the entry points to is inside the file.
+*/
+static int entryIsValid( const PackEntry* entry )
+{
+	uint64_t pixelsSize = (uint64_t)entry->width * (uint64_t)entry->height * 4;
+	uint64_t spritesSize = (uint64_t)entry->numSprites * ( ( sizeof( Vector2 ) * 2 ) + sizeof( AlphaInfo ) );
+
+	if( ( entry->width == 0 ) || ( entry->height == 0 ) ||
+		( entry->pixelsOffset > packSize ) || ( pixelsSize > ( packSize - entry->pixelsOffset ) ) ) {
+		return 0;
+	}
+
+	if( entry->type == PET_SPRITE_SHEET ) {
+		if( ( entry->numSprites == 0 ) || ( entry->spritesOffset > packSize ) || ( spritesSize > ( packSize - entry->spritesOffset ) ) ) {
+			return 0;
+		}
+	} else if( entry->type != PET_IMAGE ) {
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+Opens and maps the asset pack, only one can be open at a time.
+ Returns < 0 if there's a problem.
+*/
+int assetPack_Open( const char* fileName )
+{
+	assetPack_Close( );
+
+	if( mapFile( fileName ) < 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "Unable to open asset pack %s", fileName );
+		return -1;
+	}
+
+	packHeader = (const PackHeader*)packData;
+	if( ( packSize < sizeof( PackHeader ) ) ||
+		( memcmp( packHeader->magic, ASSET_PACK_MAGIC, sizeof( packHeader->magic ) ) != 0 ) ||
+		( packHeader->version != ASSET_PACK_VERSION ) ||
+		( ( packSize - sizeof( PackHeader ) ) / sizeof( PackEntry ) < packHeader->numEntries ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "File %s is not a valid asset pack", fileName );
+		unmapFile( );
+		return -1;
+	}
+	packEntries = (const PackEntry*)( packHeader + 1 );
+
+	for( uint32_t i = 0; i < packHeader->numEntries; ++i ) {
+		if( !entryIsValid( &( packEntries[i] ) ) ) {
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Asset pack %s has an invalid entry for %.*s", fileName,
+				ASSET_PACK_NAME_LEN, packEntries[i].name );
+			unmapFile( );
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Unmaps the asset pack, anything created from it is unaffected.
+*/
+void assetPack_Close( void )
+{
+	unmapFile( );
+}
+
+static int compareEntryName( const void* key, const void* entry )
+{
+	return strncmp( (const char*)key, ( (const PackEntry*)entry )->name, ASSET_PACK_NAME_LEN );
+}
+
+static const PackEntry* findEntry( const char* name )
+{
+	if( packEntries == NULL ) {
+		return NULL;
+	}
+
+	return (const PackEntry*)bsearch( name, packEntries, packHeader->numEntries, sizeof( PackEntry ), compareEntryName );
+}
+
+/*
+Returns whether the open asset pack has something stored under the name.
+*/
+int assetPack_HasAsset( const char* name )
+{
+	return ( findEntry( name ) != NULL );
+}
+
+static int createTexture( const PackEntry* entry, Texture* outTexture )
+{
+	// the pixels are read straight out of the mapping
+	uint8_t* pixels = (uint8_t*)( packData + entry->pixelsOffset );
+
+	AlphaInfo alpha;
+	alpha.flags = (int)entry->textureFlags;
+	alpha.opaqueMin = entry->opaqueMin;
+	alpha.opaqueMax = entry->opaqueMax;
+
+	if( gfxUtil_UploadRGBATexture( pixels, (int)entry->width, (int)entry->height, &alpha, 0, outTexture ) < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to create texture for %s from asset pack", entry->name );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Creates an image from the image stored in the pack under the name.
+ Returns the id of the image on success, -1 on failure.
+*/
+int assetPack_LoadImage( const char* name, ShaderType shaderType )
+{
+	const PackEntry* entry = findEntry( name );
+	if( ( entry == NULL ) || ( entry->type != PET_IMAGE ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to find image %s in asset pack", name );
+		return -1;
+	}
+
+	Texture texture;
+	if( createTexture( entry, &texture ) < 0 ) {
+		return -1;
+	}
+
+	return img_CreateFromTexture( &texture, shaderType );
+}
+
+/*
+Creates the images from the sprite sheet stored in the pack under the name, works like img_LoadSpriteSheet( ).
+ Returns the number of images loaded if it was successful, otherwise returns -1.
+*/
+int assetPack_LoadSpriteSheet( const char* name, ShaderType shaderType, int** imgOutArray )
+{
+	const PackEntry* entry = findEntry( name );
+	if( ( entry == NULL ) || ( entry->type != PET_SPRITE_SHEET ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to find sprite sheet %s in asset pack", name );
+		return -1;
+	}
+
+	int numSprites = (int)entry->numSprites;
+	if( ( (*imgOutArray) = mem_Allocate( sizeof( int ) * numSprites ) ) == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate image IDs array for sprite sheet %s", name );
+		return -1;
+	}
+
+	Texture texture;
+	if( createTexture( entry, &texture ) < 0 ) {
+		mem_Release( *imgOutArray );
+		return -1;
+	}
+
+	Vector2* mins = (Vector2*)( packData + entry->spritesOffset );
+	Vector2* maxes = mins + numSprites;
+	const AlphaInfo* alphas = (const AlphaInfo*)( maxes + numSprites );
+	if( img_SplitTexture( &texture, alphas, numSprites, shaderType, mins, maxes, (*imgOutArray) ) < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Problem splitting image for sprite sheet %s", name );
+		mem_Release( *imgOutArray );
+		return -1;
+	}
+
+	return numSprites;
+}
\ No newline at end of file
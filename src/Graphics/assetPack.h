@@ -0,0 +1,81 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <stdint.h>
+#include "triRendering.h"
+
+/*
+A single file holding images and sprite sheets that have already been decoded, created by the packAssets tool. The
+ file is memory mapped and the textures are created straight from the mapping, so there's no decoding or parsing
+ and only one file to open.
+
+ Layout, everything is little endian:
+  PackHeader
+  PackEntry[numEntries], sorted by name
+  data for each entry, aligned to ASSET_PACK_ALIGNMENT
+   images: width * height RGBA pixels
+   sprite sheets: the RGBA pixels of the sheet, then numSprites Vector2 mins, then numSprites Vector2 maxes, then
+    numSprites AlphaInfos
+ The alpha of everything is scanned when packing, so loading never has to look at the pixels.
+*/
+
+#define ASSET_PACK_MAGIC "APAK"
+#define ASSET_PACK_VERSION 2
+#define ASSET_PACK_NAME_LEN 64
+#define ASSET_PACK_ALIGNMENT 16
+
+typedef enum {
+	PET_IMAGE,
+	PET_SPRITE_SHEET
+} PackEntryType;
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t numEntries;
+	uint32_t reserved;
+} PackHeader;
+
+typedef struct {
+	char name[ASSET_PACK_NAME_LEN]; // the file name the asset was packed from, what the game uses to load it
+	uint32_t type;
+	uint32_t width;
+	uint32_t height;
+	uint32_t textureFlags;
+	uint32_t numSprites;
+	uint32_t reserved;
+	Vector2 opaqueMin; // bounds of the visible pixels of the whole image
+	Vector2 opaqueMax;
+	uint64_t pixelsOffset; // from the start of the file
+	uint64_t spritesOffset;
+} PackEntry;
+
+/*
+Opens and maps the asset pack, only one can be open at a time.
+ Returns < 0 if there's a problem.
+*/
+int assetPack_Open( const char* fileName );
+
+/*
+Unmaps the asset pack, anything created from it is unaffected.
+*/
+void assetPack_Close( void );
+
+/*
+Returns whether the open asset pack has something stored under the name.
+*/
+int assetPack_HasAsset( const char* name );
+
+/*
+Creates an image from the image stored in the pack under the name.
+ Returns the id of the image on success, -1 on failure.
+*/
+int assetPack_LoadImage( const char* name, ShaderType shaderType );
+
+/*
+Creates the images from the sprite sheet stored in the pack under the name, works like img_LoadSpriteSheet( ).
+ Returns the number of images loaded if it was successful, otherwise returns -1.
+*/
+int assetPack_LoadSpriteSheet( const char* name, ShaderType shaderType, int** imgOutArray );
+
+#endif /* inclusion guard */
\ No newline at end of file
@@ -7,14 +7,21 @@ typedef struct {
 	Vector2 pos;
 } CameraState;
 
+typedef struct {
+	int x;
+	int y;
+	int width;
+	int height;
+} Viewport;
+
 typedef struct {
 	CameraState start;
 	CameraState end;
 	unsigned int renderFlags;
 	Matrix4 projectionMat;
+	Viewport viewport;
 } Camera;
 
-#define NUM_CAMERAS 16
 static Camera cameras[NUM_CAMERAS];
 
 static float currentTime;
@@ -22,6 +29,9 @@ static float endTime;
 
 static int currCamera;
 
+static int windowWidth;
+static int windowHeight;
+
 /*
 Initialize all the cameras, set them to the identity.
 */
@@ -30,19 +40,84 @@ void cam_Init( void )
 	memset( cameras, 0, sizeof( cameras ) );
 }
 
+static void createProjectionMatrix( Camera* camera )
+{
+	// the viewport acts as a window into the full screen, so what's drawn in it doesn't move when it's resized
+	float left = (float)camera->viewport.x;
+	float top = (float)camera->viewport.y;
+	mat4_CreateOrthographicProjection( left, left + (float)camera->viewport.width, top, top + (float)camera->viewport.height,
+		-1000.0f, 1000.0f, &( camera->projectionMat ) );
+}
+
 /*
-Creates the base projection matrices for all the cameras.
+Creates the base projection matrices for all the cameras. The width and height are the size of the area being
+ rendered into, which is the internal render resolution and not necessarily the size of the window.
 */
-void cam_SetProjectionMatrices( SDL_Window* window )
+void cam_SetProjectionMatrices( int width, int height )
 {
-	Matrix4 proj;
-	int width, height;
-	SDL_GetWindowSize( window, &width, &height );
-	mat4_CreateOrthographicProjection( 0.0f, (float)width, 0.0f, (float)height, -1000.0f, 1000.0f, &proj );
+	windowWidth = width;
+	windowHeight = height;
 
 	for( int i = 0; i < NUM_CAMERAS; ++i ) {
-		cameras[i].projectionMat = proj;
+		cam_ClearViewport( i );
+	}
+}
+
+/*
+Sets the area of the window the camera will render to, in pixels with the origin at the upper left of the window.
+ Anything outside of it won't be drawn or cleared by this camera.
+ Returns <0 if there's a problem.
+*/
+int cam_SetViewport( int camera, int x, int y, int width, int height )
+{
+	assert( camera < NUM_CAMERAS );
+
+	if( ( width <= 0 ) || ( height <= 0 ) ) {
+		return -1;
 	}
+
+	cameras[camera].viewport.x = x;
+	cameras[camera].viewport.y = y;
+	cameras[camera].viewport.width = width;
+	cameras[camera].viewport.height = height;
+	createProjectionMatrix( &( cameras[camera] ) );
+
+	return 0;
+}
+
+/*
+Sets the camera to render to the entire window.
+ Returns <0 if there's a problem.
+*/
+int cam_ClearViewport( int camera )
+{
+	return cam_SetViewport( camera, 0, 0, windowWidth, windowHeight );
+}
+
+/*
+Gets the area of the window the camera renders to, converted so it can be passed directly into glViewport and glScissor.
+ Returns <0 if there's a problem.
+*/
+int cam_GetGLViewport( int camera, int* outX, int* outY, int* outWidth, int* outHeight )
+{
+	assert( camera < NUM_CAMERAS );
+
+	// OpenGL has the origin at the bottom left
+	(*outX) = cameras[camera].viewport.x;
+	(*outY) = windowHeight - ( cameras[camera].viewport.y + cameras[camera].viewport.height );
+	(*outWidth) = cameras[camera].viewport.width;
+	(*outHeight) = cameras[camera].viewport.height;
+
+	return 0;
+}
+
+/*
+Gets the size of the entire window the cameras are rendering into.
+*/
+void cam_GetWindowSize( int* outWidth, int* outHeight )
+{
+	(*outWidth) = windowWidth;
+	(*outHeight) = windowHeight;
 }
 
 /*
@@ -124,6 +199,28 @@ int cam_GetInverseViewMatrix( int camera, Matrix4* out )
 	return 0;
 }
 
+/*
+Gets the world space rectangle the camera can currently see.
+ Returns <0 if there's a problem.
+*/
+int cam_GetViewRect( int camera, Vector2* outMin, Vector2* outMax )
+{
+	assert( camera < NUM_CAMERAS );
+	assert( outMin != NULL );
+	assert( outMax != NULL );
+
+	Vector2 pos;
+	float t = clamp( 0.0f, 1.0f, ( currentTime / endTime ) );
+	vec2_Lerp( &( cameras[camera].start.pos ), &( cameras[camera].end.pos ), t, &pos );
+
+	outMin->x = pos.x + (float)cameras[camera].viewport.x;
+	outMin->y = pos.y + (float)cameras[camera].viewport.y;
+	outMax->x = outMin->x + (float)cameras[camera].viewport.width;
+	outMax->y = outMin->y + (float)cameras[camera].viewport.height;
+
+	return 0;
+}
+
 /*
 Turns on render flags for the camera.
  Returns <0 if there's a problem.
@@ -193,4 +290,31 @@ int cam_GetNextActiveCam( void )
 
 	currCamera = nextCamera;
 	return currCamera;
+}
+
+/*
+Stores the current state of all the active cameras, in the order they should be drawn. The out array should be
+ able to hold NUM_CAMERAS snapshots.
+ Returns the number of snapshots stored.
+*/
+int cam_TakeSnapshots( CameraSnapshot* outSnapshots )
+{
+	assert( outSnapshots != NULL );
+
+	int numSnapshots = 0;
+	for( int i = 0; i < NUM_CAMERAS; ++i ) {
+		if( cameras[i].renderFlags == 0 ) {
+			continue;
+		}
+
+		CameraSnapshot* snapshot = &( outSnapshots[numSnapshots] );
+		snapshot->id = i;
+		snapshot->flags = cameras[i].renderFlags;
+		cam_GetViewRect( i, &( snapshot->viewMin ), &( snapshot->viewMax ) );
+		cam_GetVPMatrix( i, &( snapshot->vpMat ) );
+		cam_GetGLViewport( i, &( snapshot->viewport[0] ), &( snapshot->viewport[1] ), &( snapshot->viewport[2] ), &( snapshot->viewport[3] ) );
+		++numSnapshots;
+	}
+
+	return numSnapshots;
 }
\ No newline at end of file
@@ -6,15 +6,52 @@
 #include "../Math/vector2.h"
 #include "../Math/matrix4.h"
 
+#define NUM_CAMERAS 16
+
+// the state of a camera at the time a frame was submitted, lets the renderers work without touching the cameras
+typedef struct {
+	int id;
+	unsigned int flags;
+	Vector2 viewMin;
+	Vector2 viewMax;
+	Matrix4 vpMat;
+	int viewport[4]; // already converted for glViewport and glScissor
+} CameraSnapshot;
+
 /*
 Initialize all the cameras, set them to the identity.
 */
 void cam_Init( void );
 
 /*
-Creates the base projection matrices for all the cameras.
+Creates the base projection matrices for all the cameras. The width and height are the size of the area being
+ rendered into, which is the internal render resolution and not necessarily the size of the window.
+*/
+void cam_SetProjectionMatrices( int width, int height );
+
+/*
+Sets the area of the window the camera will render to, in pixels with the origin at the upper left of the window.
+ Anything outside of it won't be drawn or cleared by this camera.
+ Returns <0 if there's a problem.
+*/
+int cam_SetViewport( int camera, int x, int y, int width, int height );
+
+/*
+Sets the camera to render to the entire window.
+ Returns <0 if there's a problem.
 */
-void cam_SetProjectionMatrices( SDL_Window* window );
+int cam_ClearViewport( int camera );
+
+/*
+Gets the area of the window the camera renders to, converted so it can be passed directly into glViewport and glScissor.
+ Returns <0 if there's a problem.
+*/
+int cam_GetGLViewport( int camera, int* outX, int* outY, int* outWidth, int* outHeight );
+
+/*
+Gets the size of the entire window the cameras are rendering into.
+*/
+void cam_GetWindowSize( int* outWidth, int* outHeight );
 
 /*
 Set the state the camera will be at at the end of the next frame.
@@ -50,6 +87,12 @@ Gets the view matrix for the specified camera.
 */
 int cam_GetInverseViewMatrix( int camera, Matrix4* out );
 
+/*
+Gets the world space rectangle the camera can currently see.
+ Returns <0 if there's a problem.
+*/
+int cam_GetViewRect( int camera, Vector2* outMin, Vector2* outMax );
+
 /*
 Turns on render flags for the camera.
  Returns <0 if there's a problem.
@@ -81,4 +124,11 @@ Gets the next active camera. A camera is active if it has any flags on.
 */
 int cam_GetNextActiveCam( void );
 
+/*
+Stores the current state of all the active cameras, in the order they should be drawn. The out array should be
+ able to hold NUM_CAMERAS snapshots.
+ Returns the number of snapshots stored.
+*/
+int cam_TakeSnapshots( CameraSnapshot* outSnapshots );
+
 #endif /* inclusion guard */
\ No newline at end of file
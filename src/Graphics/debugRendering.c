@@ -5,6 +5,7 @@
 #include <SDL_opengl.h>
 #include <SDL_log.h>
 #include <math.h>
+#include <string.h>
 
 #include "../Math/matrix4.h"
 #include "color.h"
@@ -32,6 +33,10 @@ typedef struct {
 static DebugVertex debugBuffer[MAX_VERTS];
 static int lastDebugVert;
 
+// copy of the debug buffer the render thread draws from, so more can be queued up while it's drawing
+static DebugVertex renderBuffer[MAX_VERTS];
+static int lastRenderVert;
+
 static GLuint debugIndicesBuffer[MAX_VERTS];
 static int lastDebugIndex;
 
@@ -121,6 +126,7 @@ int debugRenderer_Init( void )
 	}
 
 	lastDebugVert = -1;
+	lastRenderVert = -1;
 
 	return 0;
 }
@@ -205,13 +211,23 @@ int debugRenderer_Circle( unsigned int camFlags, Vector2 center, float radius, C
 }
 
 /*
-Draw all the debug lines.
+Copies all the queued debug lines so they'll be drawn by the next call to debugRenderer_Render.
+ Only call this when nothing is rendering.
 */
-void debugRenderer_Render( void )
+void debugRenderer_SubmitFrame( void )
 {
-	Matrix4 vpMat;
+	lastRenderVert = lastDebugVert;
+	if( lastRenderVert >= 0 ) {
+		memcpy( renderBuffer, debugBuffer, sizeof( DebugVertex ) * ( lastRenderVert + 1 ) );
+	}
+}
 
-	if( lastDebugVert >= 0 ) {
+/*
+Draw all the submitted debug lines, as seen by the cameras passed in.
+*/
+void debugRenderer_Render( CameraSnapshot* cameras, int numCameras )
+{
+	if( lastRenderVert >= 0 ) {
 		GL( glDisable( GL_DEPTH_TEST ) );
 		GL( glDepthMask( GL_FALSE ) );
 		GL( glDisable( GL_BLEND ) );
@@ -225,17 +241,21 @@ void debugRenderer_Render( void )
 		// so we shouldn't have to do this, but we do
 		// or i don't understand OpenGL as well as i think i do (most likely)
 		GL( glBindBuffer( GL_ARRAY_BUFFER, debugVBO ) );
-		GL( glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( DebugVertex ) * ( lastDebugVert + 1 ), debugBuffer ) );
+		GL( glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( DebugVertex ) * ( lastRenderVert + 1 ), renderBuffer ) );
+
+		GL( glEnable( GL_SCISSOR_TEST ) );
+		for( int c = 0; c < numCameras; ++c ) {
+			unsigned int camFlags = cameras[c].flags;
 
-		for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
-			unsigned int camFlags = cam_GetFlags( currCamera );
-			cam_GetVPMatrix( currCamera, &vpMat );
-			GL( glUniformMatrix4fv( debugShaderProgram.uniformLocs[0], 1, GL_FALSE, &( vpMat.m[0] ) ) );
+			int* viewport = cameras[c].viewport;
+			GL( glViewport( viewport[0], viewport[1], viewport[2], viewport[3] ) );
+			GL( glScissor( viewport[0], viewport[1], viewport[2], viewport[3] ) );
+			GL( glUniformMatrix4fv( debugShaderProgram.uniformLocs[0], 1, GL_FALSE, &( cameras[c].vpMat.m[0] ) ) );
 
 			// build the index array and render use it
 			int lastDebugIndex = -1;
-			for( int i = 0; i <= lastDebugVert; ++i ) {
-				if( ( debugBuffer[i].camFlags & camFlags ) != 0 ) {
+			for( int i = 0; i <= lastRenderVert; ++i ) {
+				if( ( renderBuffer[i].camFlags & camFlags ) != 0 ) {
 					++lastDebugIndex;
 					debugIndicesBuffer[lastDebugIndex] = i;
 				}
@@ -244,6 +264,7 @@ void debugRenderer_Render( void )
 			GL( glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, sizeof( GLuint ) * ( lastDebugIndex + 1 ), debugIndicesBuffer ) );
 			GL( glDrawElements( GL_LINES, lastDebugIndex + 1, GL_UNSIGNED_INT, NULL ) );
 		}
+		GL( glDisable( GL_SCISSOR_TEST ) );
 
 		GL( glBindVertexArray( 0 ) );
 		GL( glUseProgram( 0 ) );
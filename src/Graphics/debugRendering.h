@@ -3,6 +3,7 @@
 
 #include "../Math/vector2.h"
 #include "color.h"
+#include "camera.h"
 
 int debugRenderer_Init( void );
 
@@ -20,8 +21,14 @@ int debugRenderer_Line( unsigned int camFlags, Vector2 pOne, Vector2 pTwo, Color
 int debugRenderer_Circle( unsigned int camFlags, Vector2 center, float radius, Color color );
 
 /*
-Draw all the debug lines.
+Copies all the queued debug lines so they'll be drawn by the next call to debugRenderer_Render.
+ Only call this when nothing is rendering.
 */
-void debugRenderer_Render( void );
+void debugRenderer_SubmitFrame( void );
+
+/*
+Draw all the submitted debug lines, as seen by the cameras passed in.
+*/
+void debugRenderer_Render( CameraSnapshot* cameras, int numCameras );
 
 #endif /* inclusion guard */
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <SDL_log.h>
 #include <SDL_endian.h>
+#include <assert.h>
+#include <string.h>
 
 
 // gets sbt_image.h to use our custom memory allocation
@@ -20,12 +22,21 @@
 #include <stb_rect_pack.h>
 
 #include "glDebugging.h"
+#include "textureManager.h"
+
+// x64 always has SSE2, for x86 it depends on what the compiler is targeting
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+	#define USE_SSE2
+	#include <emmintrin.h>
+#endif
 
 typedef struct {
 	unsigned char* data;
 	int width, height, reqComp, comp;
 } LoadedImage;
 
+static int getSurfaceAlphaFlags( SDL_Surface* surface );
+
 /*
 Converts the LoadedImage into a texture, putting everything in outTexture. All LoadedImages are assumed to be in RGBA format.
  Returns >= 0 if everything went fine, < 0 if something went wrong.
@@ -52,17 +63,212 @@ int createTextureFromLoadedImage( GLenum texFormat, LoadedImage* image, Texture*
 
 	GL( glTexImage2D( GL_TEXTURE_2D, 0, texFormat, image->width, image->height, 0, texFormat, GL_UNSIGNED_BYTE, image->data ) );
 
+	texMgr_Register( outTexture->textureID, image->width, image->height, image->reqComp );
+
+	AlphaInfo alpha;
+	gfxUtil_ClassifyAlpha( image->data, image->width, image->height, image->reqComp, &alpha );
+
 	outTexture->width = image->width;
 	outTexture->height = image->height;
-	outTexture->flags = 0;
+	outTexture->flags = alpha.flags;
+	outTexture->opaqueMin = alpha.opaqueMin;
+	outTexture->opaqueMax = alpha.opaqueMax;
+
+	return 0;
+}
+
+#ifdef USE_SSE2
+// index of the lowest and highest set bit for each four bit mask
+static const int lowestBit[16] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+static const int highestBit[16] = { 0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+#endif
+
+/*
+Scans the alpha of the pixels in the rectangle, the alpha is assumed to be the last component. Finds the
+ TF_IS_TRANSPARENT and TF_HAS_CLEAR_PIXELS flags and the bounding box of the pixels that aren't fully clear, relative
+ to the corner of the rectangle. The rectangle is clipped to the image. Doesn't use OpenGL so it's safe to call from any thread.
+*/
+void gfxUtil_ClassifyAlphaRect( const uint8_t* data, int width, int height, int components,
+	int rectX, int rectY, int rectWidth, int rectHeight, AlphaInfo* outAlpha )
+{
+	assert( data != NULL );
+	assert( outAlpha != NULL );
+
+	int startX = SDL_max( rectX, 0 );
+	int startY = SDL_max( rectY, 0 );
+	int endX = SDL_min( rectX + rectWidth, width );
+	int endY = SDL_min( rectY + rectHeight, height );
+
+	int hasClear = 0;
+	int hasPartial = 0;
+	int minX = endX;
+	int minY = endY;
+	int maxX = -1;
+	int maxY = -1;
+
+	for( int y = startY; y < endY; ++y ) {
+		const uint8_t* row = data + ( ( (size_t)y * (size_t)width ) * (size_t)components );
+		int rowMin = endX;
+		int rowMax = -1;
+		int x = startX;
+
+#ifdef USE_SSE2
+		if( components == 4 ) {
+			// four pixels at a time, shifting the alpha down to the bottom of each lane
+			const __m128i clear = _mm_setzero_si128( );
+			const __m128i solid = _mm_set1_epi32( 0xFF );
+			for( ; x + 4 <= endX; x += 4 ) {
+				__m128i alpha = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*)( row + ( x * 4 ) ) ), 24 );
+				int clearBits = _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( alpha, clear ) ) );
+				int solidBits = _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( alpha, solid ) ) );
+
+				hasClear |= ( clearBits != 0 );
+				hasPartial |= ( ( clearBits | solidBits ) != 0xF );
+
+				int visibleBits = ( ~clearBits & 0xF );
+				if( visibleBits != 0 ) {
+					if( rowMax < 0 ) {
+						rowMin = x + lowestBit[visibleBits];
+					}
+					rowMax = x + highestBit[visibleBits];
+				}
+			}
+		}
+#endif
+
+		for( ; x < endX; ++x ) {
+			uint8_t alpha = row[( x * components ) + ( components - 1 )];
+			if( alpha == 0x00 ) {
+				hasClear = 1;
+			} else {
+				if( alpha < 0xFF ) {
+					hasPartial = 1;
+				}
+				if( rowMax < 0 ) {
+					rowMin = x;
+				}
+				rowMax = x;
+			}
+		}
 
-	// check to see if there are any translucent pixels in the image
-	for( int i = 3; ( i < ( image->width * image->height ) ) && !( outTexture->flags & TF_IS_TRANSPARENT ); i += 4 ) {
-		if( ( image->data[i] > 0x00 ) && ( image->data[i] < 0xFF ) ) {
-			outTexture->flags |= TF_IS_TRANSPARENT;
+		if( rowMax >= 0 ) {
+			minX = SDL_min( minX, rowMin );
+			maxX = SDL_max( maxX, rowMax );
+			if( maxY < 0 ) {
+				minY = y;
+			}
+			maxY = y;
 		}
 	}
 
+	outAlpha->flags = 0;
+	if( hasClear ) {
+		outAlpha->flags |= TF_HAS_CLEAR_PIXELS;
+	}
+	if( hasPartial ) {
+		outAlpha->flags |= TF_IS_TRANSPARENT;
+	}
+
+	if( maxX < 0 ) {
+		outAlpha->opaqueMin = VEC2_ZERO;
+		outAlpha->opaqueMax = VEC2_ZERO;
+	} else {
+		outAlpha->opaqueMin.x = (float)( minX - rectX );
+		outAlpha->opaqueMin.y = (float)( minY - rectY );
+		outAlpha->opaqueMax.x = (float)( maxX + 1 - rectX );
+		outAlpha->opaqueMax.y = (float)( maxY + 1 - rectY );
+	}
+}
+
+/*
+Scans the alpha of all the pixels in the image, see gfxUtil_ClassifyAlphaRect( ).
+*/
+void gfxUtil_ClassifyAlpha( const uint8_t* data, int width, int height, int components, AlphaInfo* outAlpha )
+{
+	gfxUtil_ClassifyAlphaRect( data, width, height, components, 0, 0, width, height, outAlpha );
+}
+
+/*
+Loads the image at the file name and decodes it into RGBA pixel data. Doesn't use OpenGL so it's safe to call from any
+ thread. The data must be released with gfxUtil_ReleaseDecodedImage( ).
+ Returns >= 0 on success, < 0 on failure.
+*/
+int gfxUtil_DecodeImageFile( const char* fileName, uint8_t** outData, int* outWidth, int* outHeight )
+{
+	int comp;
+
+	(*outData) = stbi_load( fileName, outWidth, outHeight, &comp, 4 );
+	if( (*outData) == NULL ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to load image %s! STB Error: %s", fileName, stbi_failure_reason( ) );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Frees the pixel data created by gfxUtil_DecodeImageFile( ).
+*/
+void gfxUtil_ReleaseDecodedImage( uint8_t* data )
+{
+	stbi_image_free( data );
+}
+
+/*
+Turns RGBA pixel data into a texture, alpha is what gfxUtil_ClassifyAlpha( ) already found for the data. If pixelBuffer
+ isn't 0 the data is copied into it and the texture is created from there, letting the driver transfer it without stalling.
+ Returns >= 0 on success, < 0 on failure.
+*/
+int gfxUtil_UploadRGBATexture( uint8_t* data, int width, int height, const AlphaInfo* alpha, GLuint pixelBuffer, Texture* outTexture )
+{
+	assert( data != NULL );
+	assert( alpha != NULL );
+	assert( outTexture != NULL );
+
+	GL( glGenTextures( 1, &( outTexture->textureID ) ) );
+
+	if( outTexture->textureID == 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to create texture object." );
+		return -1;
+	}
+
+	GL( glBindTexture( GL_TEXTURE_2D, outTexture->textureID ) );
+
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST ) );
+
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
+
+	void* mapped = NULL;
+	size_t dataSize = (size_t)width * (size_t)height * 4;
+	if( pixelBuffer != 0 ) {
+		// orphan the old storage so we don't have to wait for the last upload to finish
+		GL( glBindBuffer( GL_PIXEL_UNPACK_BUFFER, pixelBuffer ) );
+		GL( glBufferData( GL_PIXEL_UNPACK_BUFFER, dataSize, NULL, GL_STREAM_DRAW ) );
+		mapped = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, dataSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+		if( mapped == NULL ) {
+			GL( glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 ) );
+		}
+	}
+
+	if( mapped != NULL ) {
+		memcpy( mapped, data, dataSize );
+		GL( glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER ) );
+		GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL ) );
+		GL( glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 ) );
+	} else {
+		GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data ) );
+	}
+
+	texMgr_Register( outTexture->textureID, width, height, 4 );
+
+	outTexture->width = width;
+	outTexture->height = height;
+	outTexture->flags = alpha->flags;
+	outTexture->opaqueMin = alpha->opaqueMin;
+	outTexture->opaqueMax = alpha->opaqueMax;
+
 	return 0;
 }
 
@@ -94,6 +300,9 @@ int gfxUtil_LoadTexture( const char* fileName, Texture* outTexture )
 		goto clean_up;
 	}
 
+	// it can be loaded again if it's evicted
+	texMgr_SetSourceFile( outTexture->textureID, fileName );
+
 clean_up:
 	//SDL_FreeSurface( loadSurface );
 	stbi_image_free( image.data );
@@ -136,14 +345,16 @@ int gfxUtil_CreateTextureFromSurface( SDL_Surface* surface, Texture* outTexture
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
 	glTexImage2D( GL_TEXTURE_2D, 0, texFormat, surface->w, surface->h, 0, texFormat, GL_UNSIGNED_BYTE, surface->pixels );
+	texMgr_Register( outTexture->textureID, surface->w, surface->h, surface->format->BytesPerPixel );
 
 	outTexture->width = surface->w;
 	outTexture->height = surface->h;
-	outTexture->flags = 0;
 	// the reason this isn't using the createTextureFromLoadedImage is this primarily
-	if( gfxUtil_SurfaceIsTranslucent( surface ) ) {
-		outTexture->flags |= TF_IS_TRANSPARENT;
-	}
+	outTexture->flags = getSurfaceAlphaFlags( surface );
+	// surfaces aren't scanned for the bounds, treat the whole thing as visible
+	outTexture->opaqueMin = VEC2_ZERO;
+	outTexture->opaqueMax.x = (float)surface->w;
+	outTexture->opaqueMax.y = (float)surface->h;
 
 	return 0;
 }
@@ -217,17 +428,20 @@ Unloads the passed in texture. After doing this the texture will be invalid and
 */
 void gfxUtil_UnloadTexture( Texture* texture )
 {
+	texMgr_Unregister( texture->textureID );
 	glDeleteTextures( 1, &( texture->textureID ) );
 	texture->textureID = 0;
 	texture->flags = 0;
 }
 
 /*
-Returns whether the SDL_Surface has any pixels that have a transparency that aren't completely clear or solid.
+Gets the TF_IS_TRANSPARENT and TF_HAS_CLEAR_PIXELS flags for the SDL_Surface.
 */
-int gfxUtil_SurfaceIsTranslucent( SDL_Surface* surface )
+static int getSurfaceAlphaFlags( SDL_Surface* surface )
 {
 	Uint8 r, g, b, a;
+	int flags = 0;
+	int alphaCheck = TF_IS_TRANSPARENT | TF_HAS_CLEAR_PIXELS;
 	int bpp = surface->format->BytesPerPixel;
 
 	for( int y = 0; y < surface->h; ++y ) {
@@ -251,11 +465,25 @@ int gfxUtil_SurfaceIsTranslucent( SDL_Surface* surface )
 				break;
 			}
 			SDL_GetRGBA( pixel, surface->format, &r, &g, &b, &a );
-			if( ( a > 0x00 ) && ( a < 0xFF ) ) {
-				return 1;
+			if( a == 0x00 ) {
+				flags |= TF_HAS_CLEAR_PIXELS;
+			} else if( a < 0xFF ) {
+				flags |= TF_IS_TRANSPARENT;
+			}
+
+			if( ( flags & alphaCheck ) == alphaCheck ) {
+				return flags;
 			}
 		}
 	}
 
-	return 0;
+	return flags;
+}
+
+/*
+Returns whether the SDL_Surface has any pixels that have a transparency that aren't completely clear or solid.
+*/
+int gfxUtil_SurfaceIsTranslucent( SDL_Surface* surface )
+{
+	return ( getSurfaceAlphaFlags( surface ) & TF_IS_TRANSPARENT ) != 0;
 }
\ No newline at end of file
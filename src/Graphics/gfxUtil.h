@@ -7,14 +7,25 @@
 
 // some basic texture handling things.
 enum TextureFlags {
-	TF_IS_TRANSPARENT = 0x1
+	TF_IS_TRANSPARENT = 0x1, // has pixels that are neither fully clear or fully solid
+	TF_HAS_CLEAR_PIXELS = 0x2 // has pixels that are fully clear, needs to be alpha tested if not blended
 };
 
+// what was found when scanning the alpha of some pixels
+typedef struct {
+	int flags; // TextureFlags
+	// bounding box of the pixels that aren't fully clear, in pixels, min and max are equal if every pixel is clear
+	Vector2 opaqueMin;
+	Vector2 opaqueMax;
+} AlphaInfo;
+
 typedef struct {
 	GLuint textureID;
 	int width;
 	int height;
 	int flags;
+	Vector2 opaqueMin;
+	Vector2 opaqueMax;
 } Texture;
 
 typedef struct {
@@ -29,6 +40,38 @@ Loads the image at the file name. Takes in a pointer to a Texture structure that
 */
 int gfxUtil_LoadTexture( const char* fileName, Texture* outTexture );
 
+/*
+Loads the image at the file name and decodes it into RGBA pixel data. Doesn't use OpenGL so it's safe to call from any
+ thread. The data must be released with gfxUtil_ReleaseDecodedImage( ).
+ Returns >= 0 on success, < 0 on failure.
+*/
+int gfxUtil_DecodeImageFile( const char* fileName, uint8_t** outData, int* outWidth, int* outHeight );
+
+/*
+Frees the pixel data created by gfxUtil_DecodeImageFile( ).
+*/
+void gfxUtil_ReleaseDecodedImage( uint8_t* data );
+
+/*
+Turns RGBA pixel data into a texture, alpha is what gfxUtil_ClassifyAlpha( ) already found for the data. If pixelBuffer
+ isn't 0 the data is copied into it and the texture is created from there, letting the driver transfer it without stalling.
+ Returns >= 0 on success, < 0 on failure.
+*/
+int gfxUtil_UploadRGBATexture( uint8_t* data, int width, int height, const AlphaInfo* alpha, GLuint pixelBuffer, Texture* outTexture );
+
+/*
+Scans the alpha of the pixels in the rectangle, the alpha is assumed to be the last component. Finds the
+ TF_IS_TRANSPARENT and TF_HAS_CLEAR_PIXELS flags and the bounding box of the pixels that aren't fully clear, relative
+ to the corner of the rectangle. The rectangle is clipped to the image. Doesn't use OpenGL so it's safe to call from any thread.
+*/
+void gfxUtil_ClassifyAlphaRect( const uint8_t* data, int width, int height, int components,
+	int rectX, int rectY, int rectWidth, int rectHeight, AlphaInfo* outAlpha );
+
+/*
+Scans the alpha of all the pixels in the image, see gfxUtil_ClassifyAlphaRect( ).
+*/
+void gfxUtil_ClassifyAlpha( const uint8_t* data, int width, int height, int components, AlphaInfo* outAlpha );
+
 /*
 Turns an SDL_Surface into a texture. Takes in a pointer to a Texture structure that it puts all the generated data into.
  Returns >= 0 on success, < 0 on failure.
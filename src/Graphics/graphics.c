@@ -15,14 +15,179 @@
 #include "debugRendering.h"
 #include "spineGfx.h"
 #include "triRendering.h"
+#include "glDebugging.h"
+#include "renderCapture.h"
+#include "textureLoader.h"
+#include "textureManager.h"
+#include "../System/jobs.h"
+
+// the main thread keeps a context for creating resources, the render thread has one shared with it that does all the drawing
+// how long the main thread can spend each frame creating textures for images loaded in the background
+#define TEXTURE_UPLOAD_BUDGET_MS 2.0f
 
 static SDL_GLContext glContext;
+static SDL_GLContext renderContext;
+
+// the main thread fills in one frame while the render thread draws the previous one
+static SDL_Thread* renderThread = NULL;
+static SDL_mutex* renderMutex = NULL;
+static SDL_cond* renderCond = NULL;
+static int frameSubmitted;
+static int frameRendering;
+static int quitRenderThread;
+static RenderThreadJob pendingJob;
+static void* pendingJobData;
+
+// everything about the submitted frame that isn't stored by the individual renderers
+static CameraSnapshot frameCameras[NUM_CAMERAS];
+static int numFrameCameras;
+static Color frameClearColor;
+static GLsync frameFence;
 
 static float currentTime;
 static float endTime;
 
 static Color clearColor;
 
+// everything is rendered into an offscreen target at a fixed resolution, which is then scaled up to fill the window
+static SDL_Window* renderWindow;
+static int useRenderTarget;
+static int renderWidth;
+static int renderHeight;
+static GLuint renderFBO;
+static GLuint renderColorTexture;
+static GLuint renderDepthBuffer;
+// where the render target was last drawn into the window, in drawable pixels with the origin at the lower left
+static int presentX;
+static int presentY;
+static int presentWidth;
+static int presentHeight;
+
+static void presentRenderTarget( void );
+
+/*
+Waits until the render thread has nothing to do, the render mutex must be locked before calling this.
+*/
+static void waitForRenderThread( void )
+{
+	while( frameSubmitted || frameRendering || ( pendingJob != NULL ) ) {
+		SDL_CondWait( renderCond, renderMutex );
+	}
+}
+
+static void drawFrame( void )
+{
+	// don't use anything the main thread has uploaded until it's finished
+	GL( glWaitSync( frameFence, 0, GL_TIMEOUT_IGNORED ) );
+	GL( glDeleteSync( frameFence ) );
+	frameFence = NULL;
+
+	if( useRenderTarget ) {
+		GL( glBindFramebuffer( GL_FRAMEBUFFER, renderFBO ) );
+	}
+
+	// clear the screen, the renderers change the viewport for each camera so reset it to cover everything
+	GL( glViewport( 0, 0, renderWidth, renderHeight ) );
+	GL( glDisable( GL_SCISSOR_TEST ) );
+	GL( glClearColor( frameClearColor.r, frameClearColor.g, frameClearColor.b, frameClearColor.a ) );
+	GL( glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE ) );
+	GL( glClear( GL_COLOR_BUFFER_BIT ) );
+
+	triRenderer_Render( frameCameras, numFrameCameras );
+
+	// now draw all the debug stuff over everything
+	debugRenderer_Render( frameCameras, numFrameCameras );
+
+	if( useRenderTarget ) {
+		presentRenderTarget( );
+	}
+
+	// waiting for v-sync happens here, so it won't hold up the main thread
+	SDL_GL_SwapWindow( renderWindow );
+}
+
+static int renderThreadMain( void* data )
+{
+	SDL_GL_MakeCurrent( renderWindow, renderContext );
+
+	SDL_LockMutex( renderMutex );
+	while( !quitRenderThread ) {
+		if( pendingJob != NULL ) {
+			RenderThreadJob job = pendingJob;
+			void* jobData = pendingJobData;
+			SDL_UnlockMutex( renderMutex );
+			job( jobData );
+			SDL_LockMutex( renderMutex );
+
+			pendingJob = NULL;
+			SDL_CondBroadcast( renderCond );
+		} else if( frameSubmitted ) {
+			frameSubmitted = 0;
+			frameRendering = 1;
+			SDL_UnlockMutex( renderMutex );
+			drawFrame( );
+			SDL_LockMutex( renderMutex );
+
+			frameRendering = 0;
+			SDL_CondBroadcast( renderCond );
+		} else {
+			SDL_CondWait( renderCond, renderMutex );
+		}
+	}
+	SDL_UnlockMutex( renderMutex );
+
+	SDL_GL_MakeCurrent( renderWindow, NULL );
+	return 0;
+}
+
+static int startRenderThread( void )
+{
+	frameSubmitted = 0;
+	frameRendering = 0;
+	quitRenderThread = 0;
+	pendingJob = NULL;
+
+	renderMutex = SDL_CreateMutex( );
+	renderCond = SDL_CreateCond( );
+	if( ( renderMutex == NULL ) || ( renderCond == NULL ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to create render thread synchronization: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	renderThread = SDL_CreateThread( renderThreadMain, "render", NULL );
+	if( renderThread == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to create render thread: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Sets up everything that uses objects that can't be shared between contexts.
+*/
+static void initRenderThread( void* data )
+{
+	int* outResult = (int*)data;
+	(*outResult) = -1;
+
+	// use v-sync, avoid tearing
+	if( SDL_GL_SetSwapInterval( 1 ) < 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, SDL_GetError( ) );
+		return;
+	}
+
+	if( debugRenderer_Init( ) < 0 ) {
+		return;
+	}
+
+	if( triRenderer_Init( ) < 0 ) {
+		return;
+	}
+
+	(*outResult) = 0;
+}
+
 /*
 Initial setup for the rendering instruction buffer.
  Returns 0 on success.
@@ -36,6 +201,7 @@ int gfx_Init( SDL_Window* window )
 		return -1;
 	}
 	SDL_GL_MakeCurrent( window, glContext );
+	renderWindow = window;
 
 	// setup glew
 	glewExperimental = GL_TRUE;
@@ -46,34 +212,324 @@ int gfx_Init( SDL_Window* window )
 	}
 	glGetError( ); // reset error flag, glew can set it but it isn't important
 
-	// use v-sync, avoid tearing
-	if( SDL_GL_SetSwapInterval( 1 ) < 0 ) {
-		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, SDL_GetError( ) );
+	// creating a context makes it current, so switch back to the main one after
+	SDL_GL_SetAttribute( SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1 );
+	renderContext = SDL_GL_CreateContext( window );
+	if( renderContext == NULL ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Error in initRendering while creating render thread context: %s", SDL_GetError( ) );
 		return -1;
 	}
+	SDL_GL_MakeCurrent( window, glContext );
 
 	currentTime = 0.0f;
 	endTime = 0.0f;
 
+	texMgr_Init( );
+
 	if( img_Init( ) < 0 ) {
 		return -1;
 	}
 
-	if( debugRenderer_Init( ) < 0 ) {
+	if( texLoader_Init( 0 ) < 0 ) {
+		return -1;
+	}
+
+	if( jobs_Init( -1 ) < 0 ) {
 		return -1;
 	}
 
 	spine_Init( );
 
-	if( triRenderer_Init( ) < 0 ) {
+	clearColor = CLR_MAGENTA;
+
+	useRenderTarget = 0;
+	SDL_GL_GetDrawableSize( window, &renderWidth, &renderHeight );
+
+	if( startRenderThread( ) < 0 ) {
 		return -1;
 	}
 
-	clearColor = CLR_MAGENTA;
+	int result = -1;
+	gfx_RunOnRenderThread( initRenderThread, &result );
+	return result;
+}
+
+/*
+Stops the render thread and destroys the contexts.
+*/
+void gfx_ShutDown( void )
+{
+	texLoader_ShutDown( );
+	jobs_ShutDown( );
+
+	if( renderThread != NULL ) {
+		SDL_LockMutex( renderMutex );
+		waitForRenderThread( );
+		quitRenderThread = 1;
+		SDL_CondBroadcast( renderCond );
+		SDL_UnlockMutex( renderMutex );
+
+		SDL_WaitThread( renderThread, NULL );
+		renderThread = NULL;
+	}
+
+	if( renderCond != NULL ) {
+		SDL_DestroyCond( renderCond );
+		renderCond = NULL;
+	}
+
+	if( renderMutex != NULL ) {
+		SDL_DestroyMutex( renderMutex );
+		renderMutex = NULL;
+	}
+
+	if( renderContext != NULL ) {
+		SDL_GL_DeleteContext( renderContext );
+		renderContext = NULL;
+	}
+
+	if( glContext != NULL ) {
+		SDL_GL_DeleteContext( glContext );
+		glContext = NULL;
+	}
+
+	texMgr_ShutDown( );
+}
+
+/*
+Waits until the render thread has finished drawing everything that's been submitted. Call this before destroying
+ anything a frame that's already been submitted may be using.
+*/
+void gfx_WaitForRenderThread( void )
+{
+	if( renderThread == NULL ) {
+		return;
+	}
+
+	SDL_LockMutex( renderMutex );
+	waitForRenderThread( );
+	SDL_UnlockMutex( renderMutex );
+}
+
+/*
+Runs the function on the render thread and waits for it to finish. Use this for anything that needs the render
+ thread's context, like creating vertex arrays or framebuffers, which aren't shared between contexts.
+*/
+void gfx_RunOnRenderThread( RenderThreadJob job, void* data )
+{
+	SDL_LockMutex( renderMutex );
+	waitForRenderThread( );
+
+	pendingJob = job;
+	pendingJobData = data;
+	SDL_CondBroadcast( renderCond );
+
+	while( pendingJob != NULL ) {
+		SDL_CondWait( renderCond, renderMutex );
+	}
+	SDL_UnlockMutex( renderMutex );
+}
+
+static void destroyRenderTarget( void )
+{
+	if( renderFBO != 0 ) {
+		GL( glDeleteFramebuffers( 1, &renderFBO ) );
+		renderFBO = 0;
+	}
+
+	if( renderColorTexture != 0 ) {
+		GL( glDeleteTextures( 1, &renderColorTexture ) );
+		renderColorTexture = 0;
+	}
+
+	if( renderDepthBuffer != 0 ) {
+		GL( glDeleteRenderbuffers( 1, &renderDepthBuffer ) );
+		renderDepthBuffer = 0;
+	}
+}
+
+static int createRenderTarget( int width, int height )
+{
+	GL( glGenTextures( 1, &renderColorTexture ) );
+	GL( glBindTexture( GL_TEXTURE_2D, renderColorTexture ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
+	GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL ) );
+	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+
+	GL( glGenRenderbuffers( 1, &renderDepthBuffer ) );
+	GL( glBindRenderbuffer( GL_RENDERBUFFER, renderDepthBuffer ) );
+	GL( glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height ) );
+	GL( glBindRenderbuffer( GL_RENDERBUFFER, 0 ) );
+
+	GL( glGenFramebuffers( 1, &renderFBO ) );
+	GL( glBindFramebuffer( GL_FRAMEBUFFER, renderFBO ) );
+	GL( glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderColorTexture, 0 ) );
+	GL( glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderDepthBuffer ) );
+
+	GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	GL( glBindFramebuffer( GL_FRAMEBUFFER, 0 ) );
+	if( status != GL_FRAMEBUFFER_COMPLETE ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Render target of size %ix%i is incomplete: 0x%x", width, height, status );
+		destroyRenderTarget( );
+		return -1;
+	}
 
 	return 0;
 }
 
+typedef struct {
+	int width;
+	int height;
+	int result;
+} RenderResolutionJob;
+
+static void setRenderResolution( void* data )
+{
+	RenderResolutionJob* job = (RenderResolutionJob*)data;
+	job->result = -1;
+
+	destroyRenderTarget( );
+	useRenderTarget = 0;
+
+	if( ( job->width <= 0 ) || ( job->height <= 0 ) ) {
+		SDL_GL_GetDrawableSize( renderWindow, &renderWidth, &renderHeight );
+		job->result = 0;
+		return;
+	}
+
+	if( createRenderTarget( job->width, job->height ) < 0 ) {
+		SDL_GL_GetDrawableSize( renderWindow, &renderWidth, &renderHeight );
+		return;
+	}
+
+	useRenderTarget = 1;
+	renderWidth = job->width;
+	renderHeight = job->height;
+
+	presentX = 0;
+	presentY = 0;
+	presentWidth = job->width;
+	presentHeight = job->height;
+
+	job->result = 0;
+}
+
+/*
+Sets the fixed resolution everything is rendered at, the result is scaled up to fit the window. If the width or height
+ is <= 0 then everything will be rendered directly into the window at it's native resolution. The cameras projections
+ should be reset after calling this.
+ Returns <0 if there's a problem, in which case everything will be rendered directly into the window.
+*/
+int gfx_SetRenderResolution( int width, int height )
+{
+	RenderResolutionJob job;
+	job.width = width;
+	job.height = height;
+
+	GLuint oldColorTexture = renderColorTexture;
+	gfx_RunOnRenderThread( setRenderResolution, &job );
+
+	// the texture manager is only used from the main thread, so keep track of the render target here
+	texMgr_Unregister( oldColorTexture );
+	if( useRenderTarget ) {
+		texMgr_Register( renderColorTexture, renderWidth, renderHeight, 4 );
+	}
+
+	return job.result;
+}
+
+/*
+Gets the size of the area everything is being rendered into.
+*/
+void gfx_GetRenderSize( int* outWidth, int* outHeight )
+{
+	(*outWidth) = renderWidth;
+	(*outHeight) = renderHeight;
+}
+
+/*
+Converts a position in window coordinates, like what SDL gives for the mouse, into the render resolution.
+ The result can be outside of the render area if the position is in the borders around it.
+*/
+void gfx_WindowToRenderPos( int windowX, int windowY, Vector2* outPos )
+{
+	// on high dpi displays the window coordinates and the drawable pixels won't match
+	int windowWidth, windowHeight;
+	int drawableWidth, drawableHeight;
+	SDL_GetWindowSize( renderWindow, &windowWidth, &windowHeight );
+	SDL_GL_GetDrawableSize( renderWindow, &drawableWidth, &drawableHeight );
+	float pixelX = (float)windowX * ( (float)drawableWidth / (float)windowWidth );
+	float pixelY = (float)windowY * ( (float)drawableHeight / (float)windowHeight );
+
+	if( !useRenderTarget ) {
+		outPos->x = pixelX;
+		outPos->y = pixelY;
+		return;
+	}
+
+	// the render thread updates where the render target is drawn
+	SDL_LockMutex( renderMutex );
+		int x = presentX;
+		int y = presentY;
+		int width = presentWidth;
+		int height = presentHeight;
+	SDL_UnlockMutex( renderMutex );
+
+	float presentTop = (float)( drawableHeight - ( y + height ) );
+	outPos->x = ( pixelX - (float)x ) * ( (float)renderWidth / (float)width );
+	outPos->y = ( pixelY - presentTop ) * ( (float)renderHeight / (float)height );
+}
+
+/*
+Copies the render target into the window. Uses the largest integer scale that fits so the pixels stay sharp, and
+ centers it with black borders around it. If the window is too small to hold the render target at all then it's
+ shrunk down to fit while keeping the aspect ratio.
+*/
+static void presentRenderTarget( void )
+{
+	int drawableWidth, drawableHeight;
+	SDL_GL_GetDrawableSize( renderWindow, &drawableWidth, &drawableHeight );
+
+	int scale = MIN( drawableWidth / renderWidth, drawableHeight / renderHeight );
+	int width, height;
+	GLenum filter = GL_NEAREST;
+	if( scale >= 1 ) {
+		width = renderWidth * scale;
+		height = renderHeight * scale;
+	} else {
+		float shrink = MIN( (float)drawableWidth / (float)renderWidth, (float)drawableHeight / (float)renderHeight );
+		width = MAX( 1, (int)( renderWidth * shrink ) );
+		height = MAX( 1, (int)( renderHeight * shrink ) );
+		filter = GL_LINEAR;
+	}
+	int x = ( drawableWidth - width ) / 2;
+	int y = ( drawableHeight - height ) / 2;
+
+	// the main thread uses this to map the mouse position
+	SDL_LockMutex( renderMutex );
+		presentX = x;
+		presentY = y;
+		presentWidth = width;
+		presentHeight = height;
+	SDL_UnlockMutex( renderMutex );
+
+	GL( glBindFramebuffer( GL_READ_FRAMEBUFFER, renderFBO ) );
+	GL( glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 ) );
+
+	GL( glViewport( 0, 0, drawableWidth, drawableHeight ) );
+	GL( glDisable( GL_SCISSOR_TEST ) );
+	GL( glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE ) );
+	GL( glClearColor( 0.0f, 0.0f, 0.0f, 1.0f ) );
+	GL( glClear( GL_COLOR_BUFFER_BIT ) );
+
+	GL( glBlitFramebuffer( 0, 0, renderWidth, renderHeight, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, filter ) );
+
+	GL( glBindFramebuffer( GL_FRAMEBUFFER, 0 ) );
+}
+
 /*
 Sets clearing color.
 */
@@ -95,8 +551,31 @@ void gfx_ClearDrawCommands( float timeToEnd )
 }
 
 /*
-Goes through everything in the render buffer and does the actual rendering.
-Resets the render buffer.
+Hands the frame that was just filled to the render thread, waiting for it to finish drawing the previous one first.
+*/
+static void submitFrame( void )
+{
+	// make sure anything the main thread has done, like uploading textures, is finished before the render thread uses it
+	GLsync fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	GL( glFlush( ) );
+
+	SDL_LockMutex( renderMutex );
+	waitForRenderThread( );
+
+	triRenderer_SwapFrames( );
+	debugRenderer_SubmitFrame( );
+	numFrameCameras = cam_TakeSnapshots( frameCameras );
+	frameClearColor = clearColor;
+	frameFence = fence;
+
+	frameSubmitted = 1;
+	SDL_CondBroadcast( renderCond );
+	SDL_UnlockMutex( renderMutex );
+}
+
+/*
+Goes through everything in the render buffer and builds the frame, then hands it off to the render thread to be drawn.
+ Returns once the frame has been handed off, while the render thread is drawing the main thread is free to work on the next one.
 */
 void gfx_Render( float dt )
 {
@@ -105,19 +584,36 @@ void gfx_Render( float dt )
 	currentTime += dt;
 	t = clamp( 0.0f, 1.0f, ( currentTime / endTime ) );
 
-	// clear the screen
-	glClearColor( clearColor.r, clearColor.g, clearColor.b, clearColor.a);
-	glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
-	glClear( GL_COLOR_BUFFER_BIT );
-
+	texLoader_Update( TEXTURE_UPLOAD_BUDGET_MS );
 	spine_UpdateInstances( dt );
 	
-	// draw all the stuff that routes through the triangle rendering
+	// fill in all the stuff that routes through the triangle rendering
+	renderCapture_BeginFrame( );
 	triRenderer_Clear( );
 		img_Render( t );
 		spine_RenderInstances( t );
-	triRenderer_Render( );
+	renderCapture_EndFrame( );
 
-	// now draw all the debug stuff over everything
-	debugRenderer_Render( );
+	texMgr_EndFrame( );
+	submitFrame( );
+}
+
+/*
+Sets how much memory the textures can use, textures loaded from files that haven't been drawn recently are released
+ to stay under it. 0 means there's no limit.
+*/
+void gfx_SetTextureBudget( size_t budgetBytes )
+{
+	texMgr_SetBudget( budgetBytes );
+}
+
+/*
+Gets the stats for the last frame that was built.
+*/
+void gfx_GetFrameStats( GfxFrameStats* outStats )
+{
+	assert( outStats != NULL );
+
+	texMgr_GetStats( &( outStats->residentTextureBytes ), &( outStats->evictedTextureBytes ),
+		&( outStats->texturesEvicted ), &( outStats->texturesReloaded ), &( outStats->texturesPending ) );
 }
\ No newline at end of file
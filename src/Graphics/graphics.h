@@ -5,13 +5,60 @@
 #include "../Math/vector2.h"
 #include "color.h"
 
+typedef void (*RenderThreadJob)( void* data );
+
+typedef struct {
+	size_t residentTextureBytes;
+	size_t evictedTextureBytes; // textures that were released to stay under the budget, they're reloaded when drawn
+	int texturesEvicted;
+	int texturesReloaded;
+	int texturesPending; // evicted textures that were drawn and are waiting for their files to be decoded again
+} GfxFrameStats;
+
 /* ======= Rendering ======= */
 /*
-Initial setup for the rendering instruction buffer.
+Initial setup for the rendering instruction buffer. Starts up the render thread, which owns the context all the
+ drawing is done with.
  Returns a negative number on failure.
 */
 int gfx_Init( SDL_Window* window );
 
+/*
+Stops the render thread and destroys the contexts.
+*/
+void gfx_ShutDown( void );
+
+/*
+Waits until the render thread has finished drawing everything that's been submitted. Call this before destroying
+ anything a frame that's already been submitted may be using.
+*/
+void gfx_WaitForRenderThread( void );
+
+/*
+Runs the function on the render thread and waits for it to finish. Use this for anything that needs the render
+ thread's context, like creating vertex arrays or framebuffers, which aren't shared between contexts.
+*/
+void gfx_RunOnRenderThread( RenderThreadJob job, void* data );
+
+/*
+Sets the fixed resolution everything is rendered at, the result is scaled up to fit the window. If the width or height
+ is <= 0 then everything will be rendered directly into the window at it's native resolution. The cameras projections
+ should be reset after calling this.
+ Returns <0 if there's a problem, in which case everything will be rendered directly into the window.
+*/
+int gfx_SetRenderResolution( int width, int height );
+
+/*
+Gets the size of the area everything is being rendered into.
+*/
+void gfx_GetRenderSize( int* outWidth, int* outHeight );
+
+/*
+Converts a position in window coordinates, like what SDL gives for the mouse, into the render resolution.
+ The result can be outside of the render area if the position is in the borders around it.
+*/
+void gfx_WindowToRenderPos( int windowX, int windowY, Vector2* outPos );
+
 /*
 Sets clearing color.
 */
@@ -23,9 +70,20 @@ Clears all the drawing instructions.
 void gfx_ClearDrawCommands( float endTime );
 
 /*
-Goes through everything in the render buffer and does the actual rendering.
-Resets the render buffer.
+Goes through everything in the render buffer and builds the frame, then hands it off to the render thread to be drawn.
+ Returns once the frame has been handed off, while the render thread is drawing the main thread is free to work on the next one.
 */
 void gfx_Render( float deltaTime );
 
+/*
+Sets how much memory the textures can use, textures loaded from files that haven't been drawn recently are released
+ to stay under it. 0 means there's no limit.
+*/
+void gfx_SetTextureBudget( size_t budgetBytes );
+
+/*
+Gets the stats for the last frame that was built.
+*/
+void gfx_GetFrameStats( GfxFrameStats* outStats );
+
 #endif
@@ -11,7 +11,7 @@
 
 #include "../Utils/stretchyBuffer.h"
 
-// TODO: Convert this from a text format to binary.
+// the text format is only used during development, packAssets stores the parsed sprites in the asset pack
 
 typedef enum {
 	RS_VERSION,
@@ -22,12 +22,12 @@ typedef enum {
 } ReadState;
 
 /*
-This opens up the sprite sheet file and loads all the images, putting the ids into imgOutArray. The returned array
- uses the stretchy buffer file, so you can use that to find the size, but you shouldn't do anything that modifies
- the size of it.
- Returns the number of images loaded if it was successful, otherwise returns -1.
+Reads the sprite sheet definition file, putting the file name of the image into imgFileName and the rectangles of the
+ sprites into outMins and outMaxes. The rectangle arrays are allocated with mem_Allocate( ) and need to be released
+ by the caller.
+ Returns the number of sprites if it was successful, otherwise returns -1.
 */
-int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArray )
+int img_ReadSpriteSheetFile( const char* fileName, char* imgFileName, size_t imgFileNameSize, Vector2** outMins, Vector2** outMaxes )
 {
 	int returnVal = 0;
 	Vector2* mins = NULL;
@@ -67,7 +67,7 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 	const char* delim = "\r\n";
 	char* line = strtok( fileText, delim );
 	char* fileNameLoc;
-	char imgFileName[256] = { 0 };
+	memset( imgFileName, 0, imgFileNameSize );
 
 	// now go through individual lines, parsing stuff as necessary
 	while( line != NULL ) {
@@ -80,12 +80,12 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 			// assuming the file name will be local the .ss file, so we need to rip the directory off it and
 			//  append the file name to it
 			// line will be the file name for the image, attempt to create the texture
-			strncpy( imgFileName, fileName, ( sizeof( imgFileName ) / sizeof( imgFileName[0] ) ) - 1 );
+			strncpy( imgFileName, fileName, imgFileNameSize - 1 );
 			fileNameLoc = strrchr( imgFileName, '/' );
 
 			if( fileNameLoc != NULL ) {
 				++fileNameLoc;
-				strncpy( fileNameLoc, line, ( ( imgFileName + 255 ) - fileNameLoc ) );
+				strncpy( fileNameLoc, line, ( ( imgFileName + imgFileNameSize - 1 ) - fileNameLoc ) );
 			}
 			currentState = RS_COUNT;
 			break;
@@ -107,12 +107,6 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 					returnVal = -1;
 					goto clean_up;
 				}
-				
-				if( ( (*imgOutArray) = mem_Allocate( sizeof( int ) * numSprites ) ) == NULL ) {
-					SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to allocate image IDs array for sprite sheet definition file: %s", fileName );
-					returnVal = -1;
-					goto clean_up;
-				}
 			}
 			numSpritesRead = 0;
 			currentState = RS_SPRITES;
@@ -134,20 +128,15 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 	}
 
 	if( currentState != RS_FINISHED ) {
-		mem_Release( *imgOutArray );
 		returnVal = -1;
 		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Problem reading sprite sheet definition file: %s", fileName );
 		goto clean_up;
 	}
 
-	// now go through and create all the images
-	if( img_SplitImageFile( imgFileName, numSpritesRead, shaderType, mins, maxes, (*imgOutArray) ) < 0 ) {
-		mem_Release( *imgOutArray );
-		returnVal = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Problem splitting image for sprite sheet definition file: %s", fileName );
-		goto clean_up;
-	}
-
+	(*outMins) = mins;
+	(*outMaxes) = maxes;
+	mins = NULL;
+	maxes = NULL;
 	returnVal = numSpritesRead;
 
 clean_up:
@@ -164,6 +153,72 @@ clean_up:
 	return returnVal;
 }
 
+/*
+Reads the sprite sheet file and creates all the images, if async is set the image file is loaded in the background.
+ Returns the number of images loaded if it was successful, otherwise returns -1.
+*/
+static int loadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArray, int async )
+{
+	Vector2* mins = NULL;
+	Vector2* maxes = NULL;
+	char imgFileName[256];
+	int returnVal = 0;
+
+	int numSprites = img_ReadSpriteSheetFile( fileName, imgFileName, sizeof( imgFileName ), &mins, &maxes );
+	if( numSprites < 0 ) {
+		return -1;
+	}
+
+	if( ( (*imgOutArray) = mem_Allocate( sizeof( int ) * numSprites ) ) == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to allocate image IDs array for sprite sheet definition file: %s", fileName );
+		returnVal = -1;
+		goto clean_up;
+	}
+
+	// now go through and create all the images
+	int packageID;
+	if( async ) {
+		packageID = img_SplitImageFileAsync( imgFileName, numSprites, shaderType, mins, maxes, (*imgOutArray) );
+	} else {
+		packageID = img_SplitImageFile( imgFileName, numSprites, shaderType, mins, maxes, (*imgOutArray) );
+	}
+	if( packageID < 0 ) {
+		mem_Release( *imgOutArray );
+		returnVal = -1;
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Problem splitting image for sprite sheet definition file: %s", fileName );
+		goto clean_up;
+	}
+
+	returnVal = numSprites;
+
+clean_up:
+	mem_Release( mins );
+	mem_Release( maxes );
+
+	return returnVal;
+}
+
+/*
+This opens up the sprite sheet file and loads all the images, putting the ids into imgOutArray. The returned array
+ uses the stretchy buffer file, so you can use that to find the size, but you shouldn't do anything that modifies
+ the size of it.
+ Returns the number of images loaded if it was successful, otherwise returns -1.
+*/
+int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArray )
+{
+	return loadSpriteSheet( fileName, shaderType, imgOutArray, 0 );
+}
+
+/*
+Same as img_LoadSpriteSheet( ) but the image file is loaded in the background. The ids can be used immediately, a
+ placeholder will be drawn until the image has finished loading.
+ Returns the number of images if it was successful, otherwise returns -1.
+*/
+int img_LoadSpriteSheetAsync( char* fileName, ShaderType shaderType, int** imgOutArray )
+{
+	return loadSpriteSheet( fileName, shaderType, imgOutArray, 1 );
+}
+
 /*
 Cleans up all the images created from img_LoadSpriteSheet( ). The pointer passed in will be invalid after this
  is called.
@@ -3,6 +3,14 @@
 
 #include "triRendering.h"
 
+/*
+Reads the sprite sheet definition file, putting the file name of the image into imgFileName and the rectangles of the
+ sprites into outMins and outMaxes. The rectangle arrays are allocated with mem_Allocate( ) and need to be released
+ by the caller.
+ Returns the number of sprites if it was successful, otherwise returns -1.
+*/
+int img_ReadSpriteSheetFile( const char* fileName, char* imgFileName, size_t imgFileNameSize, Vector2** outMins, Vector2** outMaxes );
+
 /*
 This opens up the sprite sheet file and loads all the images, putting image ids into imgOutArray. The returned array
  uses the stretchy buffer file, so you can use that to find the size, but you shouldn't do anything that modifies
@@ -12,6 +20,13 @@ This opens up the sprite sheet file and loads all the images, putting image ids
 */
 int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArray );
 
+/*
+Same as img_LoadSpriteSheet( ) but the image file is loaded in the background. The ids can be used immediately, a
+ placeholder will be drawn until the image has finished loading.
+ Returns the number of images if it was successful, otherwise returns -1.
+*/
+int img_LoadSpriteSheetAsync( char* fileName, ShaderType shaderType, int** imgOutArray );
+
 /*
 Cleans up all the images created from img_LoadSpriteSheet( ). The pointer passed in will be invalid after this
  is called.
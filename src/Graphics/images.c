@@ -9,13 +9,29 @@
 
 #include "../Math/matrix4.h"
 #include "gfxUtil.h"
+#include "graphics.h"
+#include "textureLoader.h"
+#include "textureManager.h"
 
 /* Image loading types and variables */
-#define MAX_IMAGES 512
+#define MAX_IMAGES 8192
+#define MAX_PACKAGES 256
+
+// image ids handed out are the index of the image combined with a generation count, the generation is increased
+//  every time the image is cleaned up so old ids will no longer be valid even after the spot is reused
+#define IMAGE_INDEX_BITS 16
+#define IMAGE_INDEX_MASK ( ( 1 << IMAGE_INDEX_BITS ) - 1 )
+#define MAX_IMAGE_GENERATION 0x7fff
+
+#if MAX_IMAGES > ( IMAGE_INDEX_MASK + 1 )
+	#error "images MAX_IMAGES is too large to fit into an image id."
+#endif
 
 enum {
 	IMGFLAG_IN_USE = 0x1,
 	IMGFLAG_HAS_TRANSPARENCY = 0x2,
+	IMGFLAG_HAS_CLEAR_PIXELS = 0x4,
+	IMGFLAG_SHARED_TEXTURE = 0x8, // the texture belongs to something else, don't destroy it with the image
 };
 
 typedef struct {
@@ -24,46 +40,95 @@ typedef struct {
 	Vector2 uvMax;
 	Vector2 size;
 	Vector2 offset;
+	// bounding box of the pixels that aren't fully clear, in pixels from the top left of the image
+	Vector2 opaqueMin;
+	Vector2 opaqueMax;
+	// the part of the image that's drawn, the opaque bounds as a fraction of the size, so no time is wasted on clear pixels
+	Vector2 trimMin;
+	Vector2 trimMax;
 	int flags;
+	int generation;
 	int packageID;
+	// images in the same package are linked together, unused images are linked together through nextInPackage
 	int nextInPackage;
+	int prevInPackage;
 	ShaderType shaderType;
 } Image;
 
 static Image images[MAX_IMAGES];
+static int firstFreeImage;
+
+// all the images in a package share the same texture, it's destroyed when the last one is cleaned up
+typedef struct {
+	int inUse;
+	int generation;
+	int firstImage;
+	int nextFree;
+	GLuint textureObj;
+} ImagePackage;
+
+static ImagePackage packages[MAX_PACKAGES];
+static int firstFreePackage;
+
+// images that are loaded in the background use this until their texture is ready
+#define PLACEHOLDER_SIZE 32
+static GLuint placeholderTexture;
 
 /* Rendering types and variables */
 #define MAX_RENDER_INSTRUCTIONS ( 1024 * 10 )
+
+// the per image data (texture, uvs, offset, etc.) is looked up when rendering, the draw list only stores what's
+//  different for each draw, scale, color, and rotation are only written and read when they've been set
+enum {
+	DIF_SCALED = 0x1,
+	DIF_COLORED = 0x2,
+	DIF_ROTATED = 0x4,
+	DIF_LERP_POS = 0x8,
+	DIF_LERP_SCALE = 0x10,
+	DIF_LERP_COLOR = 0x20,
+	DIF_LERP_ROT = 0x40,
+	DIF_GLYPH_RUN = 0x80, // the image id is the index of a GlyphRun
+};
+
 typedef struct {
-	Vector2 pos;
-	Vector2 scaleSize;
-	Color color;
-	float rotation;
-} DrawInstructionState;
+	Vector2 start;
+	Vector2 end;
+} DrawVec2Pair;
 
 typedef struct {
-	GLuint textureObj;
-	int imageObj;
-	Vector2 offset;
-	Vector2 uvs[4];
-	DrawInstructionState start;
-	DrawInstructionState end;
-	int flags;
-	int camFlags;
-	char depth;
-	ShaderType shaderType;
-} DrawInstruction;
+	Color start;
+	Color end;
+} DrawColorPair;
 
-static DrawInstruction renderBuffer[MAX_RENDER_INSTRUCTIONS];
+typedef struct {
+	float start;
+	float end;
+} DrawFloatPair;
+
+static int drawImageIDs[MAX_RENDER_INSTRUCTIONS];
+static unsigned int drawCamFlags[MAX_RENDER_INSTRUCTIONS];
+static char drawDepths[MAX_RENDER_INSTRUCTIONS];
+static uint8_t drawFlags[MAX_RENDER_INSTRUCTIONS];
+static uint8_t drawImgFlags[MAX_RENDER_INSTRUCTIONS];
+static DrawVec2Pair drawPositions[MAX_RENDER_INSTRUCTIONS];
+static DrawVec2Pair drawScales[MAX_RENDER_INSTRUCTIONS];
+static DrawColorPair drawColors[MAX_RENDER_INSTRUCTIONS];
+static DrawFloatPair drawRotations[MAX_RENDER_INSTRUCTIONS];
 static int lastDrawInstruction;
 
-static const DrawInstruction DEFAULT_DRAW_INSTRUCTION = {
-	0, -1, { 0.0f, 0.0f },
-	{ { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f } },
-	{ { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 0.0f },
-	{ { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 0.0f },
-	0, 0, 0
-};
+// a run of glyphs takes up a single entry in the draw list, the images and offsets of the glyphs are stored here
+#define MAX_GLYPH_RUNS 1024
+#define MAX_RUN_GLYPHS MAX_RENDER_INSTRUCTIONS
+typedef struct {
+	int firstGlyph;
+	int count;
+} GlyphRun;
+
+static GlyphRun glyphRuns[MAX_GLYPH_RUNS];
+static int lastGlyphRun;
+static int runGlyphIDs[MAX_RUN_GLYPHS];
+static Vector2 runGlyphOffsets[MAX_RUN_GLYPHS];
+static int numRunGlyphs;
 
 static GLint maxTextureSize;
 
@@ -75,40 +140,136 @@ int img_Init( void )
 {
 	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxTextureSize );
 	memset( images, 0, sizeof(images) );
+	memset( packages, 0, sizeof(packages) );
+
+	for( int i = 0; i < MAX_IMAGES; ++i ) {
+		images[i].generation = 1;
+		images[i].packageID = -1;
+		images[i].prevInPackage = -1;
+		images[i].nextInPackage = ( i < ( MAX_IMAGES - 1 ) ) ? ( i + 1 ) : -1;
+	}
+	firstFreeImage = 0;
+
+	for( int i = 0; i < MAX_PACKAGES; ++i ) {
+		packages[i].generation = 1;
+		packages[i].firstImage = -1;
+		packages[i].nextFree = ( i < ( MAX_PACKAGES - 1 ) ) ? ( i + 1 ) : -1;
+	}
+	firstFreePackage = 0;
+
+	uint8_t placeholderPixel[] = { 0x80, 0x80, 0x80, 0xFF };
+	Texture placeholder;
+	if( gfxUtil_CreateTextureFromRGBABitmap( placeholderPixel, 1, 1, &placeholder ) < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Unable to create placeholder texture." );
+		return -1;
+	}
+	placeholderTexture = placeholder.textureID;
+
 	return 0;
 }
 
+static int makeImageID( int idx )
+{
+	return ( ( images[idx].generation << IMAGE_INDEX_BITS ) | idx );
+}
+
+/*
+Converts an image id into the index of the image.
+ Returns a negative value if the id isn't for an image currently in use.
+*/
+static int imageIDToIndex( int imgID )
+{
+	if( imgID < 0 ) {
+		return -1;
+	}
+
+	int idx = ( imgID & IMAGE_INDEX_MASK );
+	if( ( idx >= MAX_IMAGES ) || !( images[idx].flags & IMGFLAG_IN_USE ) ||
+		( images[idx].generation != ( imgID >> IMAGE_INDEX_BITS ) ) ) {
+		return -1;
+	}
+
+	return idx;
+}
+
 /*
-Finds the first unused image index.
- Returns a postive value on success, a negative on failure.
+Sets the transparency flags and the bounds of the visible pixels for the image, flags are the TextureFlags. The size of
+ the image must already be set.
 */
-static int findAvailableImageIndex( )
+static void setImageAlpha( int idx, int flags, Vector2 opaqueMin, Vector2 opaqueMax )
 {
-	int newIdx = 0;
+	images[idx].flags &= ~( IMGFLAG_HAS_TRANSPARENCY | IMGFLAG_HAS_CLEAR_PIXELS );
+	if( flags & TF_IS_TRANSPARENT ) {
+		images[idx].flags |= IMGFLAG_HAS_TRANSPARENCY;
+	}
+	if( flags & TF_HAS_CLEAR_PIXELS ) {
+		images[idx].flags |= IMGFLAG_HAS_CLEAR_PIXELS;
+	}
+
+	images[idx].opaqueMin = opaqueMin;
+	images[idx].opaqueMax = opaqueMax;
 
-	while( ( newIdx < MAX_IMAGES ) && ( images[newIdx].flags & IMGFLAG_IN_USE ) ) {
-		++newIdx;
+	Vector2 size = images[idx].size;
+	if( ( size.x > 0.0f ) && ( size.y > 0.0f ) ) {
+		images[idx].trimMin.x = opaqueMin.x / size.x;
+		images[idx].trimMin.y = opaqueMin.y / size.y;
+		images[idx].trimMax.x = opaqueMax.x / size.x;
+		images[idx].trimMax.y = opaqueMax.y / size.y;
+	} else {
+		images[idx].trimMin = VEC2_ZERO;
+		images[idx].trimMax = VEC2_ONE;
 	}
+}
 
-	if( newIdx >= MAX_IMAGES ) {
-		newIdx = -1;
+/*
+Takes an unused image off the free list and sets it up with the texture.
+ Returns the index of the image on success, a negative on failure.
+*/
+static int allocateImage( Texture* texture, ShaderType shaderType )
+{
+	int newIdx = firstFreeImage;
+	if( newIdx < 0 ) {
+		return -1;
 	}
+	firstFreeImage = images[newIdx].nextInPackage;
+
+	images[newIdx].textureObj = texture->textureID;
+	images[newIdx].size.v[0] = (float)texture->width;
+	images[newIdx].size.v[1] = (float)texture->height;
+	images[newIdx].offset = VEC2_ZERO;
+	images[newIdx].packageID = -1;
+	images[newIdx].flags = IMGFLAG_IN_USE;
+	images[newIdx].nextInPackage = -1;
+	images[newIdx].prevInPackage = -1;
+	images[newIdx].uvMin = VEC2_ZERO;
+	images[newIdx].uvMax = VEC2_ONE;
+	images[newIdx].shaderType = shaderType;
+	setImageAlpha( newIdx, texture->flags, texture->opaqueMin, texture->opaqueMax );
 
 	return newIdx;
 }
 
+static void deleteTexture( GLuint textureObj )
+{
+	if( ( textureObj == 0 ) || ( textureObj == placeholderTexture ) ) {
+		return;
+	}
+
+	// the frame the render thread is drawing may still be using it
+	gfx_WaitForRenderThread( );
+	texMgr_Unregister( textureObj );
+	glDeleteTextures( 1, &textureObj );
+}
+
 /*
 Loads the image stored at file name.
- Returns the index of the image on success.
+ Returns the id of the image on success.
  Returns -1 on failure, and prints a message to the log.
 */
 int img_Load( const char* fileName, ShaderType shaderType )
 {
-	int newIdx = -1;
-
-	// find the first empty spot, make sure we won't go over our maximum
-	newIdx = findAvailableImageIndex( );
-	if( newIdx < 0 ) {
+	// make sure we won't go over our maximum
+	if( firstFreeImage < 0 ) {
 		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to load image %s! Image storage full.", fileName );
 		return -1;
 	}
@@ -116,25 +277,63 @@ int img_Load( const char* fileName, ShaderType shaderType )
 	Texture texture;
 	if( gfxUtil_LoadTexture( fileName, &texture ) < 0 ) {
 		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to load image %s!", fileName );
-		newIdx = -1;
 		return -1;
 	}
 
-	images[newIdx].textureObj = texture.textureID;
-	images[newIdx].size.v[0] = (float)texture.width;
-	images[newIdx].size.v[1] = (float)texture.height;
-	images[newIdx].offset = VEC2_ZERO;
-	images[newIdx].packageID = -1;
-	images[newIdx].flags = IMGFLAG_IN_USE;
-	images[newIdx].nextInPackage = -1;
-	images[newIdx].uvMin = VEC2_ZERO;
-	images[newIdx].uvMax = VEC2_ONE;
-	images[newIdx].shaderType = shaderType;
-	if( texture.flags & TF_IS_TRANSPARENT ) {
-		images[newIdx].flags |= IMGFLAG_HAS_TRANSPARENCY;
+	return makeImageID( allocateImage( &texture, shaderType ) );
+}
+
+static void imageLoaded( Texture* texture, const uint8_t* pixels, void* data )
+{
+	int idx = imageIDToIndex( (int)(intptr_t)data );
+	if( idx < 0 ) {
+		// cleaned up before it finished loading
+		if( texture != NULL ) {
+			gfxUtil_UnloadTexture( texture );
+		}
+		return;
 	}
 
-	return newIdx;
+	// if it failed the placeholder is left in place
+	if( texture == NULL ) {
+		return;
+	}
+
+	images[idx].textureObj = texture->textureID;
+	images[idx].size.v[0] = (float)texture->width;
+	images[idx].size.v[1] = (float)texture->height;
+	setImageAlpha( idx, texture->flags, texture->opaqueMin, texture->opaqueMax );
+}
+
+/*
+Loads the image stored at file name in the background. The id can be used immediately, a placeholder will be drawn
+ until the image has finished loading.
+ Returns the id of the image on success.
+ Returns -1 on failure, and prints a message to the log.
+*/
+int img_LoadAsync( const char* fileName, ShaderType shaderType )
+{
+	if( firstFreeImage < 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to load image %s! Image storage full.", fileName );
+		return -1;
+	}
+
+	Texture placeholder;
+	placeholder.textureID = placeholderTexture;
+	placeholder.width = PLACEHOLDER_SIZE;
+	placeholder.height = PLACEHOLDER_SIZE;
+	placeholder.flags = 0;
+	placeholder.opaqueMin = VEC2_ZERO;
+	placeholder.opaqueMax.x = (float)PLACEHOLDER_SIZE;
+	placeholder.opaqueMax.y = (float)PLACEHOLDER_SIZE;
+
+	int imgID = makeImageID( allocateImage( &placeholder, shaderType ) );
+	if( texLoader_Queue( fileName, imageLoaded, (void*)(intptr_t)imgID ) < 0 ) {
+		img_Clean( imgID );
+		return -1;
+	}
+
+	return imgID;
 }
 
 /*
@@ -142,12 +341,9 @@ Creates an image from a surface.
 */
 int img_Create( SDL_Surface* surface, ShaderType shaderType )
 {
-	int newIdx;
-
 	assert( surface != NULL );
 
-	newIdx = findAvailableImageIndex( );
-	if( newIdx < 0 ) {
+	if( firstFreeImage < 0 ) {
 		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to create image from surface! Image storage full." );
 		return -1;
 	}
@@ -156,118 +352,250 @@ int img_Create( SDL_Surface* surface, ShaderType shaderType )
 	if( gfxUtil_CreateTextureFromSurface( surface, &texture ) < 0 ) {
 		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to convert surface to texture! SDL Error: %s", SDL_GetError( ) );
 		return -1;
-	} else {
-		images[newIdx].size.v[0] = (float)texture.width;
-		images[newIdx].size.v[1] = (float)texture.height;
-		images[newIdx].offset = VEC2_ZERO;
-		images[newIdx].packageID = -1;
-		images[newIdx].flags = IMGFLAG_IN_USE;
-		images[newIdx].nextInPackage = -1;
-		images[newIdx].uvMin = VEC2_ZERO;
-		images[newIdx].uvMax = VEC2_ONE;
-		images[newIdx].shaderType = shaderType;
-		if( texture.flags & TF_IS_TRANSPARENT ) {
-			images[newIdx].flags |= IMGFLAG_HAS_TRANSPARENCY;
-		}
 	}
 
-	return newIdx;
+	return makeImageID( allocateImage( &texture, shaderType ) );
 }
 
 /*
-Cleans up an image at the specified index, trying to render with it after this won't work.
+Creates an image from an existing texture, the image takes ownership of the texture and will destroy it when it's
+ cleaned up.
+ Returns the id of the image on success, -1 on failure.
 */
-void img_Clean( int idx )
+int img_CreateFromTexture( Texture* texture, ShaderType shaderType )
 {
-	assert( idx < MAX_IMAGES );
-	assert( idx >= 0 );
-	assert( images[idx].flags & IMGFLAG_IN_USE );
+	assert( texture != NULL );
 
-	int bufIdx;
+	if( firstFreeImage < 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to create image from texture! Image storage full." );
+		gfxUtil_UnloadTexture( texture );
+		return -1;
+	}
 
-	if( ( idx < 0 ) || ( ( images[idx].size.v[0] == 0.0f ) && ( images[idx].size.v[1] == 0.0f ) ) || ( idx >= MAX_IMAGES ) ) {
-		return;
+	return makeImageID( allocateImage( texture, shaderType ) );
+}
+
+/*
+Creates an image from part of a texture that's owned by something else, cleaning up the image won't destroy the
+ texture. min and max are the corners of the rectangle in pixels, alpha is for the pixels in the rectangle.
+ Returns the id of the image on success, -1 on failure.
+*/
+int img_CreateFromTextureRect( Texture* texture, Vector2 min, Vector2 max, const AlphaInfo* alpha, ShaderType shaderType )
+{
+	assert( texture != NULL );
+	assert( alpha != NULL );
+
+	if( firstFreeImage < 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Unable to create image from texture rectangle! Image storage full." );
+		return -1;
 	}
 
-	/* clean up anything we're wanting to draw */
-	for( bufIdx = 0; bufIdx <= lastDrawInstruction; ++bufIdx ) {
-		if( renderBuffer[bufIdx].imageObj == idx ) {
-			if( lastDrawInstruction > 0 ) {
-				renderBuffer[bufIdx] = renderBuffer[lastDrawInstruction-1];
-			}
-			--lastDrawInstruction;
-			--bufIdx;
-		}
+	int idx = allocateImage( texture, shaderType );
+	images[idx].flags |= IMGFLAG_SHARED_TEXTURE;
+	vec2_Subtract( &max, &min, &( images[idx].size ) );
+	images[idx].uvMin.x = min.x / (float)texture->width;
+	images[idx].uvMin.y = min.y / (float)texture->height;
+	images[idx].uvMax.x = max.x / (float)texture->width;
+	images[idx].uvMax.y = max.y / (float)texture->height;
+	setImageAlpha( idx, alpha->flags, alpha->opaqueMin, alpha->opaqueMax );
+
+	return makeImageID( idx );
+}
+
+/*
+Destroys the package and its texture, puts it back on the free list.
+*/
+static void releasePackage( int packageID )
+{
+	deleteTexture( packages[packageID].textureObj );
+	packages[packageID].inUse = 0;
+	packages[packageID].textureObj = 0;
+	packages[packageID].firstImage = -1;
+
+	++packages[packageID].generation;
+	if( packages[packageID].generation > MAX_IMAGE_GENERATION ) {
+		packages[packageID].generation = 1;
 	}
 
-	// see if this is the last image using that texture
-	//  TODO: See if this needs to be sped up
-	int deleteTexture = 1;
-	for( int i = 0; ( i < MAX_IMAGES ) && deleteTexture; ++i ) {
-		if( ( images[i].flags & IMGFLAG_IN_USE ) && ( images[i].textureObj == images[idx].textureObj ) ) {
-			deleteTexture = 0;
-		}
+	packages[packageID].nextFree = firstFreePackage;
+	firstFreePackage = packageID;
+}
+
+/*
+Removes the image from the package it's in, destroying the package if it was the last image in it.
+*/
+static void removeFromPackage( int idx )
+{
+	int packageID = images[idx].packageID;
+	ImagePackage* package = &( packages[packageID] );
+
+	if( images[idx].prevInPackage >= 0 ) {
+		images[images[idx].prevInPackage].nextInPackage = images[idx].nextInPackage;
+	} else {
+		package->firstImage = images[idx].nextInPackage;
+	}
+
+	if( images[idx].nextInPackage >= 0 ) {
+		images[images[idx].nextInPackage].prevInPackage = images[idx].prevInPackage;
+	}
+
+	if( package->firstImage < 0 ) {
+		releasePackage( packageID );
+	}
+}
+
+/*
+Cleans up an image with the specified id, trying to render with it after this won't work.
+*/
+void img_Clean( int imgID )
+{
+	int idx = imageIDToIndex( imgID );
+	assert( idx >= 0 );
+	if( idx < 0 ) {
+		return;
 	}
 
-	if( deleteTexture ) {
-		glDeleteTextures( 1, &( images[idx].textureObj ) );
+	// anything still queued to be drawn with this image will be skipped, the generation won't match
+	if( images[idx].packageID >= 0 ) {
+		removeFromPackage( idx );
+	} else if( !( images[idx].flags & IMGFLAG_SHARED_TEXTURE ) ) {
+		deleteTexture( images[idx].textureObj );
 	}
+
+	images[idx].textureObj = 0;
 	images[idx].size = VEC2_ZERO;
 	images[idx].flags = 0;
 	images[idx].packageID = -1;
-	images[idx].nextInPackage = -1;
+	images[idx].prevInPackage = -1;
 	images[idx].uvMin = VEC2_ZERO;
 	images[idx].uvMax = VEC2_ZERO;
+	images[idx].opaqueMin = VEC2_ZERO;
+	images[idx].opaqueMax = VEC2_ZERO;
+	images[idx].trimMin = VEC2_ZERO;
+	images[idx].trimMax = VEC2_ZERO;
 	images[idx].shaderType = ST_DEFAULT;
+
+	// skip 0 so a zeroed out id is never valid
+	++images[idx].generation;
+	if( images[idx].generation > MAX_IMAGE_GENERATION ) {
+		images[idx].generation = 1;
+	}
+
+	images[idx].nextInPackage = firstFreeImage;
+	firstFreeImage = idx;
 }
 
 /*
-Finds the next unused package ID.
+Takes an unused package off the free list.
+ Returns the package ID, a negative value if there are none left.
 */
-int findUnusedPackage( void )
+static int allocatePackage( GLuint textureObj )
 {
-	int packageID = 0;
-	for( int i = 0; i < MAX_IMAGES; ++i ) {
-		if( ( images[i].flags & IMGFLAG_IN_USE ) && ( images[i].packageID <= packageID ) ) {
-			packageID = images[i].packageID + 1;
-		}
+	int packageID = firstFreePackage;
+	if( packageID < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Image package storage full." );
+		return -1;
 	}
+	firstFreePackage = packages[packageID].nextFree;
+
+	packages[packageID].inUse = 1;
+	packages[packageID].firstImage = -1;
+	packages[packageID].nextFree = -1;
+	packages[packageID].textureObj = textureObj;
+
 	return packageID;
 }
 
 /*
-Splits the texture. Returns a negative number if there's a problem.
+Finds the alpha for a sprite in the package, if pixels is NULL the sprite uses the flags of the texture and is treated
+ as completely visible.
 */
-int split( Texture* texture, int packageID, ShaderType shaderType, int count, Vector2* mins, Vector2* maxes, int* retIDs )
+static void classifySprite( Texture* texture, const uint8_t* pixels, int components, Vector2* min, Vector2* max, AlphaInfo* outAlpha )
 {
+	if( pixels != NULL ) {
+		gfxUtil_ClassifyAlphaRect( pixels, texture->width, texture->height, components,
+			(int)min->x, (int)min->y, (int)( max->x - min->x ), (int)( max->y - min->y ), outAlpha );
+	} else {
+		outAlpha->flags = texture->flags;
+		outAlpha->opaqueMin = VEC2_ZERO;
+		vec2_Subtract( max, min, &( outAlpha->opaqueMax ) );
+	}
+}
+
+/*
+Splits the texture into a new package. The alpha for each sprite is taken from spriteAlphas if it isn't NULL, otherwise
+ it's found from the pixels the texture was created from, see classifySprite( ).
+ Returns the package ID, or a negative number if there's a problem.
+*/
+static int split( Texture* texture, const uint8_t* pixels, int components, const AlphaInfo* spriteAlphas,
+	ShaderType shaderType, int count, Vector2* mins, Vector2* maxes, int* retIDs )
+{
+	if( count <= 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Attempting to split texture into no images." );
+		deleteTexture( texture->textureID );
+		return -1;
+	}
+
+	int packageID = allocatePackage( texture->textureID );
+	if( packageID < 0 ) {
+		deleteTexture( texture->textureID );
+		return -1;
+	}
+
 	Vector2 inverseSize;
 	inverseSize.x = 1.0f / (float)texture->width;
 	inverseSize.y = 1.0f / (float)texture->height;
 
+	int lastIdx = -1;
 	for( int i = 0; i < count; ++i ) {
-		int newIdx = findAvailableImageIndex( );
+		int newIdx = allocateImage( texture, shaderType );
 		if( newIdx < 0 ) {
 			SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Problem finding available image to split into." );
-			img_CleanPackage( packageID );
+			if( packages[packageID].firstImage >= 0 ) {
+				img_CleanPackage( packageID );
+			} else {
+				releasePackage( packageID );
+			}
 			return -1;
 		}
 
-		images[newIdx].textureObj = texture->textureID;
 		vec2_Subtract( &( maxes[i] ), &( mins[i] ), &( images[newIdx].size ) );
-		images[newIdx].offset = VEC2_ZERO;
-		images[newIdx].packageID = packageID;
-		images[newIdx].flags = IMGFLAG_IN_USE;
 		vec2_HadamardProd( &( mins[i] ), &inverseSize, &( images[newIdx].uvMin ) );
 		vec2_HadamardProd( &( maxes[i] ), &inverseSize, &( images[newIdx].uvMax ) );
-		images[newIdx].shaderType = shaderType;
-		if( texture->flags & TF_IS_TRANSPARENT ) {
-			images[newIdx].flags |= IMGFLAG_HAS_TRANSPARENCY;
+
+		AlphaInfo alpha;
+		if( spriteAlphas != NULL ) {
+			alpha = spriteAlphas[i];
+		} else {
+			classifySprite( texture, pixels, components, &( mins[i] ), &( maxes[i] ), &alpha );
 		}
+		setImageAlpha( newIdx, alpha.flags, alpha.opaqueMin, alpha.opaqueMax );
 
-		retIDs[i] = newIdx;
+		// add to the end of the package so cleaning it up goes through the images in the order they were created
+		images[newIdx].packageID = packageID;
+		images[newIdx].prevInPackage = lastIdx;
+		if( lastIdx >= 0 ) {
+			images[lastIdx].nextInPackage = newIdx;
+		} else {
+			packages[packageID].firstImage = newIdx;
+		}
+		lastIdx = newIdx;
+
+		retIDs[i] = makeImageID( newIdx );
 	}
 
-	return 0;
+	return packageID;
+}
+
+/*
+Takes in an existing texture and some rectangles. It's assumed the length of mins, maxes, and retIDs equals count. The
+ package takes ownership of the texture. spriteAlphas holds the alpha for each rectangle, if it's NULL the images use the
+ flags of the texture.
+ Returns package ID used to clean up later, returns -1 if there's a problem.
+*/
+int img_SplitTexture( Texture* texture, const AlphaInfo* spriteAlphas, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs )
+{
+	return split( texture, NULL, 0, spriteAlphas, shaderType, count, mins, maxes, retIDs );
 }
 
 /*
@@ -276,19 +604,92 @@ Takes in a file name and some rectangles. It's assumed the length of mins, maxes
 */
 int img_SplitImageFile( char* fileName, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs )
 {
-	int currPackageID = findUnusedPackage( );
+	uint8_t* pixels;
+	int width, height;
+	if( gfxUtil_DecodeImageFile( fileName, &pixels, &width, &height ) < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Problem loading image %s", fileName );
+		return -1;
+	}
 
+	// keep the pixels around so each sprite can be classified on its own
+	AlphaInfo alpha;
 	Texture texture;
-	if( gfxUtil_LoadTexture( fileName, &texture ) < 0 ) {
-		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Problem loading image %s", fileName );
+	gfxUtil_ClassifyAlpha( pixels, width, height, 4, &alpha );
+	if( gfxUtil_UploadRGBATexture( pixels, width, height, &alpha, 0, &texture ) < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Problem creating texture for image %s", fileName );
+		gfxUtil_ReleaseDecodedImage( pixels );
 		return -1;
 	}
+	texMgr_SetSourceFile( texture.textureID, fileName );
+
+	int packageID = split( &texture, pixels, 4, NULL, shaderType, count, mins, maxes, retIDs );
+	gfxUtil_ReleaseDecodedImage( pixels );
+	return packageID;
+}
+
+static void packageLoaded( Texture* texture, const uint8_t* pixels, void* data )
+{
+	int packageRef = (int)(intptr_t)data;
+	int packageID = ( packageRef & IMAGE_INDEX_MASK );
+	if( !packages[packageID].inUse || ( packages[packageID].generation != ( packageRef >> IMAGE_INDEX_BITS ) ) ) {
+		// cleaned up before it finished loading
+		if( texture != NULL ) {
+			gfxUtil_UnloadTexture( texture );
+		}
+		return;
+	}
+
+	// if it failed the placeholder is left in place
+	if( texture == NULL ) {
+		return;
+	}
 
-	if( split( &texture, currPackageID, shaderType, count, mins, maxes, retIDs ) < 0 ) {
+	packages[packageID].textureObj = texture->textureID;
+
+	Vector2 inverseSize;
+	inverseSize.x = 1.0f / (float)texture->width;
+	inverseSize.y = 1.0f / (float)texture->height;
+
+	for( int idx = packages[packageID].firstImage; idx >= 0; idx = images[idx].nextInPackage ) {
+		// while loading the uvs hold the pixel coordinates
+		AlphaInfo alpha;
+		classifySprite( texture, pixels, 4, &( images[idx].uvMin ), &( images[idx].uvMax ), &alpha );
+		setImageAlpha( idx, alpha.flags, alpha.opaqueMin, alpha.opaqueMax );
+
+		images[idx].textureObj = texture->textureID;
+		vec2_HadamardProd( &( images[idx].uvMin ), &inverseSize, &( images[idx].uvMin ) );
+		vec2_HadamardProd( &( images[idx].uvMax ), &inverseSize, &( images[idx].uvMax ) );
+	}
+}
+
+/*
+Takes in a file name and some rectangles, the file is loaded in the background. It's assumed the length of mins, maxes,
+ and retIDs equals count. The ids can be used immediately, a placeholder will be drawn until the image has finished loading.
+ Returns package ID used to clean up later, returns -1 if there's a problem.
+*/
+int img_SplitImageFileAsync( char* fileName, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs )
+{
+	// a one pixel texture, so the uvs will be the pixel coordinates until the image is loaded
+	Texture placeholder;
+	placeholder.textureID = placeholderTexture;
+	placeholder.width = 1;
+	placeholder.height = 1;
+	placeholder.flags = 0;
+	placeholder.opaqueMin = VEC2_ZERO;
+	placeholder.opaqueMax = VEC2_ONE;
+
+	int packageID = split( &placeholder, NULL, 0, NULL, shaderType, count, mins, maxes, retIDs );
+	if( packageID < 0 ) {
+		return -1;
+	}
+
+	int packageRef = ( ( packages[packageID].generation << IMAGE_INDEX_BITS ) | packageID );
+	if( texLoader_Queue( fileName, packageLoaded, (void*)(intptr_t)packageRef ) < 0 ) {
+		img_CleanPackage( packageID );
 		return -1;
 	}
 
-	return currPackageID;
+	return packageID;
 }
 
 /*
@@ -297,19 +698,13 @@ Takes in an RGBA bitmap and some rectangles. It's assumed the length of mins, ma
 */
 int img_SplitRGBABitmap( uint8_t* data, int width, int height, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs )
 {
-	int currPackageID = findUnusedPackage( );
-
 	Texture texture;
 	if( gfxUtil_CreateTextureFromRGBABitmap( data, width, height, &texture ) < 0 ) {
 		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Problem creating RGBA bitmap texture." );
 		return -1;
 	}
 
-	if( split( &texture, currPackageID, shaderType, count, mins, maxes, retIDs ) < 0 ) {
-		return -1;
-	}
-
-	return currPackageID;
+	return split( &texture, data, 4, NULL, shaderType, count, mins, maxes, retIDs );
 }
 
 /*
@@ -318,19 +713,13 @@ Takes in a one channel bitmap and some rectangles. It's assume the length of the
 */
 int img_SplitAlphaBitmap( uint8_t* data, int width, int height, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs )
 {
-	int currPackageID = findUnusedPackage( );
-
 	Texture texture;
 	if( gfxUtil_CreateTextureFromAlphaBitmap( data, width, height, &texture ) < 0 ) {
 		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Problem creating alpha bitmap texture." );
 		return -1;
 	}
 
-	if( split( &texture, currPackageID, shaderType, count, mins, maxes, retIDs ) < 0 ) {
-		return -1;
-	}
-
-	return currPackageID;
+	return split( &texture, data, 1, NULL, shaderType, count, mins, maxes, retIDs );
 }
 
 /*
@@ -338,22 +727,25 @@ Cleans up all the images in an image package.
 */
 void img_CleanPackage( int packageID )
 {
-	for( int i = 0; i < MAX_IMAGES; ++i ) {
-		if( ( images[i].flags & IMGFLAG_IN_USE ) && ( images[i].packageID == packageID ) ) {
-			img_Clean( i );
-		}
+	if( ( packageID < 0 ) || ( packageID >= MAX_PACKAGES ) || !packages[packageID].inUse ) {
+		return;
+	}
+
+	// the package is destroyed along with the last image
+	while( packages[packageID].inUse ) {
+		img_Clean( makeImageID( packages[packageID].firstImage ) );
 	}
 }
 
 /*
 Sets an offset to render the image from. The default is the center of the image.
 */
-void img_SetOffset( int idx, Vector2 offset )
+void img_SetOffset( int imgID, Vector2 offset )
 {
-	assert( idx < MAX_IMAGES );
+	int idx = imageIDToIndex( imgID );
 	assert( idx >= 0 );
 
-	if( ( idx < 0 ) || ( !( images[idx].flags & IMGFLAG_IN_USE ) ) || ( idx >= MAX_IMAGES ) ) {
+	if( idx < 0 ) {
 		return;
 	}
 
@@ -363,13 +755,14 @@ void img_SetOffset( int idx, Vector2 offset )
 /*
 Gets the size of the image, putting it into the out Vector2. Returns a negative number if there's an issue.
 */
-int img_GetSize( int idx, Vector2* out )
+int img_GetSize( int imgID, Vector2* out )
 {
 	assert( out != NULL );
-	assert( idx < MAX_IMAGES );
+
+	int idx = imageIDToIndex( imgID );
 	assert( idx >= 0 );
 
-	if( ( idx < 0 ) || ( !( images[idx].flags & IMGFLAG_IN_USE ) ) || ( idx >= MAX_IMAGES ) ) {
+	if( idx < 0 ) {
 		return -1;
 	}
 
@@ -378,83 +771,73 @@ int img_GetSize( int idx, Vector2* out )
 }
 
 /*
-initializes the structure so only what's used needs to be set, also fill in
-  some stuff that all of the queueRenderImage functions use, returns the pointer
-  for further setting of other stuff
- returns NULL if there's a problem
+Adds an entry to the draw list with the values all of the img_Draw functions use.
+ Returns the index of the entry, a negative value if there's a problem.
 */
-static DrawInstruction* GetNextRenderInstruction( int imgObj, unsigned int camFlags, Vector2 startPos, Vector2 endPos, char depth )
+static int nextDrawInstruction( int imgID, unsigned int camFlags, Vector2 startPos, Vector2 endPos, char depth )
 {
-	if( !( images[imgObj].flags & IMGFLAG_IN_USE ) ) {
-		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Attempting to draw invalid image: %i", imgObj );
-		return NULL;
+	if( imageIDToIndex( imgID ) < 0 ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Attempting to draw invalid image: %i", imgID );
+		return -1;
 	}
 
-	++lastDrawInstruction;
-	if( lastDrawInstruction >= MAX_RENDER_INSTRUCTIONS ) {
+	if( ( lastDrawInstruction + 1 ) >= MAX_RENDER_INSTRUCTIONS ) {
 		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Render instruction queue full." );
-		return NULL;
+		return -1;
 	}
+	++lastDrawInstruction;
 
-	DrawInstruction* ri = &( renderBuffer[lastDrawInstruction] );
-
-	*ri = DEFAULT_DRAW_INSTRUCTION;
-	ri->textureObj = images[imgObj].textureObj;
-	ri->imageObj = imgObj;
-	ri->start.pos = startPos;
-	ri->end.pos = endPos;
-	ri->start.scaleSize = images[imgObj].size;
-	ri->end.scaleSize = images[imgObj].size;
-	ri->start.color = CLR_WHITE;
-	ri->end.color = CLR_WHITE;
-	ri->start.rotation = 0.0f;
-	ri->end.rotation = 0.0f;
-	ri->offset = images[imgObj].offset;
-	ri->flags = images[imgObj].flags;
-	ri->camFlags = camFlags;
-	ri->shaderType = images[imgObj].shaderType;
-	ri->depth = depth;
-	memcpy( ri->uvs, DEFAULT_DRAW_INSTRUCTION.uvs, sizeof( ri->uvs ) );
-
-	ri->uvs[0] = images[imgObj].uvMin;
-
-	ri->uvs[1].x = images[imgObj].uvMin.x;
-	ri->uvs[1].y = images[imgObj].uvMax.y;
-
-	ri->uvs[2].x = images[imgObj].uvMax.x;
-	ri->uvs[2].y = images[imgObj].uvMin.y;
-
-	ri->uvs[3] = images[imgObj].uvMax;
+	int idx = lastDrawInstruction;
+	drawImageIDs[idx] = imgID;
+	drawCamFlags[idx] = camFlags;
+	drawDepths[idx] = depth;
+	drawImgFlags[idx] = 0;
+	drawPositions[idx].start = startPos;
+	drawPositions[idx].end = endPos;
+	drawFlags[idx] = ( ( startPos.x != endPos.x ) || ( startPos.y != endPos.y ) ) ? DIF_LERP_POS : 0;
 
-	return ri;
+	return idx;
 }
 
 /*
 Adds to the list of images to draw.
 */
 #define DRAW_INSTRUCTION_START \
-	DrawInstruction* ri = GetNextRenderInstruction( imgID, camFlags, startPos, endPos, depth ); \
-	if( ri == NULL ) { return -1; }
+	int di = nextDrawInstruction( imgID, camFlags, startPos, endPos, depth ); \
+	if( di < 0 ) { return -1; }
 
 #define DRAW_INSTRUCTION_END \
 	return 0;
 
 #define SET_DRAW_INSTRUCTION_SCALE( startX, startY, endX, endY ) \
-	ri->start.scaleSize.x *= startX; \
-	ri->start.scaleSize.y *= startY; \
-	ri->end.scaleSize.x *= endX; \
-	ri->end.scaleSize.y *= endY;
+	drawScales[di].start.x = startX; \
+	drawScales[di].start.y = startY; \
+	drawScales[di].end.x = endX; \
+	drawScales[di].end.y = endY; \
+	drawFlags[di] |= DIF_SCALED; \
+	if( ( drawScales[di].start.x != drawScales[di].end.x ) || ( drawScales[di].start.y != drawScales[di].end.y ) ) { \
+		drawFlags[di] |= DIF_LERP_SCALE; }
 
 #define SET_DRAW_INSTRUCTION_COLOR( startColor, endColor ) \
-	ri->start.color = startColor; \
-	ri->end.color = endColor; \
+	drawColors[di].start = startColor; \
+	drawColors[di].end = endColor; \
+	drawFlags[di] |= DIF_COLORED; \
+	if( ( startColor.r != endColor.r ) || ( startColor.g != endColor.g ) || \
+		( startColor.b != endColor.b ) || ( startColor.a != endColor.a ) ) { \
+		drawFlags[di] |= DIF_LERP_COLOR; } \
 	if( ( ( startColor.a > 0 ) && ( startColor.a < 1.0f ) ) || \
 		( ( endColor.a > 0 ) && ( endColor.a < 1.0f ) )) { \
-		ri->flags |= IMGFLAG_HAS_TRANSPARENCY; }
+		drawImgFlags[di] |= IMGFLAG_HAS_TRANSPARENCY; } \
+	if( ( startColor.a <= 0.0f ) || ( endColor.a <= 0.0f ) ) { \
+		drawImgFlags[di] |= IMGFLAG_HAS_CLEAR_PIXELS; }
 
 #define SET_DRAW_INSTRUCTION_ROT( startRot, endRot ) \
-	ri->start.rotation = startRot; \
-	ri->end.rotation = endRot;
+	drawRotations[di].start = startRot; \
+	drawRotations[di].end = endRot; \
+	drawFlags[di] |= DIF_ROTATED; \
+	if( startRot != endRot ) { \
+		drawFlags[di] |= DIF_LERP_ROT; }
+
 
 int img_Draw( int imgID, unsigned int camFlags, Vector2 startPos, Vector2 endPos, char depth )
 {
@@ -555,8 +938,160 @@ int img_Draw_sv_c_r( int imgID, unsigned int camFlags, Vector2 startPos, Vector2
 	DRAW_INSTRUCTION_END;
 }
 
-#undef DRAW_INSTRUCTION_QUEUE_START
-#undef DRAW_INSTRUCTION_QUEUE_END
+/*
+Reserves a contiguous block of entries in the draw list. Returns the index of the first entry, the number of entries
+ reserved is put into outCount and may be less than count if the list is full.
+*/
+static int reserveDrawInstructions( int count, int* outCount )
+{
+	int first = lastDrawInstruction + 1;
+	int available = MAX_RENDER_INSTRUCTIONS - first;
+
+	(*outCount) = count;
+	if( count > available ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Render instruction queue full." );
+		(*outCount) = available;
+	}
+
+	lastDrawInstruction += (*outCount);
+	return first;
+}
+
+/*
+Fills in a block of the draw list, endPositions, the scales, and the rotations can be NULL. Invalid image ids aren't
+ checked here, they're skipped when rendering.
+*/
+static int drawBatch( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startScales, const float* endScales, const float* startRots, const float* endRots, int count, char depth )
+{
+	assert( imgIDs != NULL );
+	assert( startPositions != NULL );
+
+	if( count <= 0 ) {
+		return 0;
+	}
+
+	int reserved;
+	int first = reserveDrawInstructions( count, &reserved );
+
+	memcpy( &( drawImageIDs[first] ), imgIDs, sizeof( imgIDs[0] ) * reserved );
+	memset( &( drawDepths[first] ), depth, sizeof( drawDepths[0] ) * reserved );
+	memset( &( drawImgFlags[first] ), 0, sizeof( drawImgFlags[0] ) * reserved );
+
+	for( int i = 0; i < reserved; ++i ) {
+		int di = first + i;
+		drawCamFlags[di] = camFlags;
+		drawPositions[di].start = startPositions[i];
+		if( endPositions != NULL ) {
+			drawPositions[di].end = endPositions[i];
+			drawFlags[di] = ( ( startPositions[i].x != endPositions[i].x ) || ( startPositions[i].y != endPositions[i].y ) ) ? DIF_LERP_POS : 0;
+		} else {
+			drawPositions[di].end = startPositions[i];
+			drawFlags[di] = 0;
+		}
+
+		if( startScales != NULL ) {
+			float endScale = ( endScales != NULL ) ? endScales[i] : startScales[i];
+			SET_DRAW_INSTRUCTION_SCALE( startScales[i], startScales[i], endScale, endScale );
+		}
+
+		if( startRots != NULL ) {
+			float endRot = ( endRots != NULL ) ? endRots[i] : startRots[i];
+			SET_DRAW_INSTRUCTION_ROT( startRots[i], endRot );
+		}
+	}
+
+	return ( reserved < count ) ? -1 : 0;
+}
+
+/*
+Adds a group of images to the list of images to draw in one contiguous block. All the arrays are expected to have
+ count entries, endPositions can be NULL if the images don't move. The end scales and rotations can be NULL if they
+ don't change.
+ Returns <0 if the draw list filled up before all the images could be added.
+*/
+int img_DrawBatch( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	int count, char depth )
+{
+	return drawBatch( imgIDs, camFlags, startPositions, endPositions, NULL, NULL, NULL, NULL, count, depth );
+}
+
+int img_DrawBatch_s( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startScales, const float* endScales, int count, char depth )
+{
+	return drawBatch( imgIDs, camFlags, startPositions, endPositions, startScales, endScales, NULL, NULL, count, depth );
+}
+
+int img_DrawBatch_r( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startRots, const float* endRots, int count, char depth )
+{
+	return drawBatch( imgIDs, camFlags, startPositions, endPositions, NULL, NULL, startRots, endRots, count, depth );
+}
+
+int img_DrawBatch_s_r( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startScales, const float* endScales, const float* startRots, const float* endRots, int count, char depth )
+{
+	return drawBatch( imgIDs, camFlags, startPositions, endPositions, startScales, endScales, startRots, endRots, count, depth );
+}
+
+/*
+Adds a run of glyphs to the list of images to draw, they all share the same scale and color and each one is centered
+ at the position plus its offset. The whole run takes a single entry in the draw list, and as glyphs are never rotated
+ the quads are built without a transform. The offsets aren't scaled.
+ Returns <0 if the draw list filled up before all the glyphs could be added.
+*/
+int img_DrawGlyphRun( const int* imgIDs, const Vector2* offsets, int count, unsigned int camFlags, Vector2 startPos,
+	Vector2 endPos, float scale, Color color, char depth )
+{
+	assert( imgIDs != NULL );
+	assert( offsets != NULL );
+
+	if( count <= 0 ) {
+		return 0;
+	}
+
+	if( ( ( lastDrawInstruction + 1 ) >= MAX_RENDER_INSTRUCTIONS ) || ( ( lastGlyphRun + 1 ) >= MAX_GLYPH_RUNS ) ||
+		( numRunGlyphs >= MAX_RUN_GLYPHS ) ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Render instruction queue full." );
+		return -1;
+	}
+
+	int reserved = count;
+	if( ( numRunGlyphs + count ) > MAX_RUN_GLYPHS ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Glyph run storage full." );
+		reserved = MAX_RUN_GLYPHS - numRunGlyphs;
+	}
+
+	++lastGlyphRun;
+	GlyphRun* run = &( glyphRuns[lastGlyphRun] );
+	run->firstGlyph = numRunGlyphs;
+	run->count = reserved;
+	memcpy( &( runGlyphIDs[numRunGlyphs] ), imgIDs, sizeof( imgIDs[0] ) * reserved );
+	memcpy( &( runGlyphOffsets[numRunGlyphs] ), offsets, sizeof( offsets[0] ) * reserved );
+	numRunGlyphs += reserved;
+
+	++lastDrawInstruction;
+	int di = lastDrawInstruction;
+	drawImageIDs[di] = lastGlyphRun;
+	drawCamFlags[di] = camFlags;
+	drawDepths[di] = depth;
+	drawImgFlags[di] = 0;
+	drawPositions[di].start = startPos;
+	drawPositions[di].end = endPos;
+	drawFlags[di] = DIF_GLYPH_RUN;
+	if( ( startPos.x != endPos.x ) || ( startPos.y != endPos.y ) ) {
+		drawFlags[di] |= DIF_LERP_POS;
+	}
+	if( scale != 1.0f ) {
+		SET_DRAW_INSTRUCTION_SCALE( scale, scale, scale, scale );
+	}
+	SET_DRAW_INSTRUCTION_COLOR( color, color );
+
+	return ( reserved < count ) ? -1 : 0;
+}
+
+#undef DRAW_INSTRUCTION_START
+#undef DRAW_INSTRUCTION_END
 #undef SET_DRAW_INSTRUCTION_SCALE
 #undef SET_DRAW_INSTRUCTION_COLOR
 #undef SET_DRAW_INSTRUCTION_ROT
@@ -567,6 +1102,8 @@ Clears the image draw list.
 void img_ClearDrawInstructions( void )
 {
 	lastDrawInstruction = -1;
+	lastGlyphRun = -1;
+	numRunGlyphs = 0;
 }
 
 static void createRenderTransform( Vector2* pos, Vector2* scale, float rot,  Vector2* offset, Matrix4* out )
@@ -590,12 +1127,125 @@ static void createRenderTransform( Vector2* pos, Vector2* scale, float rot,  Vec
 	//out->m[14] = -pos->v[2];
 }
 
+/*
+Gets the uvs for the corners of the trimmed quad, in the same order as the vertices.
+*/
+static void getTrimmedUVs( const Image* img, Vector2* outUVs )
+{
+	Vector2 uvRange, uvMin, uvMax;
+	vec2_Subtract( &( img->uvMax ), &( img->uvMin ), &uvRange );
+	uvMin.x = img->uvMin.x + ( uvRange.x * img->trimMin.x );
+	uvMin.y = img->uvMin.y + ( uvRange.y * img->trimMin.y );
+	uvMax.x = img->uvMin.x + ( uvRange.x * img->trimMax.x );
+	uvMax.y = img->uvMin.y + ( uvRange.y * img->trimMax.y );
+
+	outUVs[0] = uvMin;
+	outUVs[1].x = uvMin.x;
+	outUVs[1].y = uvMax.y;
+	outUVs[2].x = uvMax.x;
+	outUVs[2].y = uvMin.y;
+	outUVs[3] = uvMax;
+}
+
+static TransparencyType getTransparency( int imgFlags )
+{
+	if( imgFlags & IMGFLAG_HAS_TRANSPARENCY ) {
+		return TT_TRANSLUCENT;
+	} else if( imgFlags & IMGFLAG_HAS_CLEAR_PIXELS ) {
+		return TT_ALPHA_TEST;
+	}
+	return TT_OPAQUE;
+}
+
+/*
+Draws every glyph in a run. Glyphs are never rotated, so the corners are found by adding the trimmed size to the
+ position, there's no need for a transform.
+*/
+static void renderGlyphRun( int idx, float normTimeElapsed )
+{
+	const GlyphRun* run = &( glyphRuns[drawImageIDs[idx]] );
+	int flags = drawFlags[idx];
+
+	Vector2 pos;
+	if( flags & DIF_LERP_POS ) {
+		vec2_Lerp( &( drawPositions[idx].start ), &( drawPositions[idx].end ), normTimeElapsed, &pos );
+	} else {
+		pos = drawPositions[idx].start;
+	}
+
+	float scale = 1.0f;
+	if( flags & DIF_LERP_SCALE ) {
+		scale = lerp( drawScales[idx].start.x, drawScales[idx].end.x, normTimeElapsed );
+	} else if( flags & DIF_SCALED ) {
+		scale = drawScales[idx].start.x;
+	}
+
+	Color col;
+	if( flags & DIF_LERP_COLOR ) {
+		clr_Lerp( &( drawColors[idx].start ), &( drawColors[idx].end ), normTimeElapsed, &col );
+	} else if( flags & DIF_COLORED ) {
+		col = drawColors[idx].start;
+	} else {
+		col = CLR_WHITE;
+	}
+
+	unsigned int camFlags = drawCamFlags[idx];
+	char depth = drawDepths[idx];
+	GLuint lastTexture = 0;
+
+	for( int i = 0; i < run->count; ++i ) {
+		int g = run->firstGlyph + i;
+
+		// the glyph may have been evicted from its atlas since this was queued
+		int imgIdx = imageIDToIndex( runGlyphIDs[g] );
+		if( imgIdx < 0 ) {
+			continue;
+		}
+		const Image* img = &( images[imgIdx] );
+
+		if( ( img->trimMax.x <= img->trimMin.x ) || ( img->trimMax.y <= img->trimMin.y ) ) {
+			continue;
+		}
+
+		// glyphs almost always come from the same atlas
+		if( img->textureObj != lastTexture ) {
+			texMgr_MarkUsed( img->textureObj );
+			lastTexture = img->textureObj;
+		}
+
+		Vector2 center, size;
+		center.x = pos.x + runGlyphOffsets[g].x + img->offset.x;
+		center.y = pos.y + runGlyphOffsets[g].y + img->offset.y;
+		size.x = img->size.x * scale;
+		size.y = img->size.y * scale;
+
+		Vector2 min, max;
+		min.x = center.x + ( ( img->trimMin.x - 0.5f ) * size.x );
+		min.y = center.y + ( ( img->trimMin.y - 0.5f ) * size.y );
+		max.x = center.x + ( ( img->trimMax.x - 0.5f ) * size.x );
+		max.y = center.y + ( ( img->trimMax.y - 0.5f ) * size.y );
+
+		Vector2 verts[4];
+		verts[0] = min;
+		verts[1].x = min.x;
+		verts[1].y = max.y;
+		verts[2].x = max.x;
+		verts[2].y = min.y;
+		verts[3] = max;
+
+		Vector2 uvs[4];
+		getTrimmedUVs( img, uvs );
+		TransparencyType transparency = getTransparency( img->flags | drawImgFlags[idx] );
+
+		triRenderer_AddQuad( verts, uvs, img->shaderType, img->textureObj, col, camFlags, depth, transparency );
+	}
+}
+
 /*
 Draw all the images.
 */
 void img_Render( float normTimeElapsed )
 {
-	Vector2 unitSqVertPos[] = { { -0.5f, -0.5f }, { -0.5f, 0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f } };
 	GLuint indices[] = {
 		0, 1, 2,
 		1, 2, 3,
@@ -603,6 +1253,27 @@ void img_Render( float normTimeElapsed )
 
 	for( int idx = 0; idx <= lastDrawInstruction; ++idx ) {
 		Vector2 verts[4];
+		Vector2 uvs[4];
+
+		if( drawFlags[idx] & DIF_GLYPH_RUN ) {
+			renderGlyphRun( idx, normTimeElapsed );
+			continue;
+		}
+
+		// the image may have been cleaned up since this was queued
+		int imgIdx = imageIDToIndex( drawImageIDs[idx] );
+		if( imgIdx < 0 ) {
+			continue;
+		}
+		Image* img = &( images[imgIdx] );
+		int flags = drawFlags[idx];
+
+		// nothing to see if every pixel is clear
+		if( ( img->trimMax.x <= img->trimMin.x ) || ( img->trimMax.y <= img->trimMin.y ) ) {
+			continue;
+		}
+
+		texMgr_MarkUsed( img->textureObj );
 
 		// generate the sprites matrix
 		Matrix4 modelTf;
@@ -610,26 +1281,58 @@ void img_Render( float normTimeElapsed )
 		float rot;
 		Color col;
 
-		vec2_Lerp( &( renderBuffer[idx].start.pos ), &( renderBuffer[idx].end.pos ), normTimeElapsed, &pos );
-		clr_Lerp( &( renderBuffer[idx].start.color ), &( renderBuffer[idx].end.color ), normTimeElapsed, &col );
-		vec2_Lerp( &( renderBuffer[idx].start.scaleSize ), &( renderBuffer[idx].end.scaleSize ), normTimeElapsed, &sclSz );
+		if( flags & DIF_LERP_POS ) {
+			vec2_Lerp( &( drawPositions[idx].start ), &( drawPositions[idx].end ), normTimeElapsed, &pos );
+		} else {
+			pos = drawPositions[idx].start;
+		}
+
+		sclSz = img->size;
+		if( flags & DIF_LERP_SCALE ) {
+			Vector2 scale;
+			vec2_Lerp( &( drawScales[idx].start ), &( drawScales[idx].end ), normTimeElapsed, &scale );
+			vec2_HadamardProd( &sclSz, &scale, &sclSz );
+		} else if( flags & DIF_SCALED ) {
+			vec2_HadamardProd( &sclSz, &( drawScales[idx].start ), &sclSz );
+		}
+
+		if( flags & DIF_LERP_COLOR ) {
+			clr_Lerp( &( drawColors[idx].start ), &( drawColors[idx].end ), normTimeElapsed, &col );
+		} else if( flags & DIF_COLORED ) {
+			col = drawColors[idx].start;
+		} else {
+			col = CLR_WHITE;
+		}
+
+		if( flags & DIF_LERP_ROT ) {
+			rot = radianRotLerp( drawRotations[idx].start, drawRotations[idx].end, normTimeElapsed );
+		} else if( flags & DIF_ROTATED ) {
+			rot = drawRotations[idx].start;
+		} else {
+			rot = 0.0f;
+		}
+
+		createRenderTransform( &pos, &sclSz, rot, &( img->offset ), &modelTf );
 
-		rot = radianRotLerp( renderBuffer[idx].start.rotation, renderBuffer[idx].end.rotation, normTimeElapsed );
-		createRenderTransform( &pos, &sclSz, rot, &renderBuffer[idx].offset, &modelTf );
+		// only the trimmed part of the unit square is drawn, with the uvs cut down to match
+		Vector2 vertPos[4];
+		vertPos[0].x = vertPos[1].x = img->trimMin.x - 0.5f;
+		vertPos[2].x = vertPos[3].x = img->trimMax.x - 0.5f;
+		vertPos[0].y = vertPos[2].y = img->trimMin.y - 0.5f;
+		vertPos[1].y = vertPos[3].y = img->trimMax.y - 0.5f;
 
 		for( int i = 0; i < 4; ++i ) {
-			mat4_TransformVec2Pos( &modelTf, &( unitSqVertPos[i] ), &( verts[i] ) );
+			mat4_TransformVec2Pos( &modelTf, &( vertPos[i] ), &( verts[i] ) );
 		}
 
-		int transparent = ( renderBuffer[idx].flags & IMGFLAG_HAS_TRANSPARENCY ) != 0;
+		getTrimmedUVs( img, uvs );
+		TransparencyType transparency = getTransparency( img->flags | drawImgFlags[idx] );
 
 		triRenderer_Add( verts[indices[0]], verts[indices[1]], verts[indices[2]],
-			renderBuffer[idx].uvs[indices[0]], renderBuffer[idx].uvs[indices[1]], renderBuffer[idx].uvs[indices[2]],
-			renderBuffer[idx].shaderType, renderBuffer[idx].textureObj, col, renderBuffer[idx].camFlags, renderBuffer[idx].depth,
-			transparent );
+			uvs[indices[0]], uvs[indices[1]], uvs[indices[2]],
+			img->shaderType, img->textureObj, col, drawCamFlags[idx], drawDepths[idx], transparency );
 		triRenderer_Add( verts[indices[3]], verts[indices[4]], verts[indices[5]],
-			renderBuffer[idx].uvs[indices[3]], renderBuffer[idx].uvs[indices[4]], renderBuffer[idx].uvs[indices[5]],
-			renderBuffer[idx].shaderType, renderBuffer[idx].textureObj, col, renderBuffer[idx].camFlags, renderBuffer[idx].depth,
-			transparent );
+			uvs[indices[3]], uvs[indices[4]], uvs[indices[5]],
+			img->shaderType, img->textureObj, col, drawCamFlags[idx], drawDepths[idx], transparency );
 	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "../Math/vector2.h"
 #include "color.h"
 #include "triRendering.h"
+#include "gfxUtil.h"
 
 /*
 Initializes images.
@@ -14,20 +15,50 @@ int img_Init( void );
 
 /*
 Loads the image stored at file name.
- Returns the index of the image on success.
+ Returns the id of the image on success.
  Returns -1 on failure, and prints a message to the log.
 */
 int img_Load( const char* fileName, ShaderType shaderType );
 
+/*
+Loads the image stored at file name in the background. The id can be used immediately, a placeholder will be drawn
+ until the image has finished loading.
+ Returns the id of the image on success.
+ Returns -1 on failure, and prints a message to the log.
+*/
+int img_LoadAsync( const char* fileName, ShaderType shaderType );
+
 /*
 Creates an image from a surface.
 */
 int img_Create( SDL_Surface* surface, ShaderType shaderType );
 
 /*
-Cleans up an image at the specified index, trying to render with it after this won't work.
+Creates an image from an existing texture, the image takes ownership of the texture and will destroy it when it's
+ cleaned up.
+ Returns the id of the image on success, -1 on failure.
+*/
+int img_CreateFromTexture( Texture* texture, ShaderType shaderType );
+
+/*
+Creates an image from part of a texture that's owned by something else, cleaning up the image won't destroy the
+ texture. min and max are the corners of the rectangle in pixels, alpha is for the pixels in the rectangle.
+ Returns the id of the image on success, -1 on failure.
+*/
+int img_CreateFromTextureRect( Texture* texture, Vector2 min, Vector2 max, const AlphaInfo* alpha, ShaderType shaderType );
+
+/*
+Cleans up an image with the specified id, trying to render with it after this won't work.
+*/
+void img_Clean( int imgID );
+
+/*
+Takes in an existing texture and some rectangles. It's assumed the length of mins, maxes, and retIDs equals count. The
+ package takes ownership of the texture. spriteAlphas holds the alpha for each rectangle, if it's NULL the images use the
+ flags of the texture.
+ Returns package ID used to clean up later, returns -1 if there's a problem.
 */
-void img_Clean( int idx );
+int img_SplitTexture( Texture* texture, const AlphaInfo* spriteAlphas, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs );
 
 /*
 Takes in a file name and some rectangles. It's assumed the length of mins, maxes, and retIDs equals count.
@@ -35,6 +66,13 @@ Takes in a file name and some rectangles. It's assumed the length of mins, maxes
 */
 int img_SplitImageFile( char* fileName, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs );
 
+/*
+Takes in a file name and some rectangles, the file is loaded in the background. It's assumed the length of mins, maxes,
+ and retIDs equals count. The ids can be used immediately, a placeholder will be drawn until the image has finished loading.
+ Returns package ID used to clean up later, returns -1 if there's a problem.
+*/
+int img_SplitImageFileAsync( char* fileName, int count, ShaderType shaderType, Vector2* mins, Vector2* maxes, int* retIDs );
+
 /*
 Takes in an RGBA bitmap and some rectangles. It's assumed the length of mins, maxes, and retIDs equals count.
  Returns package ID used to clean up later, returns -1 if there's a problem.
@@ -55,12 +93,12 @@ void img_CleanPackage( int packageID );
 /*
 Sets an offset to render the image from. The default is the center of the image.
 */
-void img_SetOffset( int idx, Vector2 offset );
+void img_SetOffset( int imgID, Vector2 offset );
 
 /*
 Gets the size of the image, putting it into the out Vector2. Returns a negative number if there's an issue.
 */
-int img_GetSize( int idx, Vector2* out );
+int img_GetSize( int imgID, Vector2* out );
 
 /*
 Adds to the list of images to draw.
@@ -85,6 +123,30 @@ int img_Draw_s_c_r( int imgID, unsigned int camFlags, Vector2 startPos, Vector2
 int img_Draw_sv_c_r( int imgID, unsigned int camFlags, Vector2 startPos, Vector2 endPos, Vector2 startScale, Vector2 endScale,
 	Color startColor, Color endColor, float startRot, float endRot, char depth );
 
+/*
+Adds a group of images to the list of images to draw in one contiguous block. All the arrays are expected to have
+ count entries, endPositions can be NULL if the images don't move. The end scales and rotations can be NULL if they
+ don't change.
+ Returns <0 if the draw list filled up before all the images could be added.
+*/
+int img_DrawBatch( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	int count, char depth );
+int img_DrawBatch_s( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startScales, const float* endScales, int count, char depth );
+int img_DrawBatch_r( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startRots, const float* endRots, int count, char depth );
+int img_DrawBatch_s_r( const int* imgIDs, unsigned int camFlags, const Vector2* startPositions, const Vector2* endPositions,
+	const float* startScales, const float* endScales, const float* startRots, const float* endRots, int count, char depth );
+
+/*
+Adds a run of glyphs to the list of images to draw, they all share the same scale and color and each one is centered
+ at the position plus its offset. The whole run takes a single entry in the draw list, and as glyphs are never rotated
+ the quads are built without a transform. The offsets aren't scaled.
+ Returns <0 if the draw list filled up before all the glyphs could be added.
+*/
+int img_DrawGlyphRun( const int* imgIDs, const Vector2* offsets, int count, unsigned int camFlags, Vector2 startPos,
+	Vector2 endPos, float scale, Color color, char depth );
+
 /*
 Clears the image draw list.
 */
@@ -0,0 +1,293 @@
+#include "renderCapture.h"
+
+#include <SDL_log.h>
+#include <SDL_rwops.h>
+#include <string.h>
+
+#include "camera.h"
+#include "glDebugging.h"
+#include "../System/memory.h"
+#include "../Utils/stretchyBuffer.h"
+
+#define CAPTURE_MAGIC "RCAP"
+#define CAPTURE_VERSION 1
+#define MAX_FILE_NAME_LEN 256
+
+// the arrays follow the header in the order cameras, textures, then triangles
+typedef struct {
+	char magic[4];
+	int version;
+	int renderWidth;
+	int renderHeight;
+	int numCameras;
+	int numTextures;
+	int numTriangles;
+} CaptureHeader;
+
+static char requestedFileName[MAX_FILE_NAME_LEN];
+static int captureRequested = 0;
+static int capturing = 0;
+static RenderCapture currentCapture;
+
+/*
+Requests that the next frame rendered be captured and saved to the file.
+ Returns <0 if there's a problem.
+*/
+int renderCapture_Request( const char* fileName )
+{
+	if( captureRequested || capturing ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_RENDER, "Render capture already in progress, ignoring request for %s", fileName );
+		return -1;
+	}
+
+	if( SDL_strlen( fileName ) >= MAX_FILE_NAME_LEN ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Render capture file name too long: %s", fileName );
+		return -1;
+	}
+
+	SDL_strlcpy( requestedFileName, fileName, MAX_FILE_NAME_LEN );
+	captureRequested = 1;
+	return 0;
+}
+
+/*
+Starts capturing the frame if one was requested, call before anything is submitted to the triangle renderer.
+*/
+void renderCapture_BeginFrame( void )
+{
+	if( !captureRequested ) {
+		return;
+	}
+	captureRequested = 0;
+	capturing = 1;
+
+	memset( &currentCapture, 0, sizeof( currentCapture ) );
+	cam_GetWindowSize( &( currentCapture.renderWidth ), &( currentCapture.renderHeight ) );
+
+	for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
+		CapturedCamera cam;
+		Vector2 viewMin, viewMax;
+		int glX, glY;
+
+		cam.id = currCamera;
+		cam.flags = cam_GetFlags( currCamera );
+		cam_GetGLViewport( currCamera, &glX, &glY, &( cam.viewport[2] ), &( cam.viewport[3] ) );
+		cam.viewport[0] = glX;
+		cam.viewport[1] = currentCapture.renderHeight - ( glY + cam.viewport[3] );
+
+		// the view rect is offset by the viewport, so take it out to get the position of the camera
+		cam_GetViewRect( currCamera, &viewMin, &viewMax );
+		cam.pos.x = viewMin.x - (float)cam.viewport[0];
+		cam.pos.y = viewMin.y - (float)cam.viewport[1];
+
+		sb_Push( currentCapture.sbCameras, cam );
+	}
+}
+
+/*
+Returns whether the current frame is being captured.
+*/
+int renderCapture_IsCapturing( void )
+{
+	return capturing;
+}
+
+static int findTextureIndex( GLuint texture )
+{
+	for( int i = 0; i < sb_Count( currentCapture.sbTextures ); ++i ) {
+		if( currentCapture.sbTextures[i].id == texture ) {
+			return i;
+		}
+	}
+
+	CapturedTexture newTexture;
+	newTexture.id = texture;
+	newTexture.width = 0;
+	newTexture.height = 0;
+	sb_Push( currentCapture.sbTextures, newTexture );
+	return ( sb_Count( currentCapture.sbTextures ) - 1 );
+}
+
+/*
+Records a triangle submitted to the triangle renderer.
+*/
+void renderCapture_AddTriangle( Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2, ShaderType shader,
+	GLuint texture, Color color, int camFlags, char depth, TransparencyType transparency )
+{
+	if( !capturing ) {
+		return;
+	}
+
+	CapturedTriangle tri;
+	tri.positions[0] = pos0;
+	tri.positions[1] = pos1;
+	tri.positions[2] = pos2;
+	tri.uvs[0] = uv0;
+	tri.uvs[1] = uv1;
+	tri.uvs[2] = uv2;
+	tri.color = color;
+	tri.textureIdx = findTextureIndex( texture );
+	tri.camFlags = camFlags;
+	tri.shader = (int)shader;
+	tri.transparency = (int)transparency;
+	tri.depth = (int)depth;
+
+	sb_Push( currentCapture.sbTriangles, tri );
+}
+
+static int writeCapture( const char* fileName, RenderCapture* capture )
+{
+	CaptureHeader header;
+	memcpy( header.magic, CAPTURE_MAGIC, sizeof( header.magic ) );
+	header.version = CAPTURE_VERSION;
+	header.renderWidth = capture->renderWidth;
+	header.renderHeight = capture->renderHeight;
+	header.numCameras = sb_Count( capture->sbCameras );
+	header.numTextures = sb_Count( capture->sbTextures );
+	header.numTriangles = sb_Count( capture->sbTriangles );
+
+	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "wb" );
+	if( rwopsFile == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Unable to open render capture file %s: %s", fileName, SDL_GetError( ) );
+		return -1;
+	}
+
+	int success =
+		( SDL_RWwrite( rwopsFile, &header, sizeof( header ), 1 ) == 1 ) &&
+		( SDL_RWwrite( rwopsFile, capture->sbCameras, sizeof( CapturedCamera ), header.numCameras ) == (size_t)header.numCameras ) &&
+		( SDL_RWwrite( rwopsFile, capture->sbTextures, sizeof( CapturedTexture ), header.numTextures ) == (size_t)header.numTextures ) &&
+		( SDL_RWwrite( rwopsFile, capture->sbTriangles, sizeof( CapturedTriangle ), header.numTriangles ) == (size_t)header.numTriangles );
+
+	SDL_RWclose( rwopsFile );
+
+	if( !success ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Error writing render capture file %s: %s", fileName, SDL_GetError( ) );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Finishes the capture of the current frame and writes it out.
+*/
+void renderCapture_EndFrame( void )
+{
+	if( !capturing ) {
+		return;
+	}
+	capturing = 0;
+
+	// the replay will need textures of the same size so it samples the same amount of memory
+	for( int i = 0; i < sb_Count( currentCapture.sbTextures ); ++i ) {
+		GL( glBindTexture( GL_TEXTURE_2D, currentCapture.sbTextures[i].id ) );
+		GL( glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &( currentCapture.sbTextures[i].width ) ) );
+		GL( glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &( currentCapture.sbTextures[i].height ) ) );
+	}
+	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+
+	if( writeCapture( requestedFileName, &currentCapture ) >= 0 ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_RENDER, "Captured frame to %s: %i cameras, %i textures, %i triangles", requestedFileName,
+			sb_Count( currentCapture.sbCameras ), sb_Count( currentCapture.sbTextures ), sb_Count( currentCapture.sbTriangles ) );
+	}
+
+	renderCapture_Release( &currentCapture );
+}
+
+/*
+Loads a capture saved with renderCapture_Request.
+ Returns <0 if there's a problem.
+*/
+int renderCapture_Load( const char* fileName, RenderCapture* outCapture )
+{
+	CaptureHeader header;
+
+	memset( outCapture, 0, sizeof( *outCapture ) );
+
+	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "rb" );
+	if( rwopsFile == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Unable to open render capture file %s: %s", fileName, SDL_GetError( ) );
+		return -1;
+	}
+
+	if( ( SDL_RWread( rwopsFile, &header, sizeof( header ), 1 ) != 1 ) ||
+		( memcmp( header.magic, CAPTURE_MAGIC, sizeof( header.magic ) ) != 0 ) ||
+		( header.version != CAPTURE_VERSION ) ||
+		( header.numCameras < 0 ) || ( header.numCameras > NUM_CAMERAS ) ||
+		( header.numTextures < 0 ) || ( header.numTriangles < 0 ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "File %s is not a valid render capture", fileName );
+		SDL_RWclose( rwopsFile );
+		return -1;
+	}
+
+	outCapture->renderWidth = header.renderWidth;
+	outCapture->renderHeight = header.renderHeight;
+
+	int success =
+		( SDL_RWread( rwopsFile, sb_Add( outCapture->sbCameras, header.numCameras ), sizeof( CapturedCamera ), header.numCameras ) == (size_t)header.numCameras ) &&
+		( SDL_RWread( rwopsFile, sb_Add( outCapture->sbTextures, header.numTextures ), sizeof( CapturedTexture ), header.numTextures ) == (size_t)header.numTextures ) &&
+		( SDL_RWread( rwopsFile, sb_Add( outCapture->sbTriangles, header.numTriangles ), sizeof( CapturedTriangle ), header.numTriangles ) == (size_t)header.numTriangles );
+
+	SDL_RWclose( rwopsFile );
+
+	if( !success ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Render capture file %s is truncated", fileName );
+		renderCapture_Release( outCapture );
+		return -1;
+	}
+
+	for( int i = 0; i < header.numTriangles; ++i ) {
+		if( ( outCapture->sbTriangles[i].textureIdx < 0 ) || ( outCapture->sbTriangles[i].textureIdx >= header.numTextures ) ) {
+			SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Render capture file %s has an invalid texture index", fileName );
+			renderCapture_Release( outCapture );
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Frees everything allocated when loading the capture.
+*/
+void renderCapture_Release( RenderCapture* capture )
+{
+	sb_Release( capture->sbCameras );
+	sb_Release( capture->sbTextures );
+	sb_Release( capture->sbTriangles );
+	capture->sbCameras = NULL;
+	capture->sbTextures = NULL;
+	capture->sbTriangles = NULL;
+}
+
+/*
+Sets up all the cameras so they match what they were when the capture was made.
+*/
+void renderCapture_SetupCameras( RenderCapture* capture )
+{
+	cam_Init( );
+	cam_SetProjectionMatrices( capture->renderWidth, capture->renderHeight );
+
+	for( int i = 0; i < sb_Count( capture->sbCameras ); ++i ) {
+		CapturedCamera* cam = &( capture->sbCameras[i] );
+		cam_SetViewport( cam->id, cam->viewport[0], cam->viewport[1], cam->viewport[2], cam->viewport[3] );
+		cam_TurnOnFlags( cam->id, cam->flags );
+		cam_SetNextState( cam->id, cam->pos );
+	}
+
+	// the start and end states will be the same, so the cameras won't move
+	cam_FinalizeStates( 1.0f );
+}
+
+/*
+Submits all the triangles in the capture to the triangle renderer. The texture map is used to find what texture to
+ use for each of the captured textures, it should have one entry for each of them.
+*/
+void renderCapture_SubmitTriangles( RenderCapture* capture, GLuint* textureMap )
+{
+	for( int i = 0; i < sb_Count( capture->sbTriangles ); ++i ) {
+		CapturedTriangle* tri = &( capture->sbTriangles[i] );
+		triRenderer_AddVertices( tri->positions, tri->uvs, (ShaderType)tri->shader, textureMap[tri->textureIdx], tri->color,
+			tri->camFlags, (char)tri->depth, (TransparencyType)tri->transparency );
+	}
+}
\ No newline at end of file
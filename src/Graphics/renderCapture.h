@@ -0,0 +1,93 @@
+#ifndef RENDER_CAPTURE_H
+#define RENDER_CAPTURE_H
+
+#include "triRendering.h"
+
+/*
+Records everything submitted to the triangle renderer for a single frame, along with the state of the cameras,
+ and saves it to a binary file. The file can be replayed later by the render benchmark so changes to the renderer
+ can be compared on real frames without having to play the game.
+*/
+
+typedef struct {
+	int id;
+	unsigned int flags;
+	Vector2 pos;
+	int viewport[4]; // x, y, width, and height with the origin at the upper left
+} CapturedCamera;
+
+typedef struct {
+	GLuint id; // the texture name when the capture was made, only used to tell the textures apart
+	int width;
+	int height;
+} CapturedTexture;
+
+typedef struct {
+	Vector2 positions[3];
+	Vector2 uvs[3];
+	Color color;
+	int textureIdx;
+	int camFlags;
+	int shader;
+	int transparency;
+	int depth;
+} CapturedTriangle;
+
+typedef struct {
+	int renderWidth;
+	int renderHeight;
+	CapturedCamera* sbCameras;
+	CapturedTexture* sbTextures;
+	CapturedTriangle* sbTriangles;
+} RenderCapture;
+
+/*
+Requests that the next frame rendered be captured and saved to the file.
+ Returns <0 if there's a problem.
+*/
+int renderCapture_Request( const char* fileName );
+
+/*
+Starts capturing the frame if one was requested, call before anything is submitted to the triangle renderer.
+*/
+void renderCapture_BeginFrame( void );
+
+/*
+Returns whether the current frame is being captured.
+*/
+int renderCapture_IsCapturing( void );
+
+/*
+Records a triangle submitted to the triangle renderer.
+*/
+void renderCapture_AddTriangle( Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2, ShaderType shader,
+	GLuint texture, Color color, int camFlags, char depth, TransparencyType transparency );
+
+/*
+Finishes the capture of the current frame and writes it out.
+*/
+void renderCapture_EndFrame( void );
+
+/*
+Loads a capture saved with renderCapture_Request.
+ Returns <0 if there's a problem.
+*/
+int renderCapture_Load( const char* fileName, RenderCapture* outCapture );
+
+/*
+Frees everything allocated when loading the capture.
+*/
+void renderCapture_Release( RenderCapture* capture );
+
+/*
+Sets up all the cameras so they match what they were when the capture was made.
+*/
+void renderCapture_SetupCameras( RenderCapture* capture );
+
+/*
+Submits all the triangles in the capture to the triangle renderer. The texture map is used to find what texture to
+ use for each of the captured textures, it should have one entry for each of them.
+*/
+void renderCapture_SubmitTriangles( RenderCapture* capture, GLuint* textureMap );
+
+#endif /* inclusion guard */
\ No newline at end of file
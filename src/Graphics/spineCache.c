@@ -0,0 +1,1322 @@
+#include "spineCache.h"
+
+#include <SDL.h>
+#include <string.h>
+#include <spine/extension.h>
+
+#include "../System/memory.h"
+#include "../Utils/stretchyBuffer.h"
+
+// everything is rebuilt through the runtime's own create functions, filled in the same way its json loader does, so
+//  it's all owned and disposed of by the runtime as usual. the mixes between animations aren't part of the files in
+//  this version of spine, they're set with spine_SetTemplateMix( ) after loading, so only the default mix is stored
+#define CACHE_MAGIC "SPBN"
+#define CACHE_VERSION 1
+
+// the runtime stores the curve between each pair of frames as its type followed by the points it's sampled at, this
+//  has to match the number of floats it allocates for each one, bump the version if it changes
+#define CURVE_SIZE 19
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint64_t arenaSize;
+} CacheHeader;
+
+// everything after the header is 32 bit values, strings are padded out to keep them aligned
+typedef struct {
+	const uint8_t* pos;
+	const uint8_t* end;
+	int failed; // reads past the end, or values that don't make sense, everything read after this is 0
+} CacheReader;
+
+// writing
+static void writeData( uint8_t** sbOut, const void* data, size_t size )
+{
+	if( size == 0 ) {
+		return;
+	}
+
+	uint8_t* dest = sb_Add( (*sbOut), (int)size );
+	memcpy( dest, data, size );
+}
+
+static void writeInt( uint8_t** sbOut, int value )
+{
+	int32_t value32 = (int32_t)value;
+	writeData( sbOut, &value32, sizeof( value32 ) );
+}
+
+static void writeFloat( uint8_t** sbOut, float value )
+{
+	writeData( sbOut, &value, sizeof( value ) );
+}
+
+/*
+Writes the length of the string followed by it and its terminator, NULL strings are written as a length of -1.
+*/
+static void writeString( uint8_t** sbOut, const char* str )
+{
+	if( str == NULL ) {
+		writeInt( sbOut, -1 );
+		return;
+	}
+
+	size_t length = strlen( str );
+	size_t paddedLength = ( length + 4 ) & ~(size_t)3;
+	writeInt( sbOut, (int)length );
+
+	uint8_t* dest = sb_Add( (*sbOut), (int)paddedLength );
+	memset( dest, 0, paddedLength );
+	memcpy( dest, str, length );
+}
+
+static void writeFloatArray( uint8_t** sbOut, const float* values, int count )
+{
+	writeInt( sbOut, count );
+	writeData( sbOut, values, sizeof( float ) * count );
+}
+
+static void writeIntArray( uint8_t** sbOut, const int* values, int count )
+{
+	writeInt( sbOut, count );
+	for( int i = 0; i < count; ++i ) {
+		writeInt( sbOut, values[i] );
+	}
+}
+
+/*
+Finds where the pointer is in the array.
+ Returns -1 if it isn't there.
+*/
+static int findPointer( const void* const* array, int count, const void* ptr )
+{
+	for( int i = 0; i < count; ++i ) {
+		if( array[i] == ptr ) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+Writes out the frame data for one of the timelines with curves, which have frameSize floats for each frame.
+*/
+static void writeCurveFrames( uint8_t** sbOut, const spCurveTimeline* timeline, const float* frames, int numFloats,
+	int frameSize )
+{
+	int numFrames = numFloats / frameSize;
+	writeInt( sbOut, numFrames );
+	writeData( sbOut, frames, sizeof( float ) * numFloats );
+	writeData( sbOut, timeline->curves, sizeof( float ) * ( numFrames - 1 ) * CURVE_SIZE );
+}
+
+static void writeAtlas( uint8_t** sbOut, const spAtlas* atlas )
+{
+	int numPages = 0;
+	for( const spAtlasPage* page = atlas->pages; page != NULL; page = page->next ) {
+		++numPages;
+	}
+
+	writeInt( sbOut, numPages );
+	for( const spAtlasPage* page = atlas->pages; page != NULL; page = page->next ) {
+		writeString( sbOut, page->name );
+	}
+
+	int numRegions = 0;
+	for( const spAtlasRegion* region = atlas->regions; region != NULL; region = region->next ) {
+		++numRegions;
+	}
+
+	writeInt( sbOut, numRegions );
+	for( const spAtlasRegion* region = atlas->regions; region != NULL; region = region->next ) {
+		int pageIdx = 0;
+		for( const spAtlasPage* page = atlas->pages; page != region->page; page = page->next ) {
+			++pageIdx;
+		}
+
+		writeString( sbOut, region->name );
+		writeInt( sbOut, pageIdx );
+		writeInt( sbOut, region->x );
+		writeInt( sbOut, region->y );
+		writeInt( sbOut, region->width );
+		writeInt( sbOut, region->height );
+		writeFloat( sbOut, region->u );
+		writeFloat( sbOut, region->v );
+		writeFloat( sbOut, region->u2 );
+		writeFloat( sbOut, region->v2 );
+		writeInt( sbOut, region->offsetX );
+		writeInt( sbOut, region->offsetY );
+		writeInt( sbOut, region->originalWidth );
+		writeInt( sbOut, region->originalHeight );
+		writeInt( sbOut, region->index );
+		writeInt( sbOut, region->rotate );
+	}
+}
+
+static void writeBones( uint8_t** sbOut, const spSkeletonData* data )
+{
+	writeInt( sbOut, data->bonesCount );
+	for( int i = 0; i < data->bonesCount; ++i ) {
+		const spBoneData* bone = data->bones[i];
+		writeString( sbOut, bone->name );
+		writeInt( sbOut, findPointer( (const void* const*)data->bones, data->bonesCount, bone->parent ) );
+		writeFloat( sbOut, bone->length );
+		writeFloat( sbOut, bone->x );
+		writeFloat( sbOut, bone->y );
+		writeFloat( sbOut, bone->rotation );
+		writeFloat( sbOut, bone->scaleX );
+		writeFloat( sbOut, bone->scaleY );
+		writeInt( sbOut, bone->inheritScale );
+		writeInt( sbOut, bone->inheritRotation );
+		writeInt( sbOut, bone->flipX );
+		writeInt( sbOut, bone->flipY );
+	}
+}
+
+static void writeSlots( uint8_t** sbOut, const spSkeletonData* data )
+{
+	writeInt( sbOut, data->slotsCount );
+	for( int i = 0; i < data->slotsCount; ++i ) {
+		const spSlotData* slot = data->slots[i];
+		writeString( sbOut, slot->name );
+		writeInt( sbOut, findPointer( (const void* const*)data->bones, data->bonesCount, slot->boneData ) );
+		writeString( sbOut, slot->attachmentName );
+		writeFloat( sbOut, slot->r );
+		writeFloat( sbOut, slot->g );
+		writeFloat( sbOut, slot->b );
+		writeFloat( sbOut, slot->a );
+		writeInt( sbOut, slot->additiveBlending );
+	}
+}
+
+static void writeIkConstraints( uint8_t** sbOut, const spSkeletonData* data )
+{
+	writeInt( sbOut, data->ikConstraintsCount );
+	for( int i = 0; i < data->ikConstraintsCount; ++i ) {
+		const spIkConstraintData* ik = data->ikConstraints[i];
+		writeString( sbOut, ik->name );
+		writeInt( sbOut, ik->bonesCount );
+		for( int b = 0; b < ik->bonesCount; ++b ) {
+			writeInt( sbOut, findPointer( (const void* const*)data->bones, data->bonesCount, ik->bones[b] ) );
+		}
+		writeInt( sbOut, findPointer( (const void* const*)data->bones, data->bonesCount, ik->target ) );
+		writeInt( sbOut, ik->bendDirection );
+		writeFloat( sbOut, ik->mix );
+	}
+}
+
+static void writeEvents( uint8_t** sbOut, const spSkeletonData* data )
+{
+	writeInt( sbOut, data->eventsCount );
+	for( int i = 0; i < data->eventsCount; ++i ) {
+		const spEventData* event = data->events[i];
+		writeString( sbOut, event->name );
+		writeInt( sbOut, event->intValue );
+		writeFloat( sbOut, event->floatValue );
+		writeString( sbOut, event->stringValue );
+	}
+}
+
+/*
+Writes the attachment along with its name and type.
+ Returns <0 if it's a type that can't be written.
+*/
+static int writeAttachment( uint8_t** sbOut, const spAttachment* attachment )
+{
+	writeInt( sbOut, (int)attachment->type );
+	writeString( sbOut, attachment->name );
+
+	switch( attachment->type ) {
+	case SP_ATTACHMENT_REGION: {
+			const spRegionAttachment* region = (const spRegionAttachment*)attachment;
+			writeString( sbOut, region->path );
+			writeFloat( sbOut, region->x );
+			writeFloat( sbOut, region->y );
+			writeFloat( sbOut, region->scaleX );
+			writeFloat( sbOut, region->scaleY );
+			writeFloat( sbOut, region->rotation );
+			writeFloat( sbOut, region->width );
+			writeFloat( sbOut, region->height );
+			writeFloat( sbOut, region->r );
+			writeFloat( sbOut, region->g );
+			writeFloat( sbOut, region->b );
+			writeFloat( sbOut, region->a );
+		} break;
+	case SP_ATTACHMENT_BOUNDING_BOX: {
+			const spBoundingBoxAttachment* box = (const spBoundingBoxAttachment*)attachment;
+			writeFloatArray( sbOut, box->vertices, box->verticesCount );
+		} break;
+	case SP_ATTACHMENT_MESH: {
+			const spMeshAttachment* mesh = (const spMeshAttachment*)attachment;
+			writeString( sbOut, mesh->path );
+			writeFloatArray( sbOut, mesh->vertices, mesh->verticesCount );
+			writeFloatArray( sbOut, mesh->regionUVs, mesh->verticesCount );
+			writeIntArray( sbOut, mesh->triangles, mesh->trianglesCount );
+			writeInt( sbOut, mesh->hullLength );
+			writeIntArray( sbOut, mesh->edges, mesh->edgesCount );
+			writeFloat( sbOut, mesh->width );
+			writeFloat( sbOut, mesh->height );
+			writeFloat( sbOut, mesh->r );
+			writeFloat( sbOut, mesh->g );
+			writeFloat( sbOut, mesh->b );
+			writeFloat( sbOut, mesh->a );
+		} break;
+	case SP_ATTACHMENT_SKINNED_MESH: {
+			const spSkinnedMeshAttachment* mesh = (const spSkinnedMeshAttachment*)attachment;
+			writeString( sbOut, mesh->path );
+			writeIntArray( sbOut, mesh->bones, mesh->bonesCount );
+			writeFloatArray( sbOut, mesh->weights, mesh->weightsCount );
+			writeFloatArray( sbOut, mesh->regionUVs, mesh->uvsCount );
+			writeIntArray( sbOut, mesh->triangles, mesh->trianglesCount );
+			writeInt( sbOut, mesh->hullLength );
+			writeIntArray( sbOut, mesh->edges, mesh->edgesCount );
+			writeFloat( sbOut, mesh->width );
+			writeFloat( sbOut, mesh->height );
+			writeFloat( sbOut, mesh->r );
+			writeFloat( sbOut, mesh->g );
+			writeFloat( sbOut, mesh->b );
+			writeFloat( sbOut, mesh->a );
+		} break;
+	default:
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to cache spine attachment %s of unknown type %i.",
+			attachment->name, (int)attachment->type );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Writes all the skins, the entries in each are written in the order they were added.
+ Returns <0 if there's a problem.
+*/
+static int writeSkins( uint8_t** sbOut, const spSkeletonData* data )
+{
+	writeInt( sbOut, data->skinsCount );
+	writeInt( sbOut, findPointer( (const void* const*)data->skins, data->skinsCount, data->defaultSkin ) );
+
+	const _Entry** sbEntries = NULL;
+	int result = 0;
+	for( int i = 0; ( i < data->skinsCount ) && ( result >= 0 ); ++i ) {
+		const spSkin* skin = data->skins[i];
+		writeString( sbOut, skin->name );
+
+		// new entries are added to the front of the list
+		sb_Clear( sbEntries );
+		for( const _Entry* entry = ( (const _spSkin*)skin )->entries; entry != NULL; entry = entry->next ) {
+			sb_Push( sbEntries, entry );
+		}
+
+		writeInt( sbOut, sb_Count( sbEntries ) );
+		for( int e = sb_Count( sbEntries ) - 1; ( e >= 0 ) && ( result >= 0 ); --e ) {
+			writeInt( sbOut, sbEntries[e]->slotIndex );
+			writeString( sbOut, sbEntries[e]->name );
+			result = writeAttachment( sbOut, sbEntries[e]->attachment );
+		}
+	}
+
+	sb_Release( sbEntries );
+	return result;
+}
+
+/*
+Writes the skin and name the attachment was added to its slot with.
+ Returns <0 if it isn't in any of the skins.
+*/
+static int writeSkinAttachment( uint8_t** sbOut, const spSkeletonData* data, int slotIndex,
+	const spAttachment* attachment )
+{
+	for( int i = 0; i < data->skinsCount; ++i ) {
+		for( const _Entry* entry = ( (const _spSkin*)data->skins[i] )->entries; entry != NULL; entry = entry->next ) {
+			if( ( entry->slotIndex == slotIndex ) && ( entry->attachment == attachment ) ) {
+				writeInt( sbOut, i );
+				writeString( sbOut, entry->name );
+				return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
+/*
+Writes the timeline along with its type.
+ Returns <0 if it's a type that can't be written.
+*/
+static int writeTimeline( uint8_t** sbOut, const spSkeletonData* data, const spTimeline* timeline )
+{
+	writeInt( sbOut, (int)timeline->type );
+
+	switch( timeline->type ) {
+	case SP_TIMELINE_ROTATE:
+	case SP_TIMELINE_TRANSLATE:
+	case SP_TIMELINE_SCALE: {
+			const spBaseTimeline* base = (const spBaseTimeline*)timeline;
+			writeCurveFrames( sbOut, &( base->super ), base->frames, base->framesCount,
+				( timeline->type == SP_TIMELINE_ROTATE ) ? 2 : 3 );
+			writeInt( sbOut, base->boneIndex );
+		} break;
+	case SP_TIMELINE_COLOR: {
+			const spColorTimeline* color = (const spColorTimeline*)timeline;
+			writeCurveFrames( sbOut, &( color->super ), color->frames, color->framesCount, 5 );
+			writeInt( sbOut, color->slotIndex );
+		} break;
+	case SP_TIMELINE_IKCONSTRAINT: {
+			const spIkConstraintTimeline* ik = (const spIkConstraintTimeline*)timeline;
+			writeCurveFrames( sbOut, &( ik->super ), ik->frames, ik->framesCount, 3 );
+			writeInt( sbOut, ik->ikConstraintIndex );
+		} break;
+	case SP_TIMELINE_FLIPX:
+	case SP_TIMELINE_FLIPY: {
+			const spFlipTimeline* flip = (const spFlipTimeline*)timeline;
+			writeFloatArray( sbOut, flip->frames, flip->framesCount );
+			writeInt( sbOut, flip->boneIndex );
+		} break;
+	case SP_TIMELINE_ATTACHMENT: {
+			const spAttachmentTimeline* attachment = (const spAttachmentTimeline*)timeline;
+			writeFloatArray( sbOut, attachment->frames, attachment->framesCount );
+			writeInt( sbOut, attachment->slotIndex );
+			for( int i = 0; i < attachment->framesCount; ++i ) {
+				writeString( sbOut, attachment->attachmentNames[i] );
+			}
+		} break;
+	case SP_TIMELINE_EVENT: {
+			const spEventTimeline* event = (const spEventTimeline*)timeline;
+			writeFloatArray( sbOut, event->frames, event->framesCount );
+			for( int i = 0; i < event->framesCount; ++i ) {
+				const spEvent* frameEvent = event->events[i];
+				writeInt( sbOut, findPointer( (const void* const*)data->events, data->eventsCount, frameEvent->data ) );
+				writeInt( sbOut, frameEvent->intValue );
+				writeFloat( sbOut, frameEvent->floatValue );
+				writeString( sbOut, frameEvent->stringValue );
+			}
+		} break;
+	case SP_TIMELINE_DRAWORDER: {
+			const spDrawOrderTimeline* drawOrder = (const spDrawOrderTimeline*)timeline;
+			writeFloatArray( sbOut, drawOrder->frames, drawOrder->framesCount );
+			writeInt( sbOut, drawOrder->slotsCount );
+			for( int i = 0; i < drawOrder->framesCount; ++i ) {
+				// frames without an order go back to the setup pose
+				writeInt( sbOut, ( drawOrder->drawOrders[i] != NULL ) );
+				if( drawOrder->drawOrders[i] != NULL ) {
+					writeData( sbOut, drawOrder->drawOrders[i], sizeof( int ) * drawOrder->slotsCount );
+				}
+			}
+		} break;
+	case SP_TIMELINE_FFD: {
+			const spFFDTimeline* ffd = (const spFFDTimeline*)timeline;
+			writeCurveFrames( sbOut, &( ffd->super ), ffd->frames, ffd->framesCount, 1 );
+			writeInt( sbOut, ffd->frameVerticesCount );
+			writeInt( sbOut, ffd->slotIndex );
+			if( writeSkinAttachment( sbOut, data, ffd->slotIndex, ffd->attachment ) < 0 ) {
+				SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to find the attachment for a spine FFD timeline." );
+				return -1;
+			}
+			for( int i = 0; i < ffd->framesCount; ++i ) {
+				writeInt( sbOut, ( ffd->frameVertices[i] != NULL ) );
+				if( ffd->frameVertices[i] != NULL ) {
+					writeData( sbOut, ffd->frameVertices[i], sizeof( float ) * ffd->frameVerticesCount );
+				}
+			}
+		} break;
+	default:
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to cache spine timeline of unknown type %i.",
+			(int)timeline->type );
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Writes all the animations.
+ Returns <0 if there's a problem.
+*/
+static int writeAnimations( uint8_t** sbOut, const spSkeletonData* data )
+{
+	writeInt( sbOut, data->animationsCount );
+	for( int i = 0; i < data->animationsCount; ++i ) {
+		const spAnimation* animation = data->animations[i];
+		writeString( sbOut, animation->name );
+		writeFloat( sbOut, animation->duration );
+		writeInt( sbOut, animation->timelinesCount );
+		for( int t = 0; t < animation->timelinesCount; ++t ) {
+			if( writeTimeline( sbOut, data, animation->timelines[t] ) < 0 ) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// reading
+static const void* readData( CacheReader* reader, size_t size )
+{
+	if( reader->failed || ( size > (size_t)( reader->end - reader->pos ) ) ) {
+		reader->failed = 1;
+		return NULL;
+	}
+
+	const void* data = reader->pos;
+	reader->pos += size;
+	return data;
+}
+
+static int readInt( CacheReader* reader )
+{
+	const int32_t* value = readData( reader, sizeof( int32_t ) );
+	return ( value != NULL ) ? (int)(*value) : 0;
+}
+
+static float readFloat( CacheReader* reader )
+{
+	const float* value = readData( reader, sizeof( float ) );
+	return ( value != NULL ) ? (*value) : 0.0f;
+}
+
+/*
+Reads the number of elements that follow, making sure there's enough left in the file for them before anything is
+ allocated to hold them.
+*/
+static int readCount( CacheReader* reader, size_t elementSize )
+{
+	int count = readInt( reader );
+	if( ( count < 0 ) || ( (size_t)count > ( (size_t)( reader->end - reader->pos ) / elementSize ) ) ) {
+		reader->failed = 1;
+		return 0;
+	}
+
+	return count;
+}
+
+/*
+Reads an index into something holding count elements, -1 is allowed if optional is set.
+*/
+static int readIndex( CacheReader* reader, int count, int optional )
+{
+	int idx = readInt( reader );
+	if( ( idx >= count ) || ( idx < ( optional ? -1 : 0 ) ) ) {
+		reader->failed = 1;
+		return optional ? -1 : 0;
+	}
+
+	return idx;
+}
+
+/*
+Reads a string, it points into the file data so it has to be copied to be kept.
+ Returns NULL if a NULL string was written.
+*/
+static const char* readString( CacheReader* reader )
+{
+	int length = readInt( reader );
+	if( ( length < 0 ) || reader->failed ) {
+		return NULL;
+	}
+
+	size_t paddedLength = ( (size_t)length + 4 ) & ~(size_t)3;
+	const char* str = readData( reader, paddedLength );
+	if( ( str == NULL ) || ( str[length] != 0 ) ) {
+		reader->failed = 1;
+		return NULL;
+	}
+
+	return str;
+}
+
+/*
+Reads a string that has to be there, an empty one is returned if it isn't so it's always safe to use.
+*/
+static const char* readName( CacheReader* reader )
+{
+	const char* str = readString( reader );
+	if( str == NULL ) {
+		reader->failed = 1;
+		return "";
+	}
+
+	return str;
+}
+
+/*
+Reads an array of floats into memory allocated by the runtime, so it's freed along with whatever it's put in.
+ Returns NULL if the array is empty or there's a problem.
+*/
+static float* readFloatArray( CacheReader* reader, int* outCount )
+{
+	(*outCount) = readCount( reader, sizeof( float ) );
+	if( (*outCount) == 0 ) {
+		return NULL;
+	}
+
+	float* values = MALLOC( float, (*outCount) );
+	memcpy( values, readData( reader, sizeof( float ) * (*outCount) ), sizeof( float ) * (*outCount) );
+	return values;
+}
+
+static int* readIntArray( CacheReader* reader, int* outCount )
+{
+	(*outCount) = readCount( reader, sizeof( int32_t ) );
+	if( (*outCount) == 0 ) {
+		return NULL;
+	}
+
+	int* values = MALLOC( int, (*outCount) );
+	for( int i = 0; i < (*outCount); ++i ) {
+		values[i] = readInt( reader );
+	}
+	return values;
+}
+
+/*
+Reads the frames and curves for one of the timelines with curves into the ones the runtime allocated for it.
+*/
+static void readCurveFrames( CacheReader* reader, spCurveTimeline* timeline, float* frames, int numFrames,
+	int frameSize )
+{
+	const void* frameData = readData( reader, sizeof( float ) * numFrames * frameSize );
+	const void* curveData = readData( reader, sizeof( float ) * ( numFrames - 1 ) * CURVE_SIZE );
+	if( reader->failed ) {
+		return;
+	}
+
+	memcpy( frames, frameData, sizeof( float ) * numFrames * frameSize );
+	memcpy( timeline->curves, curveData, sizeof( float ) * ( numFrames - 1 ) * CURVE_SIZE );
+}
+
+static spAtlasPage* getAtlasPage( spAtlas* atlas, int idx )
+{
+	spAtlasPage* page = atlas->pages;
+	for( int i = 0; i < idx; ++i ) {
+		page = page->next;
+	}
+	return page;
+}
+
+/*
+Creates the atlas, loading the textures for its pages the same way the runtime does when it's parsed.
+ Returns <0 if there's a problem, whatever was created is still put in outAtlas so it can be disposed of.
+*/
+static int loadAtlas( CacheReader* reader, const char* atlasDir, spAtlas** outAtlas )
+{
+	char path[512];
+
+	// an empty atlas to add the pages and regions to
+	spAtlas* atlas = spAtlas_create( "", 0, atlasDir, NULL );
+	(*outAtlas) = atlas;
+	if( atlas == NULL ) {
+		return -1;
+	}
+
+	size_t dirLength = strlen( atlasDir );
+	int needsSlash = ( dirLength > 0 ) && ( atlasDir[dirLength - 1] != '/' ) && ( atlasDir[dirLength - 1] != '\\' );
+
+	spAtlasPage* lastPage = NULL;
+	int numPages = readCount( reader, sizeof( int32_t ) );
+	for( int i = 0; i < numPages; ++i ) {
+		const char* name = readName( reader );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spAtlasPage* page = spAtlasPage_create( atlas, name );
+		if( lastPage == NULL ) {
+			atlas->pages = page;
+		} else {
+			lastPage->next = page;
+		}
+		lastPage = page;
+
+		SDL_snprintf( path, sizeof( path ), "%s%s%s", atlasDir, needsSlash ? "/" : "", name );
+		_spAtlasPage_createTexture( page, path );
+	}
+
+	spAtlasRegion* lastRegion = NULL;
+	int numRegions = readCount( reader, sizeof( int32_t ) );
+	for( int i = 0; i < numRegions; ++i ) {
+		const char* name = readName( reader );
+		int pageIdx = readIndex( reader, numPages, 0 );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spAtlasRegion* region = spAtlasRegion_create( );
+		if( lastRegion == NULL ) {
+			atlas->regions = region;
+		} else {
+			lastRegion->next = region;
+		}
+		lastRegion = region;
+
+		MALLOC_STR( region->name, name );
+		region->page = getAtlasPage( atlas, pageIdx );
+		region->x = readInt( reader );
+		region->y = readInt( reader );
+		region->width = readInt( reader );
+		region->height = readInt( reader );
+		region->u = readFloat( reader );
+		region->v = readFloat( reader );
+		region->u2 = readFloat( reader );
+		region->v2 = readFloat( reader );
+		region->offsetX = readInt( reader );
+		region->offsetY = readInt( reader );
+		region->originalWidth = readInt( reader );
+		region->originalHeight = readInt( reader );
+		region->index = readInt( reader );
+		region->rotate = readInt( reader );
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+// everything created below is added to the skeleton data as soon as it's made, so disposing of it cleans up anything
+//  that was loaded before there was a problem
+static int loadBones( CacheReader* reader, spSkeletonData* data )
+{
+	int count = readCount( reader, sizeof( int32_t ) );
+	data->bones = CALLOC( spBoneData*, count );
+	for( int i = 0; i < count; ++i ) {
+		const char* name = readName( reader );
+		int parentIdx = readIndex( reader, i, 1 ); // parents always come before their children
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spBoneData* bone = spBoneData_create( name, ( parentIdx >= 0 ) ? data->bones[parentIdx] : NULL );
+		data->bones[data->bonesCount++] = bone;
+
+		bone->length = readFloat( reader );
+		bone->x = readFloat( reader );
+		bone->y = readFloat( reader );
+		bone->rotation = readFloat( reader );
+		bone->scaleX = readFloat( reader );
+		bone->scaleY = readFloat( reader );
+		bone->inheritScale = readInt( reader );
+		bone->inheritRotation = readInt( reader );
+		bone->flipX = readInt( reader );
+		bone->flipY = readInt( reader );
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+static int loadSlots( CacheReader* reader, spSkeletonData* data )
+{
+	int count = readCount( reader, sizeof( int32_t ) );
+	data->slots = CALLOC( spSlotData*, count );
+	for( int i = 0; i < count; ++i ) {
+		const char* name = readName( reader );
+		int boneIdx = readIndex( reader, data->bonesCount, 0 );
+		const char* attachmentName = readString( reader );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spSlotData* slot = spSlotData_create( name, data->bones[boneIdx] );
+		data->slots[data->slotsCount++] = slot;
+
+		if( attachmentName != NULL ) {
+			spSlotData_setAttachmentName( slot, attachmentName );
+		}
+		slot->r = readFloat( reader );
+		slot->g = readFloat( reader );
+		slot->b = readFloat( reader );
+		slot->a = readFloat( reader );
+		slot->additiveBlending = readInt( reader );
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+static int loadIkConstraints( CacheReader* reader, spSkeletonData* data )
+{
+	int count = readCount( reader, sizeof( int32_t ) );
+	data->ikConstraints = CALLOC( spIkConstraintData*, count );
+	for( int i = 0; i < count; ++i ) {
+		const char* name = readName( reader );
+		int numBones = readCount( reader, sizeof( int32_t ) );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spIkConstraintData* ik = spIkConstraintData_create( name );
+		data->ikConstraints[data->ikConstraintsCount++] = ik;
+
+		ik->bones = CALLOC( spBoneData*, numBones );
+		for( int b = 0; b < numBones; ++b ) {
+			int boneIdx = readIndex( reader, data->bonesCount, 0 );
+			if( reader->failed ) {
+				return -1;
+			}
+			ik->bones[ik->bonesCount++] = data->bones[boneIdx];
+		}
+
+		int targetIdx = readIndex( reader, data->bonesCount, 0 );
+		if( reader->failed ) {
+			return -1;
+		}
+		ik->target = data->bones[targetIdx];
+		ik->bendDirection = readInt( reader );
+		ik->mix = readFloat( reader );
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+static int loadEvents( CacheReader* reader, spSkeletonData* data )
+{
+	int count = readCount( reader, sizeof( int32_t ) );
+	data->events = CALLOC( spEventData*, count );
+	for( int i = 0; i < count; ++i ) {
+		const char* name = readName( reader );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spEventData* event = spEventData_create( name );
+		data->events[data->eventsCount++] = event;
+
+		event->intValue = readInt( reader );
+		event->floatValue = readFloat( reader );
+		const char* stringValue = readString( reader );
+		if( stringValue != NULL ) {
+			MALLOC_STR( event->stringValue, stringValue );
+		}
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+/*
+Creates the attachment and adds it to the skin. The attachment loader finds its region in the atlas, the same as when
+ it's loaded from json.
+ Returns <0 if there's a problem.
+*/
+static int loadAttachment( CacheReader* reader, spAttachmentLoader* loader, spSkin* skin, int slotIdx,
+	const char* entryName )
+{
+	spAttachmentType type = (spAttachmentType)readInt( reader );
+	const char* name = readName( reader );
+	const char* path = ( type != SP_ATTACHMENT_BOUNDING_BOX ) ? readString( reader ) : NULL;
+	if( reader->failed ) {
+		return -1;
+	}
+
+	spAttachment* attachment =
+		spAttachmentLoader_newAttachment( loader, skin, type, name, ( path != NULL ) ? path : name );
+	if( attachment == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create cached spine attachment %s: %s%s", name,
+			( loader->error1 != NULL ) ? loader->error1 : "", ( loader->error2 != NULL ) ? loader->error2 : "" );
+		return -1;
+	}
+	spSkin_addAttachment( skin, slotIdx, entryName, attachment );
+
+	int numUVs;
+	switch( type ) {
+	case SP_ATTACHMENT_REGION: {
+			spRegionAttachment* region = SUB_CAST( spRegionAttachment, attachment );
+			if( path != NULL ) {
+				MALLOC_STR( region->path, path );
+			}
+			region->x = readFloat( reader );
+			region->y = readFloat( reader );
+			region->scaleX = readFloat( reader );
+			region->scaleY = readFloat( reader );
+			region->rotation = readFloat( reader );
+			region->width = readFloat( reader );
+			region->height = readFloat( reader );
+			region->r = readFloat( reader );
+			region->g = readFloat( reader );
+			region->b = readFloat( reader );
+			region->a = readFloat( reader );
+			spRegionAttachment_updateOffset( region );
+		} break;
+	case SP_ATTACHMENT_BOUNDING_BOX: {
+			spBoundingBoxAttachment* box = SUB_CAST( spBoundingBoxAttachment, attachment );
+			box->vertices = readFloatArray( reader, &( box->verticesCount ) );
+		} break;
+	case SP_ATTACHMENT_MESH: {
+			spMeshAttachment* mesh = SUB_CAST( spMeshAttachment, attachment );
+			if( path != NULL ) {
+				MALLOC_STR( mesh->path, path );
+			}
+			mesh->vertices = readFloatArray( reader, &( mesh->verticesCount ) );
+			mesh->regionUVs = readFloatArray( reader, &numUVs );
+			mesh->triangles = readIntArray( reader, &( mesh->trianglesCount ) );
+			mesh->hullLength = readInt( reader );
+			mesh->edges = readIntArray( reader, &( mesh->edgesCount ) );
+			mesh->width = readFloat( reader );
+			mesh->height = readFloat( reader );
+			mesh->r = readFloat( reader );
+			mesh->g = readFloat( reader );
+			mesh->b = readFloat( reader );
+			mesh->a = readFloat( reader );
+			if( reader->failed || ( numUVs != mesh->verticesCount ) ) {
+				reader->failed = 1;
+				return -1;
+			}
+			spMeshAttachment_updateUVs( mesh );
+		} break;
+	case SP_ATTACHMENT_SKINNED_MESH: {
+			spSkinnedMeshAttachment* mesh = SUB_CAST( spSkinnedMeshAttachment, attachment );
+			if( path != NULL ) {
+				MALLOC_STR( mesh->path, path );
+			}
+			mesh->bones = readIntArray( reader, &( mesh->bonesCount ) );
+			mesh->weights = readFloatArray( reader, &( mesh->weightsCount ) );
+			mesh->regionUVs = readFloatArray( reader, &( mesh->uvsCount ) );
+			mesh->triangles = readIntArray( reader, &( mesh->trianglesCount ) );
+			mesh->hullLength = readInt( reader );
+			mesh->edges = readIntArray( reader, &( mesh->edgesCount ) );
+			mesh->width = readFloat( reader );
+			mesh->height = readFloat( reader );
+			mesh->r = readFloat( reader );
+			mesh->g = readFloat( reader );
+			mesh->b = readFloat( reader );
+			mesh->a = readFloat( reader );
+			if( reader->failed ) {
+				return -1;
+			}
+			spSkinnedMeshAttachment_updateUVs( mesh );
+		} break;
+	default:
+		reader->failed = 1;
+		break;
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+static int loadSkins( CacheReader* reader, spSkeletonData* data, spAttachmentLoader* loader )
+{
+	int count = readCount( reader, sizeof( int32_t ) );
+	int defaultSkinIdx = readIndex( reader, count, 1 );
+	data->skins = CALLOC( spSkin*, count );
+	for( int i = 0; i < count; ++i ) {
+		const char* name = readName( reader );
+		int numEntries = readCount( reader, sizeof( int32_t ) );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spSkin* skin = spSkin_create( name );
+		data->skins[data->skinsCount++] = skin;
+		if( i == defaultSkinIdx ) {
+			data->defaultSkin = skin;
+		}
+
+		for( int e = 0; e < numEntries; ++e ) {
+			int slotIdx = readIndex( reader, data->slotsCount, 0 );
+			const char* entryName = readName( reader );
+			if( reader->failed || ( loadAttachment( reader, loader, skin, slotIdx, entryName ) < 0 ) ) {
+				return -1;
+			}
+		}
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+/*
+Creates the next timeline and adds it to the animation.
+ Returns <0 if there's a problem.
+*/
+static int loadTimeline( CacheReader* reader, spSkeletonData* data, spAnimation* animation )
+{
+	spTimelineType type = (spTimelineType)readInt( reader );
+	int numFrames = readCount( reader, sizeof( float ) );
+	if( reader->failed || ( numFrames < 1 ) ) {
+		return -1;
+	}
+
+	switch( type ) {
+	case SP_TIMELINE_ROTATE:
+	case SP_TIMELINE_TRANSLATE:
+	case SP_TIMELINE_SCALE: {
+			spBaseTimeline* base;
+			int frameSize = 3;
+			if( type == SP_TIMELINE_ROTATE ) {
+				base = spRotateTimeline_create( numFrames );
+				frameSize = 2;
+			} else if( type == SP_TIMELINE_TRANSLATE ) {
+				base = spTranslateTimeline_create( numFrames );
+			} else {
+				base = spScaleTimeline_create( numFrames );
+			}
+			animation->timelines[animation->timelinesCount++] = SUPER_CAST( spTimeline, base );
+
+			readCurveFrames( reader, SUPER( base ), base->frames, numFrames, frameSize );
+			base->boneIndex = readIndex( reader, data->bonesCount, 0 );
+		} break;
+	case SP_TIMELINE_COLOR: {
+			spColorTimeline* color = spColorTimeline_create( numFrames );
+			animation->timelines[animation->timelinesCount++] = SUPER_CAST( spTimeline, color );
+
+			readCurveFrames( reader, SUPER( color ), color->frames, numFrames, 5 );
+			color->slotIndex = readIndex( reader, data->slotsCount, 0 );
+		} break;
+	case SP_TIMELINE_IKCONSTRAINT: {
+			spIkConstraintTimeline* ik = spIkConstraintTimeline_create( numFrames );
+			animation->timelines[animation->timelinesCount++] = SUPER_CAST( spTimeline, ik );
+
+			readCurveFrames( reader, SUPER( ik ), ik->frames, numFrames, 3 );
+			ik->ikConstraintIndex = readIndex( reader, data->ikConstraintsCount, 0 );
+		} break;
+	case SP_TIMELINE_FLIPX:
+	case SP_TIMELINE_FLIPY: {
+			// written as the number of floats, there's two for each frame
+			if( ( numFrames % 2 ) != 0 ) {
+				return -1;
+			}
+
+			spFlipTimeline* flip = spFlipTimeline_create( numFrames / 2, ( type == SP_TIMELINE_FLIPX ) );
+			animation->timelines[animation->timelinesCount++] = SUPER( flip );
+
+			const void* frameData = readData( reader, sizeof( float ) * numFrames );
+			if( frameData != NULL ) {
+				memcpy( flip->frames, frameData, sizeof( float ) * numFrames );
+			}
+			flip->boneIndex = readIndex( reader, data->bonesCount, 0 );
+		} break;
+	case SP_TIMELINE_ATTACHMENT: {
+			spAttachmentTimeline* attachment = spAttachmentTimeline_create( numFrames );
+			animation->timelines[animation->timelinesCount++] = SUPER( attachment );
+
+			const float* times = readData( reader, sizeof( float ) * numFrames );
+			attachment->slotIndex = readIndex( reader, data->slotsCount, 0 );
+			for( int i = 0; ( i < numFrames ) && !reader->failed; ++i ) {
+				const char* attachmentName = readString( reader );
+				if( !reader->failed ) {
+					spAttachmentTimeline_setFrame( attachment, i, times[i], attachmentName );
+				}
+			}
+		} break;
+	case SP_TIMELINE_EVENT: {
+			spEventTimeline* event = spEventTimeline_create( numFrames );
+			animation->timelines[animation->timelinesCount++] = SUPER( event );
+
+			const float* times = readData( reader, sizeof( float ) * numFrames );
+			for( int i = 0; ( i < numFrames ) && !reader->failed; ++i ) {
+				int eventIdx = readIndex( reader, data->eventsCount, 0 );
+				if( reader->failed ) {
+					break;
+				}
+
+				spEvent* frameEvent = spEvent_create( data->events[eventIdx] );
+				frameEvent->intValue = readInt( reader );
+				frameEvent->floatValue = readFloat( reader );
+				const char* stringValue = readString( reader );
+				if( stringValue != NULL ) {
+					MALLOC_STR( frameEvent->stringValue, stringValue );
+				}
+				spEventTimeline_setFrame( event, i, times[i], frameEvent );
+			}
+		} break;
+	case SP_TIMELINE_DRAWORDER: {
+			const float* times = readData( reader, sizeof( float ) * numFrames );
+			int slotsCount = readCount( reader, sizeof( int32_t ) );
+			if( reader->failed ) {
+				return -1;
+			}
+
+			spDrawOrderTimeline* drawOrder = spDrawOrderTimeline_create( numFrames, slotsCount );
+			animation->timelines[animation->timelinesCount++] = SUPER( drawOrder );
+
+			for( int i = 0; ( i < numFrames ) && !reader->failed; ++i ) {
+				const int* order = NULL;
+				if( readInt( reader ) ) {
+					order = readData( reader, sizeof( int ) * slotsCount );
+				}
+				if( !reader->failed ) {
+					spDrawOrderTimeline_setFrame( drawOrder, i, times[i], order );
+				}
+			}
+		} break;
+	case SP_TIMELINE_FFD: {
+			const float* times = readData( reader, sizeof( float ) * numFrames );
+			const float* curves = readData( reader, sizeof( float ) * ( numFrames - 1 ) * CURVE_SIZE );
+			int frameVerticesCount = readCount( reader, sizeof( float ) );
+			int slotIdx = readIndex( reader, data->slotsCount, 0 );
+			int skinIdx = readIndex( reader, data->skinsCount, 0 );
+			const char* attachmentName = readName( reader );
+			if( reader->failed ) {
+				return -1;
+			}
+
+			spAttachment* ffdAttachment = spSkin_getAttachment( data->skins[skinIdx], slotIdx, attachmentName );
+			if( ffdAttachment == NULL ) {
+				return -1;
+			}
+
+			spFFDTimeline* ffd = spFFDTimeline_create( numFrames, frameVerticesCount );
+			animation->timelines[animation->timelinesCount++] = SUPER_CAST( spTimeline, ffd );
+
+			ffd->slotIndex = slotIdx;
+			ffd->attachment = ffdAttachment;
+			memcpy( ffd->frames, times, sizeof( float ) * numFrames );
+			memcpy( SUPER( ffd )->curves, curves, sizeof( float ) * ( numFrames - 1 ) * CURVE_SIZE );
+			for( int i = 0; ( i < numFrames ) && !reader->failed; ++i ) {
+				if( readInt( reader ) ) {
+					const float* vertices = readData( reader, sizeof( float ) * frameVerticesCount );
+					if( vertices != NULL ) {
+						spFFDTimeline_setFrame( ffd, i, times[i], (float*)vertices );
+					}
+				}
+			}
+		} break;
+	default:
+		return -1;
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+static int loadAnimations( CacheReader* reader, spSkeletonData* data )
+{
+	int count = readCount( reader, sizeof( int32_t ) );
+	data->animations = CALLOC( spAnimation*, count );
+	for( int i = 0; i < count; ++i ) {
+		const char* name = readName( reader );
+		float duration = readFloat( reader );
+		int numTimelines = readCount( reader, sizeof( int32_t ) );
+		if( reader->failed ) {
+			return -1;
+		}
+
+		spAnimation* animation = spAnimation_create( name, numTimelines );
+		data->animations[data->animationsCount++] = animation;
+
+		// counted up as they're added, the same as the json loader
+		animation->timelinesCount = 0;
+		animation->duration = duration;
+		for( int t = 0; t < numTimelines; ++t ) {
+			if( loadTimeline( reader, data, animation ) < 0 ) {
+				return -1;
+			}
+		}
+	}
+
+	return reader->failed ? -1 : 0;
+}
+
+/*
+Hashes the files a template is loaded from, a cache file is only used if it was made from the same ones.
+*/
+uint64_t spineCache_Key( const char* jsonText, size_t jsonLength, const char* atlasText, size_t atlasLength )
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for( size_t i = 0; i < jsonLength; ++i ) {
+		hash ^= (uint8_t)jsonText[i];
+		hash *= 1099511628211ull;
+	}
+
+	for( size_t i = 0; i < atlasLength; ++i ) {
+		hash ^= (uint8_t)atlasText[i];
+		hash *= 1099511628211ull;
+	}
+
+	// the sizes of everything the runtime allocates change with the size of a pointer
+	hash ^= (uint64_t)sizeof( void* );
+	hash *= 1099511628211ull;
+
+	return hash;
+}
+
+/*
+Reads in the cache file if it was made from the files with the key, and written in the current format.
+ Returns <0 if there's no usable cache file.
+*/
+int spineCache_Open( const char* fileName, uint64_t key, SpineCacheFile* outFile )
+{
+	memset( outFile, 0, sizeof( *outFile ) );
+
+	SDL_RWops* rwops = SDL_RWFromFile( fileName, "rb" );
+	if( rwops == NULL ) {
+		return -1;
+	}
+
+	uint8_t* data = NULL;
+	Sint64 size = SDL_RWsize( rwops );
+	if( ( size < (Sint64)sizeof( CacheHeader ) ) || ( (uint64_t)size > SIZE_MAX ) ) {
+		goto clean_up;
+	}
+
+	data = mem_Allocate( (size_t)size );
+	if( data == NULL ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to allocate memory to read spine cache %s.", fileName );
+		goto clean_up;
+	}
+
+	if( SDL_RWread( rwops, data, 1, (size_t)size ) != (size_t)size ) {
+		mem_Release( data );
+		data = NULL;
+		goto clean_up;
+	}
+
+	const CacheHeader* header = (const CacheHeader*)data;
+	if( ( memcmp( header->magic, CACHE_MAGIC, sizeof( header->magic ) ) != 0 ) ||
+		( header->version != CACHE_VERSION ) || ( header->key != key ) || ( header->arenaSize > SIZE_MAX ) ) {
+		mem_Release( data );
+		data = NULL;
+		goto clean_up;
+	}
+
+	outFile->data = data;
+	outFile->size = (size_t)size;
+	outFile->arenaSize = (size_t)header->arenaSize;
+
+clean_up:
+	SDL_RWclose( rwops );
+	return ( data != NULL ) ? 0 : -1;
+}
+
+/*
+Frees up the data read in by spineCache_Open( ).
+*/
+void spineCache_Close( SpineCacheFile* file )
+{
+	mem_Release( file->data );
+	memset( file, 0, sizeof( *file ) );
+}
+
+/*
+Creates the atlas, skeleton data, and animation state data stored in the cache file. Everything is made through the
+ spine runtime, so it's disposed of in the usual way. The atlas pages are loaded from atlasDir.
+ Returns <0 if there's a problem, nothing is created if there is.
+*/
+int spineCache_Load( const SpineCacheFile* file, const char* atlasDir, spAtlas** outAtlas,
+	spSkeletonData** outSkeletonData, spAnimationStateData** outStateData )
+{
+	CacheReader reader;
+	reader.pos = file->data + sizeof( CacheHeader );
+	reader.end = file->data + file->size;
+	reader.failed = 0;
+
+	spAtlas* atlas = NULL;
+	spSkeletonData* skeletonData = NULL;
+	spAnimationStateData* stateData = NULL;
+	spAtlasAttachmentLoader* attachmentLoader = NULL;
+	int result = -1;
+
+	if( loadAtlas( &reader, atlasDir, &atlas ) < 0 ) {
+		goto clean_up;
+	}
+
+	skeletonData = spSkeletonData_create( );
+	attachmentLoader = spAtlasAttachmentLoader_create( atlas );
+	if( ( skeletonData == NULL ) || ( attachmentLoader == NULL ) ) {
+		goto clean_up;
+	}
+
+	if( ( loadBones( &reader, skeletonData ) < 0 ) || ( loadSlots( &reader, skeletonData ) < 0 ) ||
+		( loadIkConstraints( &reader, skeletonData ) < 0 ) || ( loadEvents( &reader, skeletonData ) < 0 ) ||
+		( loadSkins( &reader, skeletonData, SUPER( attachmentLoader ) ) < 0 ) ||
+		( loadAnimations( &reader, skeletonData ) < 0 ) ) {
+		goto clean_up;
+	}
+
+	stateData = spAnimationStateData_create( skeletonData );
+	if( stateData == NULL ) {
+		goto clean_up;
+	}
+	stateData->defaultMix = readFloat( &reader );
+
+	// anything left over means it wasn't written the way it's being read
+	if( !reader.failed && ( reader.pos == reader.end ) ) {
+		result = 0;
+	}
+
+clean_up:
+	if( attachmentLoader != NULL ) {
+		spAttachmentLoader_dispose( SUPER( attachmentLoader ) );
+	}
+
+	if( result < 0 ) {
+		if( stateData != NULL ) {
+			spAnimationStateData_dispose( stateData );
+		}
+		if( skeletonData != NULL ) {
+			spSkeletonData_dispose( skeletonData );
+		}
+		if( atlas != NULL ) {
+			spAtlas_dispose( atlas );
+		}
+		return -1;
+	}
+
+	(*outAtlas) = atlas;
+	(*outSkeletonData) = skeletonData;
+	(*outStateData) = stateData;
+	return 0;
+}
+
+/*
+Writes out a cache file for the template that was loaded from the files with the key.
+ Returns <0 if there's a problem.
+*/
+int spineCache_Write( const char* fileName, uint64_t key, const spAtlas* atlas, const spSkeletonData* skeletonData,
+	const spAnimationStateData* stateData )
+{
+	uint8_t* sbData = NULL;
+
+	// the arena size isn't known until it's loaded from the cache
+	CacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, CACHE_MAGIC, sizeof( header.magic ) );
+	header.version = CACHE_VERSION;
+	header.key = key;
+	header.arenaSize = 0;
+	writeData( &sbData, &header, sizeof( header ) );
+
+	writeAtlas( &sbData, atlas );
+	writeBones( &sbData, skeletonData );
+	writeSlots( &sbData, skeletonData );
+	writeIkConstraints( &sbData, skeletonData );
+	writeEvents( &sbData, skeletonData );
+	if( ( writeSkins( &sbData, skeletonData ) < 0 ) || ( writeAnimations( &sbData, skeletonData ) < 0 ) ) {
+		sb_Release( sbData );
+		return -1;
+	}
+	writeFloat( &sbData, stateData->defaultMix );
+
+	int result = -1;
+	SDL_RWops* rwops = SDL_RWFromFile( fileName, "wb" );
+	if( rwops != NULL ) {
+		result = ( SDL_RWwrite( rwops, sbData, 1, sb_Count( sbData ) ) == (size_t)sb_Count( sbData ) ) ? 0 : -1;
+		if( SDL_RWclose( rwops ) != 0 ) {
+			result = -1;
+		}
+	}
+
+	sb_Release( sbData );
+	return result;
+}
+
+/*
+Updates how much the runtime allocated loading from the cache file, so the next load can set it all aside at once.
+ Returns <0 if there's a problem.
+*/
+int spineCache_SaveArenaSize( const char* fileName, size_t arenaSize )
+{
+	SDL_RWops* rwops = SDL_RWFromFile( fileName, "r+b" );
+	if( rwops == NULL ) {
+		return -1;
+	}
+
+	uint64_t size64 = (uint64_t)arenaSize;
+	int result = -1;
+	if( ( SDL_RWseek( rwops, offsetof( CacheHeader, arenaSize ), RW_SEEK_SET ) >= 0 ) &&
+		( SDL_RWwrite( rwops, &size64, sizeof( size64 ), 1 ) == 1 ) ) {
+		result = 0;
+	}
+
+	if( SDL_RWclose( rwops ) != 0 ) {
+		result = -1;
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef SPINE_CACHE_H
+#define SPINE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <spine/spine.h>
+
+/*
+Binary copies of loaded spine templates. Everything the json and atlas files were parsed into is written out once, and
+ later loads rebuild it straight from that without parsing any text. The cache files are only meant to be read back on
+ the machine that wrote them.
+*/
+
+typedef struct {
+	uint8_t* data;
+	size_t size;
+	size_t arenaSize; // how much the runtime allocated the last time the file was loaded, 0 if it isn't known
+} SpineCacheFile;
+
+/*
+Hashes the files a template is loaded from, a cache file is only used if it was made from the same ones.
+*/
+uint64_t spineCache_Key( const char* jsonText, size_t jsonLength, const char* atlasText, size_t atlasLength );
+
+/*
+Reads in the cache file if it was made from the files with the key, and written in the current format.
+ Returns <0 if there's no usable cache file.
+*/
+int spineCache_Open( const char* fileName, uint64_t key, SpineCacheFile* outFile );
+
+/*
+Frees up the data read in by spineCache_Open( ).
+*/
+void spineCache_Close( SpineCacheFile* file );
+
+/*
+Creates the atlas, skeleton data, and animation state data stored in the cache file. Everything is made through the
+ spine runtime, so it's disposed of in the usual way. The atlas pages are loaded from atlasDir.
+ Returns <0 if there's a problem, nothing is created if there is.
+*/
+int spineCache_Load( const SpineCacheFile* file, const char* atlasDir, spAtlas** outAtlas,
+	spSkeletonData** outSkeletonData, spAnimationStateData** outStateData );
+
+/*
+Writes out a cache file for the template that was loaded from the files with the key.
+ Returns <0 if there's a problem.
+*/
+int spineCache_Write( const char* fileName, uint64_t key, const spAtlas* atlas, const spSkeletonData* skeletonData,
+	const spAnimationStateData* stateData );
+
+/*
+Updates how much the runtime allocated loading from the cache file, so the next load can set it all aside at once.
+ Returns <0 if there's a problem.
+*/
+int spineCache_SaveArenaSize( const char* fileName, size_t arenaSize );
+
+#endif /* inclusion guard */
\ No newline at end of file
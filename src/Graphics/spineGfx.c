@@ -2,24 +2,115 @@
 
 #include <SDL.h>
 #include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
 #include <spine/extension.h>
 
+#include "graphics.h"
 #include "triRendering.h"
 #include "debugRendering.h"
 #include "gfxUtil.h"
+#include "textureManager.h"
+#include "camera.h"
+#include "spineCache.h"
+#include "../Math/mathUtil.h"
 #include "../System/memory.h"
+#include "../System/jobs.h"
+#include "../System/cacheFile.h"
+#include "../Utils/stretchyBuffer.h"
 
 // templates
 typedef struct {
 	spSkeletonData* skeletonData;
 	spAtlas* atlas;
 	spAnimationStateData* stateData;
+	Vector2 setupBoundsMin; // relative to the skeleton position, used until an instance has been drawn
+	Vector2 setupBoundsMax;
+	Vector2 attachmentMarginMin; // how far the attachments reach past the bones in the setup pose
+	Vector2 attachmentMarginMax;
+	uint8_t* loadArena; // what the runtime allocated while loading from the cache, NULL if it all went to the heap
+	size_t loadArenaSize;
 } SpineTemplate;
 
 #define MAX_TEMPLATES 256
 static SpineTemplate templates[MAX_TEMPLATES];
 
+// the first time a template is loaded it's parsed from the json and atlas files, and everything the spine runtime made
+//  from them is written to a cache file in the user's pref directory. after that it's rebuilt from the cache, which
+//  makes next to nothing temporary, so it's all handed out of one arena sized from what the last load from the cache
+//  used. anything that doesn't fit goes to the heap. nothing in the arena is released on its own, the whole thing is
+//  released along with the template
+#define LOAD_ARENA_ALIGN( size ) ( ( (size) + 7 ) & ~(size_t)7 )
+
+// the load from a cache going on right now, templates are only loaded on the main thread while nothing is being updated
+static int loadingTemplate = 0;
+static uint8_t* loadArena = NULL;
+static size_t loadArenaSize;
+static size_t loadArenaUsed;
+static size_t loadTotalSize; // everything allocated during the load, including what didn't fit in the arena
+
+// the arenas of all the loaded templates, anything released that's in one of these is left alone
+typedef struct {
+	const uint8_t* start;
+	const uint8_t* end;
+} ArenaRange;
+
+static ArenaRange arenaRanges[MAX_TEMPLATES + 1];
+static int numArenaRanges = 0;
+static const uint8_t* arenasStart = NULL; // covers all the arenas, so most releases can skip checking each one
+static const uint8_t* arenasEnd = NULL;
+
+// baked animations, the triangles of each pose of an animation sampled at a fixed rate
+// an attachment in a pose, only the positions change between poses so the uvs and indices point at the attachments
+//  own, which last as long as the template does
+typedef struct {
+	Texture* texture;
+	Color color;
+	const float* uvs;
+	const int* indices;
+	int firstVert;
+	int numVerts;
+	int numIndices;
+} BakedDraw;
+
+typedef struct {
+	spAnimation* animation; // NULL if this isn't in use
+	int templateIdx;
+	float sampleRate;
+	int numFrames;
+	int* sbFrameFirstDraw; // numFrames + 1 entries, the draws for a frame run up to the start of the next one
+	BakedDraw* sbDraws;
+	float* sbPositions; // x, y pairs relative to the skeleton position
+	Vector2 boundsMin; // covers every frame
+	Vector2 boundsMax;
+} BakedAnimation;
+
+#define MAX_BAKED_ANIMATIONS 64
+static BakedAnimation bakes[MAX_BAKED_ANIMATIONS];
+
 // instances
+// events from the animation state while the instances are being updated, they're passed on to the listener afterwards
+typedef struct {
+	int instanceID;
+	spAnimationStateListener listener;
+	int trackIndex;
+	spEventType type;
+	spEvent* event;
+	int loopCount;
+} QueuedEvent;
+
+// spine calls the listeners set on track entries as well as the one on the state, those are swapped out for one that
+//  queues the events too, the entry that fires an event is always the current one on its track
+typedef struct {
+	spTrackEntry* entry;
+	spAnimationStateListener listener;
+} TrackListener;
+
+#define MAX_TRACK_LISTENERS 8
+
 typedef struct {
 	int templateIdx;
 	int cameraFlags;
@@ -27,12 +118,76 @@ typedef struct {
 	Vector2 endPos;
 	spSkeleton* skeleton;
 	spAnimationState* state;
+	spAnimationStateListener listener;
+	int updateChunk; // the chunk of the update it was in, events it fires during the update are queued for that chunk
+	TrackListener trackListeners[MAX_TRACK_LISTENERS];
+	int numTrackListeners;
+	Vector2 boundsMin; // relative to the skeleton position, from the last time it was drawn or updated off screen
+	Vector2 boundsMax;
+	int visible; // whether any camera could see it the last time the instances were drawn
+	float pendingDt; // time that's passed that hasn't been applied to the animation yet
+	int bakeID; // the baked animation being played, -1 if the skeleton is animated
+	float bakeTime;
+	int bakeLoop;
+	int handleIdx; // the handle pointing at this instance
 	char depth;
 } SpineInstance;
 
+// the instances are kept packed together at the start of the array so the per frame loops don't have to skip over
+//  empty spots, which means they move around when one is cleaned up. the ids handed out are for handles that keep
+//  track of where each instance is, with a generation so ids for cleaned up instances are caught
+typedef struct {
+	int instanceIdx; // -1 if the handle isn't in use
+	int generation;
+	int nextFree;
+} InstanceHandle;
+
 #define MAX_INSTANCES 2048
 static SpineInstance instances[MAX_INSTANCES];
-static int lastInstance = -1;
+static int numInstances = 0;
+
+static InstanceHandle handles[MAX_INSTANCES];
+static int firstFreeHandle = -1;
+
+#define INSTANCE_HANDLE_BITS 16
+#define INSTANCE_HANDLE_MASK ( ( 1 << INSTANCE_HANDLE_BITS ) - 1 )
+#define MAX_INSTANCE_GENERATION 0x7fff
+
+#if MAX_INSTANCES > ( INSTANCE_HANDLE_MASK + 1 )
+	#error "spineGfx MAX_INSTANCES is too large to fit into an instance id."
+#endif
+
+// the instances are updated in chunks spread across the job threads, aim for a few chunks per thread so they even out
+#define UPDATE_CHUNKS_PER_THREAD 4
+#define MIN_UPDATE_CHUNK_SIZE 8
+#define MAX_UPDATE_CHUNKS ( ( MAX_INSTANCES + MIN_UPDATE_CHUNK_SIZE - 1 ) / MIN_UPDATE_CHUNK_SIZE )
+static int updatingInstances = 0;
+
+// events fired during the update, each chunk only touches its own buffer so they don't need a lock. going through the
+//  chunks in order passes the events on in the order of the instances
+static QueuedEvent* sbChunkEvents[MAX_UPDATE_CHUNKS];
+
+// instances that can't be seen are only updated every few frames, spread out so they don't all land on the same one
+#define DEFAULT_OFFSCREEN_UPDATE_INTERVAL 4
+static int offscreenUpdateInterval = DEFAULT_OFFSCREEN_UPDATE_INTERVAL;
+static unsigned int updateFrame = 0;
+
+// the bounds are from the last pose drawn or updated, give them some room so an instance that's moving isn't culled
+//  too early
+#define BOUNDS_PADDING_SCALE 0.25f
+
+typedef struct {
+	float dt;
+	unsigned int frame;
+	int chunkSize;
+} UpdateParams;
+
+// where the triangles generated for a skeleton go, either straight to the triangle renderer or into a baked animation
+typedef struct {
+	BakedAnimation* bake; // NULL to send them to the renderer
+	int camFlags;
+	char depth;
+} TriangleTarget;
 
 // working memory
 #define MAX_SPINE_VERTS 1000
@@ -63,6 +218,8 @@ void _spAtlasPage_createTexture( spAtlasPage* self, const char* path )
 
 void _spAtlasPage_disposeTexture( spAtlasPage* self )
 {
+	// the frame the render thread is drawing may still be using it
+	gfx_WaitForRenderThread( );
 	gfxUtil_UnloadTexture( (Texture*)self->rendererObject );
 	mem_Release( self->rendererObject );
 }
@@ -72,26 +229,326 @@ char* _spUtil_readFile( const char* path, int* length )
 	return _readFile(path, length);
 }
 
+static void growArenasBounds( const ArenaRange* range )
+{
+	if( ( arenasStart == NULL ) || ( range->start < arenasStart ) ) {
+		arenasStart = range->start;
+	}
+
+	if( range->end > arenasEnd ) {
+		arenasEnd = range->end;
+	}
+}
+
+static void addArenaRange( const uint8_t* start, size_t size )
+{
+	ArenaRange* range = &( arenaRanges[numArenaRanges++] );
+	range->start = start;
+	range->end = start + size;
+	growArenasBounds( range );
+}
+
+static void removeArenaRange( const uint8_t* start )
+{
+	for( int i = 0; i < numArenaRanges; ++i ) {
+		if( arenaRanges[i].start == start ) {
+			arenaRanges[i] = arenaRanges[--numArenaRanges];
+			break;
+		}
+	}
+
+	arenasStart = NULL;
+	arenasEnd = NULL;
+	for( int i = 0; i < numArenaRanges; ++i ) {
+		growArenasBounds( &( arenaRanges[i] ) );
+	}
+}
+
+static int isInArena( const uint8_t* data )
+{
+	if( ( data < arenasStart ) || ( data >= arenasEnd ) ) {
+		return 0;
+	}
+
+	for( int i = 0; i < numArenaRanges; ++i ) {
+		if( ( data >= arenaRanges[i].start ) && ( data < arenaRanges[i].end ) ) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// the instances are updated on the job threads, the memory system is guarded by a lock so these are safe to call from them
+//  the arenas are only changed while they're not running
 void* Allocate_Spine( size_t size )
 {
+	if( loadingTemplate ) {
+		size_t alignedSize = LOAD_ARENA_ALIGN( size );
+		loadTotalSize += alignedSize;
+		if( ( loadArena != NULL ) && ( alignedSize <= ( loadArenaSize - loadArenaUsed ) ) ) {
+			void* data = loadArena + loadArenaUsed;
+			loadArenaUsed += alignedSize;
+			return data;
+		}
+	}
+
 	return mem_Allocate_Data( size, __FILE__, __LINE__ );
 }
 
 void Release_Spine( void* data )
 {
+	if( ( data == NULL ) || isInArena( (const uint8_t*)data ) ) {
+		return;
+	}
+
 	mem_Release_Data( data, __FILE__, __LINE__ );
 }
 
+/*
+Starts handing out the allocations the spine runtime makes out of an arena, if it's known how big it needs to be.
+ Returns whether an arena is being used.
+*/
+static int beginTemplateLoad( size_t arenaSize )
+{
+	loadingTemplate = 1;
+	loadArena = NULL;
+	loadArenaSize = 0;
+	loadArenaUsed = 0;
+	loadTotalSize = 0;
+
+	if( arenaSize == 0 ) {
+		return 0;
+	}
+
+	loadArena = mem_Allocate( arenaSize );
+	if( loadArena == NULL ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to allocate arena to load spine template into." );
+		return 0;
+	}
+
+	loadArenaSize = arenaSize;
+	addArenaRange( loadArena, loadArenaSize );
+	return 1;
+}
+
+/*
+Stops using the arena for allocations, the template keeps it until it's cleaned up.
+*/
+static void endTemplateLoad( SpineTemplate* spineTemplate )
+{
+	spineTemplate->loadArena = loadArena;
+	spineTemplate->loadArenaSize = loadArenaSize;
+
+	loadingTemplate = 0;
+	loadArena = NULL;
+	loadArenaSize = 0;
+}
+
+/*
+Frees the arena the template was loaded into, everything the runtime made for the template has to be disposed first.
+*/
+static void releaseLoadArena( SpineTemplate* spineTemplate )
+{
+	if( spineTemplate->loadArena == NULL ) {
+		return;
+	}
+
+	removeArenaRange( spineTemplate->loadArena );
+	mem_Release( spineTemplate->loadArena );
+	spineTemplate->loadArena = NULL;
+	spineTemplate->loadArenaSize = 0;
+}
+
+/*
+Reads the entire file into memory with a terminator on the end, so it can be used as a string.
+ Returns NULL if there's a problem.
+*/
+static char* readTextFile( const char* fileName, size_t* outLength )
+{
+	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "rb" );
+	if( rwopsFile == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to open %s.", fileName );
+		return NULL;
+	}
+
+	char* text = NULL;
+	Sint64 size = SDL_RWsize( rwopsFile );
+	if( size < 0 ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to get size of %s.", fileName );
+		goto clean_up;
+	}
+
+	text = mem_Allocate( (size_t)size + 1 );
+	if( text == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to allocate memory to read %s.", fileName );
+		goto clean_up;
+	}
+
+	if( SDL_RWread( rwopsFile, text, 1, (size_t)size ) != (size_t)size ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to read %s.", fileName );
+		mem_Release( text );
+		text = NULL;
+	} else {
+		text[size] = 0;
+		(*outLength) = (size_t)size;
+	}
+
+clean_up:
+	SDL_RWclose( rwopsFile );
+	return text;
+}
+
+/*
+Grows the bounds to hold all the vertices, which are stored as x, y pairs.
+*/
+static void addToBounds( const float* vertices, int numFloats, Vector2* min, Vector2* max )
+{
+	for( int i = 0; i < numFloats; i += 2 ) {
+		min->x = MIN( min->x, vertices[i] );
+		min->y = MIN( min->y, vertices[i+1] );
+		max->x = MAX( max->x, vertices[i] );
+		max->y = MAX( max->y, vertices[i+1] );
+	}
+}
+
+/*
+Finds the bounds of the bones of a skeleton that's had its world transform updated. The bones world positions don't
+ include the skeleton position so they're already relative to it.
+ Returns <0 if the skeleton doesn't have any bones.
+*/
+static int getBoneBounds( spSkeleton* skeleton, Vector2* outMin, Vector2* outMax )
+{
+	if( skeleton->bonesCount <= 0 ) {
+		return -1;
+	}
+
+	Vector2 min = { FLT_MAX, FLT_MAX };
+	Vector2 max = { -FLT_MAX, -FLT_MAX };
+	for( int i = 0; i < skeleton->bonesCount; ++i ) {
+		spBone* bone = skeleton->bones[i];
+		min.x = MIN( min.x, bone->worldX );
+		min.y = MIN( min.y, bone->worldY );
+		max.x = MAX( max.x, bone->worldX );
+		max.y = MAX( max.y, bone->worldY );
+	}
+
+	(*outMin) = min;
+	(*outMax) = max;
+	return 0;
+}
+
+/*
+Finds the bounds of the setup pose of the template, new instances use them until they've been drawn. Also finds how
+ far the attachments reach past the bones, so the bounds of instances that aren't drawn can be kept up to date from
+ just their bones.
+*/
+static void computeSetupBounds( SpineTemplate* spineTemplate )
+{
+	Vector2 min = { FLT_MAX, FLT_MAX };
+	Vector2 max = { -FLT_MAX, -FLT_MAX };
+
+	spineTemplate->setupBoundsMin = VEC2_ZERO;
+	spineTemplate->setupBoundsMax = VEC2_ZERO;
+	spineTemplate->attachmentMarginMin = VEC2_ZERO;
+	spineTemplate->attachmentMarginMax = VEC2_ZERO;
+
+	// posed the same way as the instances, at the origin
+	spSkeleton* skeleton = spSkeleton_create( spineTemplate->skeletonData );
+	if( skeleton == NULL ) {
+		return;
+	}
+	skeleton->flipX = 0;
+	skeleton->flipY = 1;
+	spSkeleton_setToSetupPose( skeleton );
+	spSkeleton_updateWorldTransform( skeleton );
+
+	for( int i = 0; i < skeleton->slotsCount; ++i ) {
+		spSlot* slot = skeleton->drawOrder[i];
+		spAttachment* attachment = slot->attachment;
+		if( attachment == NULL ) {
+			continue;
+		}
+
+		switch( attachment->type ) {
+		case SP_ATTACHMENT_REGION: {
+				float vertices[8];
+				spRegionAttachment_computeWorldVertices( (spRegionAttachment*)attachment, slot->bone, vertices );
+				addToBounds( vertices, 8, &min, &max );
+			} break;
+		case SP_ATTACHMENT_MESH: {
+				spMeshAttachment* meshAttachment = (spMeshAttachment*)attachment;
+				assert( meshAttachment->verticesCount < MAX_SPINE_VERTS );
+				spMeshAttachment_computeWorldVertices( meshAttachment, slot, spineVertices );
+				addToBounds( spineVertices, meshAttachment->verticesCount, &min, &max );
+			} break;
+		case SP_ATTACHMENT_SKINNED_MESH: {
+				spSkinnedMeshAttachment* skinnedMeshAttachment = (spSkinnedMeshAttachment*)attachment;
+				spSkinnedMeshAttachment_computeWorldVertices( skinnedMeshAttachment, slot, spineVertices );
+				addToBounds( spineVertices, skinnedMeshAttachment->uvsCount, &min, &max );
+			} break;
+		default:
+			break;
+		}
+	}
+
+	Vector2 boneMin, boneMax;
+	int hasBones = ( getBoneBounds( skeleton, &boneMin, &boneMax ) >= 0 );
+
+	spSkeleton_dispose( skeleton );
+
+	if( ( min.x <= max.x ) && ( min.y <= max.y ) ) {
+		spineTemplate->setupBoundsMin = min;
+		spineTemplate->setupBoundsMax = max;
+
+		if( hasBones ) {
+			spineTemplate->attachmentMarginMin.x = MAX( 0.0f, boneMin.x - min.x );
+			spineTemplate->attachmentMarginMin.y = MAX( 0.0f, boneMin.y - min.y );
+			spineTemplate->attachmentMarginMax.x = MAX( 0.0f, max.x - boneMax.x );
+			spineTemplate->attachmentMarginMax.y = MAX( 0.0f, max.y - boneMax.y );
+		}
+	}
+}
+
+/*
+Frees up a baked animation, any instances playing it go back to being animated.
+*/
+static void releaseBake( int bakeID )
+{
+	BakedAnimation* bake = &( bakes[bakeID] );
+
+	for( int i = 0; i < numInstances; ++i ) {
+		if( instances[i].bakeID == bakeID ) {
+			instances[i].bakeID = -1;
+		}
+	}
+
+	sb_Release( bake->sbFrameFirstDraw );
+	sb_Release( bake->sbDraws );
+	sb_Release( bake->sbPositions );
+	memset( bake, 0, sizeof( *bake ) );
+}
+
 // general system functions
 void spine_Init( void )
 {
 	memset( templates, 0, sizeof( templates ) );
 	memset( instances, 0, sizeof( instances ) );
+	memset( bakes, 0, sizeof( bakes ) );
 
 	_setMalloc( Allocate_Spine );
 	_setFree( Release_Spine );
 
-	lastInstance = -1;
+	numInstances = 0;
+	for( int i = 0; i < MAX_INSTANCES; ++i ) {
+		handles[i].instanceIdx = -1;
+		handles[i].generation = 1;
+		handles[i].nextFree = ( i < ( MAX_INSTANCES - 1 ) ) ? ( i + 1 ) : -1;
+	}
+	firstFreeHandle = 0;
+
+	offscreenUpdateInterval = DEFAULT_OFFSCREEN_UPDATE_INTERVAL;
+	updateFrame = 0;
 }
 
 void spine_CleanEverything( void )
@@ -100,20 +557,108 @@ void spine_CleanEverything( void )
 	for( int i = 0; i < MAX_TEMPLATES; ++i ) {
 		spine_CleanTemplate( i );
 	}
+
+	for( int i = 0; i < MAX_UPDATE_CHUNKS; ++i ) {
+		sb_Release( sbChunkEvents[i] );
+		sbChunkEvents[i] = NULL;
+	}
 }
 
 // template handling
+/*
+Loads the template from its cache file, everything the runtime makes goes in one arena if it's known how big it needs
+ to be. If it isn't, or it's changed, the size is saved for next time.
+ Returns <0 if there's no usable cache file or there's a problem loading it.
+*/
+static int loadTemplateFromCache( SpineTemplate* spineTemplate, const char* cacheName, uint64_t key,
+	const char* atlasDir )
+{
+	SpineCacheFile cacheFile;
+	if( spineCache_Open( cacheName, key, &cacheFile ) < 0 ) {
+		return -1;
+	}
+
+	beginTemplateLoad( cacheFile.arenaSize );
+	int result = spineCache_Load( &cacheFile, atlasDir, &( spineTemplate->atlas ), &( spineTemplate->skeletonData ),
+		&( spineTemplate->stateData ) );
+	endTemplateLoad( spineTemplate );
+
+	if( result < 0 ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to load spine cache %s", cacheName );
+		releaseLoadArena( spineTemplate );
+	} else if( ( loadTotalSize != cacheFile.arenaSize ) && ( spineCache_SaveArenaSize( cacheName, loadTotalSize ) < 0 ) ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to save spine load size to %s", cacheName );
+	}
+
+	spineCache_Close( &cacheFile );
+	return result;
+}
+
+/*
+Parses the template from the json and atlas text, everything the runtime makes goes on the heap, including everything
+ temporary it needs for parsing.
+ Returns <0 if there's a problem.
+*/
+static int loadTemplateFromJson( SpineTemplate* spineTemplate, const char* jsonText, const char* atlasText,
+	size_t atlasLength, const char* atlasDir )
+{
+	spSkeletonJson* json;
+
+	spineTemplate->atlas = spAtlas_create( atlasText, (int)atlasLength, atlasDir, 0 );
+	if( spineTemplate->atlas == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to load atlas." );
+		goto error;
+	}
+
+	json = spSkeletonJson_create( spineTemplate->atlas );
+	if( json == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create skeleton JSON." );
+		goto error;
+	}
+
+	json->scale = 1.0f;
+
+	spineTemplate->skeletonData = spSkeletonJson_readSkeletonData( json, jsonText );
+	spSkeletonJson_dispose( json );
+	if( spineTemplate->skeletonData == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create skeleton data." );
+		goto error;
+	}
+
+	spineTemplate->stateData = spAnimationStateData_create( spineTemplate->skeletonData );
+	if( spineTemplate->stateData == NULL ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create animation state data." );
+		goto error;
+	}
+
+	return 0;
+
+error:
+	if( spineTemplate->skeletonData != NULL ) {
+		spSkeletonData_dispose( spineTemplate->skeletonData );
+		spineTemplate->skeletonData = NULL;
+	}
+
+	if( spineTemplate->atlas != NULL ) {
+		spAtlas_dispose( spineTemplate->atlas );
+		spineTemplate->atlas = NULL;
+	}
+
+	return -1;
+}
+
 /*
 Loads a set of spine files. Assumes there's three files: fileNameBase.json, fileNameBase.atlas, and fileNameBase.png.
-The template is created from these three files.
+The template is created from these three files. The first time they're loaded everything made from them is saved to a
+ cache file in the user's pref directory, later loads are made from that instead of parsing the files again.
 Returns the index of the template if the loading was successfull, -1 if it was not.
 */
 int spine_LoadTemplate( const char* fileNameBase )
 {
 	char atlasName[256];
-	char pngName[256];
 	char jsonName[256];
-	spSkeletonJson* json;
+	char cacheName[512];
+	char atlasDir[256];
 
 	int idx;
 	for( idx = 0; ( templates[idx].skeletonData != NULL ) && ( idx < MAX_TEMPLATES ); ++idx ) ;
@@ -123,49 +668,66 @@ int spine_LoadTemplate( const char* fileNameBase )
 
 	SDL_snprintf( atlasName, sizeof( atlasName ), "%s.atlas", fileNameBase );
 	SDL_snprintf( jsonName, sizeof( jsonName ), "%s.json", fileNameBase );
-	SDL_snprintf( pngName, sizeof( pngName ), "%s.png", fileNameBase );
 
-	templates[idx].atlas = spAtlas_createFromFile( atlasName, 0 );
-	if( templates[idx].atlas == NULL ) {
-		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to load atlas." );
-		return -1;
+	// the atlas pages are relative to the atlas
+	size_t dirLength = 0;
+	for( size_t i = 0; atlasName[i] != 0; ++i ) {
+		if( ( atlasName[i] == '/' ) || ( atlasName[i] == '\\' ) ) {
+			dirLength = i;
+		}
 	}
-
-	json = spSkeletonJson_create( templates[idx].atlas );
-	if( json == NULL ) {
-		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create skeleton JSON." );
-
-		spAtlas_dispose( templates[idx].atlas );
-		templates[idx].atlas = NULL;
-
+	SDL_strlcpy( atlasDir, atlasName, dirLength + 1 );
+
+	Uint64 startCounter = SDL_GetPerformanceCounter( );
+
+	// the files are read even when loading from the cache, to make sure it was made from them
+	size_t atlasLength = 0;
+	size_t jsonLength = 0;
+	char* atlasText = readTextFile( atlasName, &atlasLength );
+	char* jsonText = readTextFile( jsonName, &jsonLength );
+	if( ( atlasText == NULL ) || ( jsonText == NULL ) ) {
+		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to read spine files." );
+		mem_Release( atlasText );
+		mem_Release( jsonText );
 		return -1;
 	}
 
-	json->scale = 1.0f;
+	SpineTemplate* spineTemplate = &( templates[idx] );
+	uint64_t key = spineCache_Key( jsonText, jsonLength, atlasText, atlasLength );
+	const char* cacheFileName = NULL;
+	if( cacheFile_GetName( jsonName, ".spcache", cacheName, sizeof( cacheName ) ) >= 0 ) {
+		cacheFileName = cacheName;
+	}
 
-	templates[idx].skeletonData = spSkeletonJson_readSkeletonDataFile( json, jsonName );
-	spSkeletonJson_dispose( json );
-	if( templates[idx].skeletonData == NULL ) {
-		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create skeleton data." );
+	int fromCache = ( cacheFileName != NULL ) &&
+		( loadTemplateFromCache( spineTemplate, cacheFileName, key, atlasDir ) >= 0 );
+	int result = 0;
+	if( !fromCache ) {
+		result = loadTemplateFromJson( spineTemplate, jsonText, atlasText, atlasLength, atlasDir );
+		if( ( result >= 0 ) && ( cacheFileName != NULL ) &&
+			( spineCache_Write( cacheFileName, key, spineTemplate->atlas, spineTemplate->skeletonData,
+				spineTemplate->stateData ) < 0 ) ) {
+			SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to write spine cache %s", cacheFileName );
+		}
+	}
 
-		spAtlas_dispose( templates[idx].atlas );
-		templates[idx].atlas = NULL;
+	mem_Release( atlasText );
+	mem_Release( jsonText );
 
+	if( result < 0 ) {
 		return -1;
 	}
-	
 
-	templates[idx].stateData = spAnimationStateData_create( templates[idx].skeletonData );
-	if( templates[idx].stateData == NULL ) {
-		SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unable to create animation state data." );
-
-		spSkeletonData_dispose( templates[idx].skeletonData );
-		templates[idx].skeletonData = NULL;
+	computeSetupBounds( spineTemplate );
 
-		spAtlas_dispose( templates[idx].atlas );
-		templates[idx].atlas = NULL;
-
-		return -1;
+	double loadMS =
+		(double)( SDL_GetPerformanceCounter( ) - startCounter ) * 1000.0 / (double)SDL_GetPerformanceFrequency( );
+	if( fromCache ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Loaded spine template %s from its cache in %.2f ms, %i KB allocated%s",
+			fileNameBase, loadMS, (int)( loadTotalSize / 1024 ),
+			( spineTemplate->loadArena != NULL ) ? " from one arena" : "" );
+	} else {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_VIDEO, "Loaded spine template %s from json in %.2f ms", fileNameBase, loadMS );
 	}
 
 	return idx;
@@ -180,6 +742,12 @@ void spine_CleanTemplate( int idx )
 	assert( idx >= 0 );
 	assert( idx < MAX_TEMPLATES );
 
+	for( int i = 0; i < MAX_BAKED_ANIMATIONS; ++i ) {
+		if( ( bakes[i].animation != NULL ) && ( bakes[i].templateIdx == idx ) ) {
+			releaseBake( i );
+		}
+	}
+
 	if( templates[idx].stateData != NULL ) {
 		spAnimationStateData_dispose( templates[idx].stateData );
 		templates[idx].stateData = NULL;
@@ -192,8 +760,9 @@ void spine_CleanTemplate( int idx )
 		spAtlas_dispose( templates[idx].atlas );
 		templates[idx].atlas = NULL;
 	}
+	releaseLoadArena( &( templates[idx] ) );
 
-	for( int i = 0; i < lastInstance; ++i ) {
+	for( int i = 0; i < numInstances; ++i ) {
 		if( instances[i].templateIdx == idx ) {
 			SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Found a spine instance using a freed template." );
 		}
@@ -217,6 +786,147 @@ void spine_SetTemplateMix( int templateIdx, const char* fromName, const char* to
 }
 
 // instance handling
+static int makeInstanceID( int handleIdx )
+{
+	return ( ( handles[handleIdx].generation << INSTANCE_HANDLE_BITS ) | handleIdx );
+}
+
+/*
+Converts an instance id into where the instance currently is in the instances array.
+ Returns a negative value if the id isn't for an instance currently in use.
+*/
+static int instanceIDToIndex( int id )
+{
+	if( id < 0 ) {
+		return -1;
+	}
+
+	int handleIdx = ( id & INSTANCE_HANDLE_MASK );
+	if( ( handleIdx >= MAX_INSTANCES ) || ( handles[handleIdx].instanceIdx < 0 ) ||
+		( handles[handleIdx].generation != ( id >> INSTANCE_HANDLE_BITS ) ) ) {
+		return -1;
+	}
+
+	return handles[handleIdx].instanceIdx;
+}
+
+/*
+Passes on the event to the listener. While the instances are being updated this is called from the job threads, so
+ the event is held onto until the update is done.
+*/
+static void queueEvent( SpineInstance* instance, spAnimationStateListener listener, spAnimationState* state, int trackIndex,
+	spEventType type, spEvent* event, int loopCount )
+{
+	if( listener == NULL ) {
+		return;
+	}
+
+	if( !updatingInstances ) {
+		listener( state, trackIndex, type, event, loopCount );
+		return;
+	}
+
+	QueuedEvent queued;
+	queued.instanceID = makeInstanceID( instance->handleIdx );
+	queued.listener = listener;
+	queued.trackIndex = trackIndex;
+	queued.type = type;
+	queued.event = event;
+	queued.loopCount = loopCount;
+	sb_Push( sbChunkEvents[instance->updateChunk], queued );
+}
+
+/*
+Listener set on the animation state of every instance, passes the event on to the instances listener.
+*/
+static void queueListenerEvent( spAnimationState* state, int trackIndex, spEventType type, spEvent* event, int loopCount )
+{
+	// the instance can move, so the state holds onto its handle instead
+	int handleIdx = (int)(intptr_t)state->rendererObject;
+	SpineInstance* instance = &( instances[handles[handleIdx].instanceIdx] );
+	queueEvent( instance, instance->listener, state, trackIndex, type, event, loopCount );
+}
+
+/*
+Listener swapped in for the ones set on track entries, passes the event on to the listener the entry had.
+*/
+static void queueTrackListenerEvent( spAnimationState* state, int trackIndex, spEventType type, spEvent* event, int loopCount )
+{
+	int handleIdx = (int)(intptr_t)state->rendererObject;
+	SpineInstance* instance = &( instances[handles[handleIdx].instanceIdx] );
+
+	spTrackEntry* entry = state->tracks[trackIndex];
+	for( int i = 0; i < instance->numTrackListeners; ++i ) {
+		if( instance->trackListeners[i].entry == entry ) {
+			queueEvent( instance, instance->trackListeners[i].listener, state, trackIndex, type, event, loopCount );
+			return;
+		}
+	}
+}
+
+/*
+Adds the entry to the track listeners if it has a listener, keeping the one it had before if it was already swapped out.
+*/
+static void swapTrackListener( SpineInstance* instance, const TrackListener* oldListeners, int numOldListeners,
+	spTrackEntry* entry )
+{
+	if( ( entry == NULL ) || ( entry->listener == NULL ) ) {
+		return;
+	}
+
+	spAnimationStateListener listener = entry->listener;
+	if( listener == queueTrackListenerEvent ) {
+		listener = NULL;
+		for( int i = 0; i < numOldListeners; ++i ) {
+			if( oldListeners[i].entry == entry ) {
+				listener = oldListeners[i].listener;
+				break;
+			}
+		}
+	}
+
+	if( listener == NULL ) {
+		entry->listener = NULL;
+		return;
+	}
+
+	if( instance->numTrackListeners >= MAX_TRACK_LISTENERS ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_RENDER, "Too many spine track entry listeners on one instance, listener removed." );
+		entry->listener = NULL;
+		return;
+	}
+
+	instance->trackListeners[instance->numTrackListeners].entry = entry;
+	instance->trackListeners[instance->numTrackListeners].listener = listener;
+	++instance->numTrackListeners;
+	entry->listener = queueTrackListenerEvent;
+}
+
+/*
+Swaps out the listeners on all the track entries of the instance so they're queued like the state's listener. Entries
+ that have been disposed of since the last time are dropped as they can't be reached from the tracks anymore.
+*/
+static void swapTrackListeners( SpineInstance* instance )
+{
+	TrackListener oldListeners[MAX_TRACK_LISTENERS];
+	int numOldListeners = instance->numTrackListeners;
+	memcpy( oldListeners, instance->trackListeners, sizeof( TrackListener ) * numOldListeners );
+
+	instance->numTrackListeners = 0;
+	spAnimationState* state = instance->state;
+	for( int i = 0; i < state->tracksCount; ++i ) {
+		spTrackEntry* current = state->tracks[i];
+		if( current == NULL ) {
+			continue;
+		}
+
+		swapTrackListener( instance, oldListeners, numOldListeners, current->previous );
+		for( spTrackEntry* entry = current; entry != NULL; entry = entry->next ) {
+			swapTrackListener( instance, oldListeners, numOldListeners, entry );
+		}
+	}
+}
+
 /*
 Creates an instance of a template. The templateIdx passed in should be a value returns from spine_LoadTemplate that
  hasn't been cleaned up.
@@ -224,17 +934,13 @@ Returns an id to use in other functions. Returns -1 if there's a problem.
 */
 int spine_CreateInstance( int templateIdx, Vector2 pos, int cameraFlags, char depth, spAnimationStateListener listener )
 {
-	int idx;
-	for( idx = 0; ( instances[idx].skeleton != NULL ) && ( idx < MAX_INSTANCES ); ++idx ) ;
-	if( idx >= MAX_INSTANCES ) {
+	if( ( numInstances >= MAX_INSTANCES ) || ( firstFreeHandle < 0 ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "No space left for spine instance." );
 		return -1;
 	}
 
-	if( idx >= lastInstance ) {
-		lastInstance = idx;
-	}
-
-	SpineInstance* charState = &( instances[idx] );
+	int handleIdx = firstFreeHandle;
+	SpineInstance* charState = &( instances[numInstances] );
 
 	charState->skeleton = spSkeleton_create( templates[templateIdx].skeletonData );
 	if( charState->skeleton == NULL ) {
@@ -261,38 +967,69 @@ int spine_CreateInstance( int templateIdx, Vector2 pos, int cameraFlags, char de
 	charState->skeleton->flipY = 1;
 	spSkeleton_setToSetupPose( charState->skeleton );
 
-	charState->state->listener = listener;
+	charState->listener = listener;
+	charState->updateChunk = 0;
+	charState->numTrackListeners = 0;
+	charState->state->rendererObject = (void*)(intptr_t)handleIdx;
+	charState->state->listener = queueListenerEvent;
+
+	charState->boundsMin = templates[templateIdx].setupBoundsMin;
+	charState->boundsMax = templates[templateIdx].setupBoundsMax;
+	charState->visible = 1;
+	charState->pendingDt = 0.0f;
+	charState->bakeID = -1;
 
 	charState->templateIdx = templateIdx;
 	charState->cameraFlags = cameraFlags;
 	charState->depth = depth;
+	charState->handleIdx = handleIdx;
 
-	return idx;
+	firstFreeHandle = handles[handleIdx].nextFree;
+	handles[handleIdx].instanceIdx = numInstances;
+	++numInstances;
+
+	return makeInstanceID( handleIdx );
 }
 
 /*
-Cleans up a spine instance.
+Frees up the instance at the index, the last instance is moved into its spot to keep them packed together.
 */
-void spine_CleanInstance( int idx )
+static void removeInstance( int idx )
 {
-	assert( idx >= 0 );
-	assert( idx < MAX_INSTANCES );
-
 	SpineInstance* charState = &( instances[idx] );
-
-	if( charState->skeleton == NULL ) {
-		return;
-	}
+	int handleIdx = charState->handleIdx;
 
 	spAnimationState_dispose( charState->state );
 	spSkeleton_dispose( charState->skeleton );
 
-	charState->state = NULL;
-	charState->skeleton = NULL;
+	--numInstances;
+	if( idx != numInstances ) {
+		instances[idx] = instances[numInstances];
+		handles[instances[idx].handleIdx].instanceIdx = idx;
+	}
+	instances[numInstances].state = NULL;
+	instances[numInstances].skeleton = NULL;
+
+	++handles[handleIdx].generation;
+	if( handles[handleIdx].generation > MAX_INSTANCE_GENERATION ) {
+		handles[handleIdx].generation = 1;
+	}
+	handles[handleIdx].instanceIdx = -1;
+	handles[handleIdx].nextFree = firstFreeHandle;
+	firstFreeHandle = handleIdx;
+}
 
-	for( int i = lastInstance; ( i >= 0 ) && ( instances[idx].skeleton != NULL ); --i ) {
-		lastInstance = i;
+/*
+Cleans up a spine instance.
+*/
+void spine_CleanInstance( int id )
+{
+	int idx = instanceIDToIndex( id );
+	if( idx < 0 ) {
+		return;
 	}
+
+	removeInstance( idx );
 }
 
 /*
@@ -300,8 +1037,8 @@ Cleans up all instances.
 */
 void spine_CleanAllInstances( void )
 {
-	for( int i = 0; i < MAX_INSTANCES; ++i ) {
-		spine_CleanInstance( i );
+	while( numInstances > 0 ) {
+		removeInstance( numInstances - 1 );
 	}
 }
 
@@ -310,15 +1047,13 @@ Sets the future position of the spine instance.
 */
 void spine_SetInstancePosition( int id, const Vector2* pos )
 {
-	assert( id >= 0 );
-	assert( id < MAX_INSTANCES );
-
-	SpineInstance* charState = &( instances[id] );
-	if( charState->skeleton == NULL ) {
+	int idx = instanceIDToIndex( id );
+	assert( idx >= 0 );
+	if( idx < 0 ) {
 		return;
 	}
 
-	charState->endPos = *pos;
+	instances[idx].endPos = *pos;
 }
 
 /*
@@ -326,11 +1061,7 @@ Flips the positions used for rendering the instances.
 */
 void spine_FlipInstancePositions( void )
 {
-	for( int i = 0; i <= lastInstance; ++i ) {
-		if( instances[i].skeleton == NULL ) {
-			continue;
-		}
-		
+	for( int i = 0; i < numInstances; ++i ) {
 		instances[i].startPos = instances[i].endPos;
 	}
 }
@@ -339,80 +1070,208 @@ void spine_FlipInstancePositions( void )
 Returns the skeleton of the spine instance, if there's an issue returns NULL.
  Note: Adjustments to the skeletons x and y are overwritten in spine_RenderInstances( ).
 */
-spSkeleton* spine_GetInstanceSkeleton( int idx )
+spSkeleton* spine_GetInstanceSkeleton( int id )
 {
+	int idx = instanceIDToIndex( id );
+	if( idx < 0 ) {
+		return NULL;
+	}
+
 	return instances[idx].skeleton;
 }
 
 /*
 Returns the animation state of the spine instance, if there's an issue returns NULL.
 */
-spAnimationState* spine_GetInstanceAnimState( int idx )
+spAnimationState* spine_GetInstanceAnimState( int id )
 {
+	int idx = instanceIDToIndex( id );
+	if( idx < 0 ) {
+		return NULL;
+	}
+
 	return instances[idx].state;
 }
 
 /*
-Updates all the instance animations.
+Keeps the bounds of an instance that isn't being drawn up to date, otherwise it could move out of its old bounds and
+ never be seen again. Uses the bones with the margin the attachments had in the setup pose, which is much cheaper
+ than finding where all the attachments are.
 */
-void spine_UpdateInstances( float dt )
+static void updateBoundsFromBones( SpineInstance* instance )
 {
-	for( int i = 0; i <= lastInstance; ++i ) {
-		if( instances[i].skeleton == NULL ) {
+	Vector2 min, max;
+	if( getBoneBounds( instance->skeleton, &min, &max ) < 0 ) {
+		return;
+	}
+
+	SpineTemplate* spineTemplate = &( templates[instance->templateIdx] );
+	vec2_Subtract( &min, &( spineTemplate->attachmentMarginMin ), &( instance->boundsMin ) );
+	vec2_Add( &max, &( spineTemplate->attachmentMarginMax ), &( instance->boundsMax ) );
+}
+
+/*
+Updates a chunk of the instances, each instance only touches its own skeleton and animation state.
+*/
+static void updateInstanceRange( int first, int count, void* data )
+{
+	UpdateParams* params = (UpdateParams*)data;
+
+	for( int i = first; i < ( first + count ); ++i ) {
+		SpineInstance* instance = &( instances[i] );
+
+		if( instance->bakeID >= 0 ) {
+			instance->bakeTime += params->dt;
 			continue;
 		}
 
-		SpineInstance* instance = &( instances[i] );
+		// instances that couldn't be seen catch up on all the time they skipped when they're updated, the handle is used
+		//  to spread them out since it doesn't change when instances are moved around
+		instance->pendingDt += params->dt;
+		if( !instance->visible &&
+			( ( ( params->frame + (unsigned int)instance->handleIdx ) % (unsigned int)offscreenUpdateInterval ) != 0 ) ) {
+			continue;
+		}
+		float dt = instance->pendingDt;
+		instance->pendingDt = 0.0f;
 
+		instance->updateChunk = first / params->chunkSize;
+		swapTrackListeners( instance );
 		spSkeleton_update( instance->skeleton, dt );
 		spAnimationState_update( instance->state, dt );
 		spAnimationState_apply( instance->state, instance->skeleton );
 		spSkeleton_updateWorldTransform( instance->skeleton );
+
+		if( !instance->visible ) {
+			updateBoundsFromBones( instance );
+		}
 	}
 }
 
-static void drawCharacter( SpineInstance* spine )
+/*
+Sets how often instances that couldn't be seen the last time they were drawn are updated, in frames. They're given
+ all the time they missed when they are, so the animations stay in sync. 1 updates everything every frame.
+*/
+void spine_SetOffscreenUpdateInterval( int numFrames )
+{
+	offscreenUpdateInterval = MAX( 1, numFrames );
+}
+
+/*
+Updates all the instance animations. The instances are spread across the job threads, the listeners are called
+ afterwards on this thread, in the order of the instances. Instances that couldn't be seen are only updated every
+ few frames.
+*/
+void spine_UpdateInstances( float dt )
+{
+	UpdateParams params;
+	params.dt = dt;
+	params.frame = updateFrame++;
+
+	int chunkSize = numInstances / ( ( jobs_GetNumWorkers( ) + 1 ) * UPDATE_CHUNKS_PER_THREAD );
+	chunkSize = SDL_max( MIN_UPDATE_CHUNK_SIZE, chunkSize );
+
+	params.chunkSize = chunkSize;
+
+	updatingInstances = 1;
+	jobs_ParallelFor( numInstances, chunkSize, updateInstanceRange, &params );
+	updatingInstances = 0;
+
+	// the listeners can create and clean up instances, which moves them around, so the events hold onto the ids of the
+	//  instances instead of their positions
+	int numChunks = ( numInstances + chunkSize - 1 ) / chunkSize;
+	for( int c = 0; c < numChunks; ++c ) {
+		for( int e = 0; e < sb_Count( sbChunkEvents[c] ); ++e ) {
+			QueuedEvent queued = sbChunkEvents[c][e];
+			int idx = instanceIDToIndex( queued.instanceID );
+			if( idx >= 0 ) {
+				queued.listener( instances[idx].state, queued.trackIndex, queued.type, queued.event, queued.loopCount );
+			}
+		}
+		sb_Clear( sbChunkEvents[c] );
+	}
+}
+
+static TransparencyType getTransparency( Texture* texture, Color* col )
+{
+	if( ( texture->flags & TF_IS_TRANSPARENT ) || ( ( col->a > 0.0f ) && ( col->a < 1.0f ) ) ) {
+		return TT_TRANSLUCENT;
+	}
+
+	if( ( texture->flags & TF_HAS_CLEAR_PIXELS ) || ( col->a <= 0.0f ) ) {
+		return TT_ALPHA_TEST;
+	}
+
+	return TT_OPAQUE;
+}
+
+/*
+Adds a mesh to the end of the current frame of the baked animation, positions and uvs are x, y pairs. Only the
+ positions are copied, the uvs and indices have to stay around as long as the baked animation does.
+*/
+static void bakeMesh( BakedAnimation* bake, const float* positions, const float* uvs, int numVerts, const int* indices,
+	int numIndices, Texture* texture, Color col )
+{
+	BakedDraw* draw = sb_Add( bake->sbDraws, 1 );
+	draw->texture = texture;
+	draw->color = col;
+	draw->uvs = uvs;
+	draw->indices = indices;
+	draw->firstVert = sb_Count( bake->sbPositions ) / 2;
+	draw->numVerts = numVerts;
+	draw->numIndices = numIndices;
+
+	memcpy( sb_Add( bake->sbPositions, numVerts * 2 ), positions, sizeof( float ) * numVerts * 2 );
+}
+
+/*
+Sends a mesh to the target, the vertices go straight from spines buffers into the triangle renderer.
+*/
+static void emitMesh( TriangleTarget* target, const float* positions, const float* uvs, int numVerts, const int* indices,
+	int numIndices, Texture* texture, Color col )
 {
-	// just draw bone positions to start with
-	//GLuint texture;
+	if( target->bake != NULL ) {
+		bakeMesh( target->bake, positions, uvs, numVerts, indices, numIndices, texture, col );
+		return;
+	}
+
+	triRenderer_AddMesh( positions, uvs, numVerts, indices, numIndices, VEC2_ZERO, ST_DEFAULT, texture->textureID, col,
+		target->camFlags, target->depth, getTransparency( texture, &col ) );
+}
+
+/*
+Generates the triangles for the current pose of the skeleton, and grows the bounds to hold them.
+*/
+static void generateTriangles( spSkeleton* skeleton, TriangleTarget* target, Vector2* min, Vector2* max )
+{
+	static const int regionIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
 	Color col;
-	int camFlags = spine->cameraFlags;
-	char depth = spine->depth;
 	Texture* texture;
 
-	for( int i = 0; i < spine->skeleton->slotsCount; ++i ) {
-		spSlot* slot = spine->skeleton->drawOrder[i];
+	for( int i = 0; i < skeleton->slotsCount; ++i ) {
+		spSlot* slot = skeleton->drawOrder[i];
 		spAttachment* attachment = slot->attachment;
 		if( attachment == NULL ) {
 			continue;
 		}
 
-		col.r = spine->skeleton->r * slot->r;
-		col.g = spine->skeleton->g * slot->g;
-		col.b = spine->skeleton->b * slot->b;
-		col.a = spine->skeleton->a * slot->a;
+		col.r = skeleton->r * slot->r;
+		col.g = skeleton->g * slot->g;
+		col.b = skeleton->b * slot->b;
+		col.a = skeleton->a * slot->a;
 
 		switch( attachment->type ) {
 		case SP_ATTACHMENT_REGION: {
 				float vertices[8];
 				spRegionAttachment* regionAttachment = (spRegionAttachment*)attachment;
 				spRegionAttachment_computeWorldVertices( regionAttachment, slot->bone, vertices );
-
-				Vector2 positions[4];
-				Vector2 uvs[4];
-
-				for( int i = 0; i < 4; ++i ) {
-					positions[i].x = vertices[2*i];
-					positions[i].y = vertices[(2*i)+1];
-
-					uvs[i].s = regionAttachment->uvs[2*i];
-					uvs[i].t = regionAttachment->uvs[(2*i)+1];
-				}
+				addToBounds( vertices, 8, min, max );
 
 				texture = (Texture*)((spAtlasRegion*)regionAttachment->rendererObject)->page->rendererObject;
+				texMgr_MarkUsed( texture->textureID );
 
-				triRenderer_Add( positions[0], positions[1], positions[2], uvs[0], uvs[1], uvs[2], ST_DEFAULT, texture->textureID, col, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
-				triRenderer_Add( positions[0], positions[2], positions[3], uvs[0], uvs[2], uvs[3], ST_DEFAULT, texture->textureID, col, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
+				emitMesh( target, vertices, regionAttachment->uvs, 4, regionIndices, 6, texture, col );
 			} break;
 		/*case SP_ATTACHMENT_BOUNDING_BOX: {
 				// if we're debugging 
@@ -437,46 +1296,24 @@ static void drawCharacter( SpineInstance* spine )
 				assert( meshAttachment->verticesCount < MAX_SPINE_VERTS );
 
 				spMeshAttachment_computeWorldVertices( meshAttachment, slot, spineVertices );
+				addToBounds( spineVertices, meshAttachment->verticesCount, min, max );
 
 				texture = (Texture*)((spAtlasRegion*)meshAttachment->rendererObject)->page->rendererObject;
+				texMgr_MarkUsed( texture->textureID );
 
-				for( int i = 0; i < meshAttachment->trianglesCount; i+=3 ) {
-					Vector2 verts[3];
-					Vector2 uvs[3];
-					
-					for( int j = 0; j < 3; ++j ) {
-						int baseIndex = meshAttachment->triangles[i+j] * 2;
-						verts[j].x = spineVertices[baseIndex];
-						verts[j].y = spineVertices[baseIndex+1];
-
-						uvs[j].x = meshAttachment->uvs[baseIndex];
-						uvs[j].y = meshAttachment->uvs[baseIndex+1];
-					}
-
-					triRenderer_AddVertices( verts, uvs, ST_DEFAULT, texture->textureID, col, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
-				}
+				emitMesh( target, spineVertices, meshAttachment->uvs, meshAttachment->verticesCount / 2,
+					meshAttachment->triangles, meshAttachment->trianglesCount, texture, col );
 			} break;
 		case SP_ATTACHMENT_SKINNED_MESH: {
 				spSkinnedMeshAttachment* skinnedMeshAttachment = (spSkinnedMeshAttachment*)attachment;
 				spSkinnedMeshAttachment_computeWorldVertices( skinnedMeshAttachment, slot, spineVertices );
+				addToBounds( spineVertices, skinnedMeshAttachment->uvsCount, min, max );
 
 				texture = (Texture*)((spAtlasRegion*)skinnedMeshAttachment->rendererObject)->page->rendererObject;
+				texMgr_MarkUsed( texture->textureID );
 
-				for( int i = 0; i < skinnedMeshAttachment->trianglesCount; i+=3 ) {
-					Vector2 verts[3];
-					Vector2 uvs[3];
-
-					for( int j = 0; j < 3; ++j ) {
-						int baseIndex = skinnedMeshAttachment->triangles[i+j] * 2;
-						verts[j].x = spineVertices[baseIndex];
-						verts[j].y = spineVertices[baseIndex+1];
-
-						uvs[j].x = skinnedMeshAttachment->uvs[baseIndex];
-						uvs[j].y = skinnedMeshAttachment->uvs[baseIndex+1];
-					}
-
-					triRenderer_AddVertices( verts, uvs, ST_DEFAULT, texture->textureID, col, camFlags, depth, texture->flags & TF_IS_TRANSPARENT );
-				}
+				emitMesh( target, spineVertices, skinnedMeshAttachment->uvs, skinnedMeshAttachment->uvsCount / 2,
+					skinnedMeshAttachment->triangles, skinnedMeshAttachment->trianglesCount, texture, col );
 			} break;
 		default:
 			SDL_LogDebug( SDL_LOG_CATEGORY_VIDEO, "Unknown attachment type.\n" );
@@ -485,21 +1322,229 @@ static void drawCharacter( SpineInstance* spine )
 	}
 }
 
+static void drawCharacter( SpineInstance* spine )
+{
+	TriangleTarget target;
+	target.bake = NULL;
+	target.camFlags = spine->cameraFlags;
+	target.depth = spine->depth;
+
+	Vector2 min = { FLT_MAX, FLT_MAX };
+	Vector2 max = { -FLT_MAX, -FLT_MAX };
+	generateTriangles( spine->skeleton, &target, &min, &max );
+
+	// remember the bounds for culling, relative to the skeleton so they still work after it's moved
+	if( ( min.x <= max.x ) && ( min.y <= max.y ) ) {
+		spine->boundsMin.x = min.x - spine->skeleton->x;
+		spine->boundsMin.y = min.y - spine->skeleton->y;
+		spine->boundsMax.x = max.x - spine->skeleton->x;
+		spine->boundsMax.y = max.y - spine->skeleton->y;
+	}
+}
+
 /*
-Draws all the spine instances.
+Tests the bounds of the instance against what each camera that draws it can see.
 */
-void spine_RenderInstances( float normTimeElapsed )
+static int isInstanceVisible( SpineInstance* spine, const CameraSnapshot* cameras, int numCameras )
 {
-	for( int i = 0; i <= lastInstance; ++i ) {
-		if( instances[i].skeleton == NULL ) {
+	Vector2 padding, min, max;
+	padding.x = ( spine->boundsMax.x - spine->boundsMin.x ) * BOUNDS_PADDING_SCALE;
+	padding.y = ( spine->boundsMax.y - spine->boundsMin.y ) * BOUNDS_PADDING_SCALE;
+	min.x = spine->skeleton->x + spine->boundsMin.x - padding.x;
+	min.y = spine->skeleton->y + spine->boundsMin.y - padding.y;
+	max.x = spine->skeleton->x + spine->boundsMax.x + padding.x;
+	max.y = spine->skeleton->y + spine->boundsMax.y + padding.y;
+
+	for( int c = 0; c < numCameras; ++c ) {
+		const CameraSnapshot* cam = &( cameras[c] );
+		if( ( cam->flags & (unsigned int)spine->cameraFlags ) == 0 ) {
 			continue;
 		}
 
+		if( ( max.x >= cam->viewMin.x ) && ( min.x <= cam->viewMax.x ) &&
+			( max.y >= cam->viewMin.y ) && ( min.y <= cam->viewMax.y ) ) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// baked animations
+/*
+Samples the animation of the template sampleRate times a second and stores the triangles for each pose. Instances
+ playing it are drawn from those instead of being animated, which trades memory for not having to update or pose
+ them. The poses use the colors from the template, anything set on an instances skeleton is ignored.
+ Returns the id of the baked animation, or -1 if there's a problem.
+*/
+int spine_BakeAnimation( int templateIdx, const char* animName, float sampleRate )
+{
+	assert( templateIdx >= 0 );
+	assert( templateIdx < MAX_TEMPLATES );
+	assert( sampleRate > 0.0f );
+
+	if( templates[templateIdx].skeletonData == NULL ) {
+		return -1;
+	}
+
+	spAnimation* animation = spSkeletonData_findAnimation( templates[templateIdx].skeletonData, animName );
+	if( animation == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Unable to find animation %s to bake.", animName );
+		return -1;
+	}
+
+	int bakeID;
+	for( bakeID = 0; ( bakeID < MAX_BAKED_ANIMATIONS ) && ( bakes[bakeID].animation != NULL ); ++bakeID ) ;
+	if( bakeID >= MAX_BAKED_ANIMATIONS ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "No space left to bake animation %s.", animName );
+		return -1;
+	}
+
+	// posed the same way as the instances, at the origin
+	spSkeleton* skeleton = spSkeleton_create( templates[templateIdx].skeletonData );
+	if( skeleton == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_RENDER, "Unable to create skeleton to bake animation %s.", animName );
+		return -1;
+	}
+	skeleton->flipX = 0;
+	skeleton->flipY = 1;
+
+	BakedAnimation* bake = &( bakes[bakeID] );
+	memset( bake, 0, sizeof( *bake ) );
+	bake->animation = animation;
+	bake->templateIdx = templateIdx;
+	bake->sampleRate = sampleRate;
+	bake->numFrames = (int)( animation->duration * sampleRate ) + 1;
+
+	TriangleTarget target;
+	target.bake = bake;
+	target.camFlags = 0;
+	target.depth = 0;
+
+	Vector2 min = { FLT_MAX, FLT_MAX };
+	Vector2 max = { -FLT_MAX, -FLT_MAX };
+
+	for( int i = 0; i < bake->numFrames; ++i ) {
+		float time = MIN( (float)i / sampleRate, animation->duration );
+
+		spSkeleton_setToSetupPose( skeleton );
+		spAnimation_apply( animation, skeleton, time, time, 0, NULL, NULL );
+		spSkeleton_updateWorldTransform( skeleton );
+
+		sb_Push( bake->sbFrameFirstDraw, sb_Count( bake->sbDraws ) );
+		generateTriangles( skeleton, &target, &min, &max );
+	}
+	sb_Push( bake->sbFrameFirstDraw, sb_Count( bake->sbDraws ) );
+
+	spSkeleton_dispose( skeleton );
+
+	if( ( min.x <= max.x ) && ( min.y <= max.y ) ) {
+		bake->boundsMin = min;
+		bake->boundsMax = max;
+	}
+
+	SDL_LogVerbose( SDL_LOG_CATEGORY_RENDER, "Baked animation %s: %i frames, %i draws, %i KB", animName, bake->numFrames,
+		sb_Count( bake->sbDraws ),
+		(int)( ( ( sb_Count( bake->sbPositions ) * sizeof( float ) ) + ( sb_Count( bake->sbDraws ) * sizeof( BakedDraw ) ) ) / 1024 ) );
+
+	return bakeID;
+}
+
+/*
+Has the instance play a baked animation, starting startTime seconds in. While it's playing the instances skeleton and
+ animation state aren't updated and its listener isn't called. The baked animation must be from the template the
+ instance was created from.
+ Returns <0 if there's a problem.
+*/
+int spine_PlayBakedAnimation( int id, int bakeID, float startTime, int loop )
+{
+	assert( bakeID >= 0 );
+	assert( bakeID < MAX_BAKED_ANIMATIONS );
+
+	int idx = instanceIDToIndex( id );
+	if( idx < 0 ) {
+		return -1;
+	}
+
+	SpineInstance* instance = &( instances[idx] );
+	if( ( bakes[bakeID].animation == NULL ) || ( bakes[bakeID].templateIdx != instance->templateIdx ) ) {
+		return -1;
+	}
+
+	instance->bakeID = bakeID;
+	instance->bakeTime = startTime;
+	instance->bakeLoop = loop;
+	instance->boundsMin = bakes[bakeID].boundsMin;
+	instance->boundsMax = bakes[bakeID].boundsMax;
+
+	return 0;
+}
+
+/*
+Stops the instance playing a baked animation, it goes back to being animated from wherever its skeleton and animation
+ state were left.
+*/
+void spine_StopBakedAnimation( int id )
+{
+	int idx = instanceIDToIndex( id );
+	if( idx < 0 ) {
+		return;
+	}
+
+	instances[idx].bakeID = -1;
+}
+
+static void drawBaked( SpineInstance* spine )
+{
+	BakedAnimation* bake = &( bakes[spine->bakeID] );
+	float duration = bake->animation->duration;
+
+	float time;
+	if( spine->bakeLoop && ( duration > 0.0f ) ) {
+		time = fmodf( spine->bakeTime, duration );
+	} else {
+		time = MIN( spine->bakeTime, duration );
+	}
+	int frame = MIN( (int)( ( time * bake->sampleRate ) + 0.5f ), bake->numFrames - 1 );
+
+	Vector2 offset;
+	offset.x = spine->skeleton->x;
+	offset.y = spine->skeleton->y;
+
+	for( int d = bake->sbFrameFirstDraw[frame]; d < bake->sbFrameFirstDraw[frame + 1]; ++d ) {
+		BakedDraw* draw = &( bake->sbDraws[d] );
+		TransparencyType transparency = getTransparency( draw->texture, &( draw->color ) );
+		texMgr_MarkUsed( draw->texture->textureID );
+
+		triRenderer_AddMesh( &( bake->sbPositions[draw->firstVert * 2] ), draw->uvs, draw->numVerts, draw->indices,
+			draw->numIndices, offset, ST_DEFAULT, draw->texture->textureID, draw->color, spine->cameraFlags, spine->depth,
+			transparency );
+	}
+}
+
+/*
+Draws all the spine instances, anything no camera can see is skipped.
+*/
+void spine_RenderInstances( float normTimeElapsed )
+{
+	CameraSnapshot cameras[NUM_CAMERAS];
+	int numCameras = cam_TakeSnapshots( cameras );
+
+	for( int i = 0; i < numInstances; ++i ) {
 		Vector2 pos;
 		vec2_Lerp( &( instances[i].startPos ), &( instances[i].endPos ), normTimeElapsed, &pos );
 		instances[i].skeleton->x = pos.x;
 		instances[i].skeleton->y = pos.y;
 
-		drawCharacter( &( instances[i] ) );
+		instances[i].visible = isInstanceVisible( &( instances[i] ), cameras, numCameras );
+		if( !instances[i].visible ) {
+			continue;
+		}
+
+		if( instances[i].bakeID >= 0 ) {
+			drawBaked( &( instances[i] ) );
+		} else {
+			drawCharacter( &( instances[i] ) );
+		}
 	}
 }
\ No newline at end of file
@@ -12,7 +12,8 @@ void spine_CleanEverything( void );
 // template handling
 /*
 Loads a set of spine files. Assumes there's three files: fileNameBase.json, fileNameBase.atlas, and fileNameBase.png.
- The template is created from these three files.
+ The template is created from these three files. How much was allocated while loading is saved in the user's pref
+ directory so later loads can make it all at once.
  Returns the index of the template if the loading was successfull, -1 if it was not.
 */
 int spine_LoadTemplate( const char* fileNameBase );
@@ -72,12 +73,43 @@ Returns the animation state of the spine instance, if there's an issue returns N
 spAnimationState* spine_GetInstanceAnimState( int id );
 
 /*
-Updates all the instance animations.
+Sets how often instances that couldn't be seen the last time they were drawn are updated, in frames. They're given
+ all the time they missed when they are, so the animations stay in sync. 1 updates everything every frame.
+*/
+void spine_SetOffscreenUpdateInterval( int numFrames );
+
+/*
+Updates all the instance animations. The instances are spread across the job threads, the listeners are called
+ afterwards on this thread, in the order of the instances. Instances that couldn't be seen are only updated every
+ few frames.
 */
 void spine_UpdateInstances( float dt );
 
+// baked animations
+/*
+Samples the animation of the template sampleRate times a second and stores the triangles for each pose. Instances
+ playing it are drawn from those instead of being animated, which trades memory for not having to update or pose
+ them. The poses use the colors from the template, anything set on an instances skeleton is ignored.
+ Returns the id of the baked animation, or -1 if there's a problem.
+*/
+int spine_BakeAnimation( int templateIdx, const char* animName, float sampleRate );
+
+/*
+Has the instance play a baked animation, starting startTime seconds in. While it's playing the instances skeleton and
+ animation state aren't updated and its listener isn't called. The baked animation must be from the template the
+ instance was created from.
+ Returns <0 if there's a problem.
+*/
+int spine_PlayBakedAnimation( int id, int bakeID, float startTime, int loop );
+
+/*
+Stops the instance playing a baked animation, it goes back to being animated from wherever its skeleton and animation
+ state were left.
+*/
+void spine_StopBakedAnimation( int id );
+
 /*
-Draws all the spine instances.
+Draws all the spine instances, anything no camera can see is skipped.
 */
 void spine_RenderInstances( float normTimeElapsed );
 
@@ -0,0 +1,346 @@
+#include "textureLoader.h"
+
+#include <SDL_log.h>
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include <SDL_atomic.h>
+#include <SDL_timer.h>
+#include <SDL_cpuinfo.h>
+#include <string.h>
+
+#include "glDebugging.h"
+#include "textureManager.h"
+#include "../System/memory.h"
+
+#define MAX_LOADER_THREADS 8
+#define MAX_LOAD_FILE_NAME 256
+
+typedef struct LoadRequest {
+	char fileName[MAX_LOAD_FILE_NAME];
+	TextureLoadedCallback callback;
+	ImageDecodedCallback decodedCallback; // if this is set no texture is created
+	void* data;
+
+	uint8_t* pixels;
+	int width;
+	int height;
+	AlphaInfo alpha;
+
+	struct LoadRequest* next;
+} LoadRequest;
+
+static SDL_Thread* workers[MAX_LOADER_THREADS];
+static int numWorkers = 0;
+
+// requests waiting for a worker, workers sleep when there's nothing to do so this is guarded by a mutex
+static SDL_mutex* requestMutex = NULL;
+static SDL_cond* requestCond = NULL;
+static LoadRequest* firstRequest = NULL;
+static LoadRequest* lastRequest = NULL;
+static int quitWorkers;
+
+// decoded requests, the workers push onto this and the main thread takes the whole list at once, so it's lock free
+static void* finishedRequests = NULL;
+
+// decoded requests the main thread has taken but hasn't created textures for yet, in the order they finished
+static LoadRequest* firstUpload = NULL;
+static LoadRequest* lastUpload = NULL;
+
+// pixel data is streamed through this, 0 if pixel buffers aren't supported
+static GLuint uploadPixelBuffer = 0;
+
+static void pushFinished( LoadRequest* request )
+{
+	void* head;
+	do {
+		head = SDL_AtomicGetPtr( &finishedRequests );
+		request->next = (LoadRequest*)head;
+	} while( !SDL_AtomicCASPtr( &finishedRequests, head, request ) );
+}
+
+static int workerMain( void* data )
+{
+	for( ;; ) {
+		SDL_LockMutex( requestMutex );
+		while( ( firstRequest == NULL ) && !quitWorkers ) {
+			SDL_CondWait( requestCond, requestMutex );
+		}
+
+		if( quitWorkers ) {
+			SDL_UnlockMutex( requestMutex );
+			break;
+		}
+
+		LoadRequest* request = firstRequest;
+		firstRequest = request->next;
+		if( firstRequest == NULL ) {
+			lastRequest = NULL;
+		}
+		SDL_UnlockMutex( requestMutex );
+
+		request->pixels = NULL;
+		int decoded =
+			( gfxUtil_DecodeImageFile( request->fileName, &( request->pixels ), &( request->width ), &( request->height ) ) >= 0 );
+
+		// the alpha is only needed when creating a texture
+		if( decoded && ( request->decodedCallback == NULL ) ) {
+			gfxUtil_ClassifyAlpha( request->pixels, request->width, request->height, 4, &( request->alpha ) );
+		}
+
+		pushFinished( request );
+	}
+
+	return 0;
+}
+
+static void releaseRequest( LoadRequest* request )
+{
+	if( request->pixels != NULL ) {
+		gfxUtil_ReleaseDecodedImage( request->pixels );
+	}
+	mem_Release( request );
+}
+
+/*
+Starts up the worker threads, if numThreads is <= 0 it will use one less than the number of cores.
+ Returns < 0 if there's a problem.
+*/
+int texLoader_Init( int numThreads )
+{
+	if( numThreads <= 0 ) {
+		// the main thread and the render thread are busy as well, but they'll be waiting on the workers a lot at startup
+		numThreads = SDL_GetCPUCount( ) - 1;
+	}
+	numThreads = SDL_max( 1, SDL_min( numThreads, MAX_LOADER_THREADS ) );
+
+	firstRequest = lastRequest = NULL;
+	firstUpload = lastUpload = NULL;
+	finishedRequests = NULL;
+	quitWorkers = 0;
+
+	requestMutex = SDL_CreateMutex( );
+	requestCond = SDL_CreateCond( );
+	if( ( requestMutex == NULL ) || ( requestCond == NULL ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to create texture loader synchronization: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	for( numWorkers = 0; numWorkers < numThreads; ++numWorkers ) {
+		workers[numWorkers] = SDL_CreateThread( workerMain, "textureLoader", NULL );
+		if( workers[numWorkers] == NULL ) {
+			SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to create texture loader thread: %s", SDL_GetError( ) );
+			break;
+		}
+	}
+
+	if( numWorkers <= 0 ) {
+		return -1;
+	}
+
+	if( GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object ) {
+		GL( glGenBuffers( 1, &uploadPixelBuffer ) );
+	}
+
+	return 0;
+}
+
+/*
+Stops the worker threads, anything that hasn't been finished is thrown away without calling the callbacks.
+*/
+void texLoader_ShutDown( void )
+{
+	if( requestMutex != NULL ) {
+		SDL_LockMutex( requestMutex );
+		quitWorkers = 1;
+		SDL_CondBroadcast( requestCond );
+		SDL_UnlockMutex( requestMutex );
+	}
+
+	for( int i = 0; i < numWorkers; ++i ) {
+		SDL_WaitThread( workers[i], NULL );
+		workers[i] = NULL;
+	}
+	numWorkers = 0;
+
+	// the workers are gone so nothing else is touching the lists
+	while( firstRequest != NULL ) {
+		LoadRequest* next = firstRequest->next;
+		releaseRequest( firstRequest );
+		firstRequest = next;
+	}
+	lastRequest = NULL;
+
+	LoadRequest* finished = (LoadRequest*)SDL_AtomicSetPtr( &finishedRequests, NULL );
+	while( finished != NULL ) {
+		LoadRequest* next = finished->next;
+		releaseRequest( finished );
+		finished = next;
+	}
+
+	while( firstUpload != NULL ) {
+		LoadRequest* next = firstUpload->next;
+		releaseRequest( firstUpload );
+		firstUpload = next;
+	}
+	lastUpload = NULL;
+
+	if( uploadPixelBuffer != 0 ) {
+		GL( glDeleteBuffers( 1, &uploadPixelBuffer ) );
+		uploadPixelBuffer = 0;
+	}
+
+	SDL_DestroyCond( requestCond );
+	requestCond = NULL;
+	SDL_DestroyMutex( requestMutex );
+	requestMutex = NULL;
+}
+
+static int queueRequest( const char* fileName, TextureLoadedCallback callback, ImageDecodedCallback decodedCallback,
+	void* data )
+{
+	if( numWorkers <= 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Texture loader not running, unable to load %s", fileName );
+		return -1;
+	}
+
+	if( SDL_strlen( fileName ) >= MAX_LOAD_FILE_NAME ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Texture file name too long: %s", fileName );
+		return -1;
+	}
+
+	LoadRequest* request = mem_Allocate( sizeof( LoadRequest ) );
+	if( request == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to allocate texture load request for %s", fileName );
+		return -1;
+	}
+
+	SDL_strlcpy( request->fileName, fileName, MAX_LOAD_FILE_NAME );
+	request->callback = callback;
+	request->decodedCallback = decodedCallback;
+	request->data = data;
+	request->pixels = NULL;
+	request->next = NULL;
+
+	SDL_LockMutex( requestMutex );
+	if( lastRequest != NULL ) {
+		lastRequest->next = request;
+	} else {
+		firstRequest = request;
+	}
+	lastRequest = request;
+	SDL_CondSignal( requestCond );
+	SDL_UnlockMutex( requestMutex );
+
+	return 0;
+}
+
+/*
+Queues up the image file to be loaded, the callback will be called from texLoader_Update( ) once it's done.
+ Returns < 0 if there's a problem.
+*/
+int texLoader_Queue( const char* fileName, TextureLoadedCallback callback, void* data )
+{
+	return queueRequest( fileName, callback, NULL, data );
+}
+
+/*
+Queues up the image file to be decoded without creating a texture, for when the pixels are going into a texture that
+ already exists. The callback will be called from texLoader_Update( ) once it's done.
+ Returns < 0 if there's a problem.
+*/
+int texLoader_QueueDecode( const char* fileName, ImageDecodedCallback callback, void* data )
+{
+	return queueRequest( fileName, NULL, callback, data );
+}
+
+/*
+Moves everything the workers have finished onto the end of the upload list.
+*/
+static void takeFinished( void )
+{
+	LoadRequest* finished = (LoadRequest*)SDL_AtomicSetPtr( &finishedRequests, NULL );
+
+	// it's a stack, so reverse it to get them in the order they finished
+	LoadRequest* reversed = NULL;
+	while( finished != NULL ) {
+		LoadRequest* next = finished->next;
+		finished->next = reversed;
+		reversed = finished;
+		finished = next;
+	}
+
+	if( reversed == NULL ) {
+		return;
+	}
+
+	if( lastUpload != NULL ) {
+		lastUpload->next = reversed;
+	} else {
+		firstUpload = reversed;
+	}
+
+	lastUpload = reversed;
+	while( lastUpload->next != NULL ) {
+		lastUpload = lastUpload->next;
+	}
+}
+
+/*
+Creates the texture for a decoded request and passes it on to the callback.
+*/
+static void createTexture( LoadRequest* request )
+{
+	Texture texture;
+	Texture* result = NULL;
+	if( request->pixels == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to load texture %s", request->fileName );
+	} else if( gfxUtil_UploadRGBATexture( request->pixels, request->width, request->height, &( request->alpha ),
+		uploadPixelBuffer, &texture ) < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to create texture for %s", request->fileName );
+	} else {
+		texMgr_SetSourceFile( texture.textureID, request->fileName );
+		result = &texture;
+	}
+
+	if( request->callback != NULL ) {
+		request->callback( result, request->pixels, request->data );
+	} else if( result != NULL ) {
+		gfxUtil_UnloadTexture( result );
+	}
+}
+
+/*
+Creates textures for any files that have finished decoding, stops once it's spent more than budgetMS doing so. At
+ least one texture is always created if there are any waiting. Files that were only decoded have their callbacks
+ called as part of the same budget. Must be called from the main thread.
+*/
+void texLoader_Update( float budgetMS )
+{
+	takeFinished( );
+
+	Uint64 budget = (Uint64)( ( budgetMS / 1000.0f ) * (float)SDL_GetPerformanceFrequency( ) );
+	Uint64 start = SDL_GetPerformanceCounter( );
+
+	while( firstUpload != NULL ) {
+		LoadRequest* request = firstUpload;
+		firstUpload = request->next;
+		if( firstUpload == NULL ) {
+			lastUpload = NULL;
+		}
+
+		if( request->decodedCallback != NULL ) {
+			if( request->pixels == NULL ) {
+				SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to decode %s", request->fileName );
+			}
+			request->decodedCallback( request->pixels, request->width, request->height, request->data );
+		} else {
+			createTexture( request );
+		}
+
+		releaseRequest( request );
+
+		if( ( SDL_GetPerformanceCounter( ) - start ) >= budget ) {
+			break;
+		}
+	}
+}
\ No newline at end of file
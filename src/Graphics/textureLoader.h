@@ -0,0 +1,50 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "gfxUtil.h"
+
+/*
+Loads textures in the background. Worker threads read and decode the image files, the finished pixel data is handed
+ back to the main thread which creates the textures, spending at most a set amount of time each frame doing so.
+*/
+
+// called on the main thread once the texture has been created, texture will be NULL if the load failed, pixels is the
+//  decoded RGBA data the texture was created from and is only valid during the call
+typedef void (*TextureLoadedCallback)( Texture* texture, const uint8_t* pixels, void* data );
+
+// called on the main thread once the file has been decoded, pixels will be NULL if it couldn't be, otherwise it's the
+//  RGBA data and is only valid during the call
+typedef void (*ImageDecodedCallback)( const uint8_t* pixels, int width, int height, void* data );
+
+/*
+Starts up the worker threads, if numThreads is <= 0 it will use one less than the number of cores.
+ Returns < 0 if there's a problem.
+*/
+int texLoader_Init( int numThreads );
+
+/*
+Stops the worker threads, anything that hasn't been finished is thrown away without calling the callbacks.
+*/
+void texLoader_ShutDown( void );
+
+/*
+Queues up the image file to be loaded, the callback will be called from texLoader_Update( ) once it's done.
+ Returns < 0 if there's a problem.
+*/
+int texLoader_Queue( const char* fileName, TextureLoadedCallback callback, void* data );
+
+/*
+Queues up the image file to be decoded without creating a texture, for when the pixels are going into a texture that
+ already exists. The callback will be called from texLoader_Update( ) once it's done.
+ Returns < 0 if there's a problem.
+*/
+int texLoader_QueueDecode( const char* fileName, ImageDecodedCallback callback, void* data );
+
+/*
+Creates textures for any files that have finished decoding, stops once it's spent more than budgetMS doing so. At
+ least one texture is always created if there are any waiting. Files that were only decoded have their callbacks
+ called as part of the same budget. Must be called from the main thread.
+*/
+void texLoader_Update( float budgetMS );
+
+#endif /* inclusion guard */
\ No newline at end of file
@@ -0,0 +1,423 @@
+#include "textureManager.h"
+
+#include <SDL_log.h>
+#include <SDL_stdinc.h>
+#include <assert.h>
+
+#include "gfxUtil.h"
+#include "glDebugging.h"
+#include "textureLoader.h"
+#include "../System/memory.h"
+
+#define MAX_MANAGED_TEXTURES 4096
+
+// texture ids are looked up with an open addressed hash table, it's kept at most half full
+#define HASH_BITS 13
+#define HASH_SIZE ( 1 << HASH_BITS )
+#define HASH_MASK ( HASH_SIZE - 1 )
+
+#if HASH_SIZE < ( MAX_MANAGED_TEXTURES * 2 )
+	#error "textureManager HASH_SIZE is too small for MAX_MANAGED_TEXTURES."
+#endif
+
+typedef struct {
+	GLuint textureID; // 0 if the record isn't in use
+	int width;
+	int height;
+	size_t bytes;
+	int evicted;
+	int reloading; // evicted and waiting for the texture loader to decode the file again
+	unsigned int lastUsedFrame;
+	char* sourceFile; // NULL if it can't be loaded again
+	int nextFree;
+} ManagedTexture;
+
+static ManagedTexture records[MAX_MANAGED_TEXTURES];
+static int firstFreeRecord;
+static int hashSlots[HASH_SIZE];
+
+// the last texture looked up, most draws use the same texture as the one before
+static GLuint lastUsedID;
+static int lastUsedRecord;
+
+static unsigned int currentFrame;
+static size_t budget;
+static size_t residentBytes;
+static size_t evictedBytes;
+static int numEvicted;
+static int numReloaded;
+static int numPending;
+static int lastFrameNumEvicted;
+static int lastFrameNumReloaded;
+
+static int hashTexture( GLuint textureID )
+{
+	return (int)( ( textureID * 2654435761u ) >> ( 32 - HASH_BITS ) );
+}
+
+/*
+Finds the hash slot for the texture.
+ Returns the slot, or a negative value if it isn't being tracked.
+*/
+static int findSlot( GLuint textureID )
+{
+	for( int slot = hashTexture( textureID ); hashSlots[slot] >= 0; slot = ( slot + 1 ) & HASH_MASK ) {
+		if( records[hashSlots[slot]].textureID == textureID ) {
+			return slot;
+		}
+	}
+
+	return -1;
+}
+
+/*
+Empties the hash slot, shifting anything after it back so nothing becomes unreachable.
+*/
+static void clearSlot( int slot )
+{
+	int hole = slot;
+	for( int next = ( slot + 1 ) & HASH_MASK; hashSlots[next] >= 0; next = ( next + 1 ) & HASH_MASK ) {
+		int home = hashTexture( records[hashSlots[next]].textureID );
+		if( ( ( next - home ) & HASH_MASK ) >= ( ( next - hole ) & HASH_MASK ) ) {
+			hashSlots[hole] = hashSlots[next];
+			hole = next;
+		}
+	}
+	hashSlots[hole] = -1;
+}
+
+static ManagedTexture* findRecord( GLuint textureID )
+{
+	int slot = findSlot( textureID );
+	return ( slot >= 0 ) ? &( records[hashSlots[slot]] ) : NULL;
+}
+
+/*
+Sets up the texture tracking, there's no budget until one is set.
+*/
+void texMgr_Init( void )
+{
+	for( int i = 0; i < MAX_MANAGED_TEXTURES; ++i ) {
+		records[i].textureID = 0;
+		records[i].sourceFile = NULL;
+		records[i].nextFree = ( i < ( MAX_MANAGED_TEXTURES - 1 ) ) ? ( i + 1 ) : -1;
+	}
+	firstFreeRecord = 0;
+
+	for( int i = 0; i < HASH_SIZE; ++i ) {
+		hashSlots[i] = -1;
+	}
+
+	lastUsedID = 0;
+	lastUsedRecord = -1;
+
+	// start far enough in that nothing looks like it was used recently
+	currentFrame = 2;
+	budget = 0;
+	residentBytes = 0;
+	evictedBytes = 0;
+	numEvicted = numReloaded = 0;
+	numPending = 0;
+	lastFrameNumEvicted = lastFrameNumReloaded = 0;
+}
+
+/*
+Releases everything used for tracking the textures, doesn't touch the textures themselves.
+*/
+void texMgr_ShutDown( void )
+{
+	for( int i = 0; i < MAX_MANAGED_TEXTURES; ++i ) {
+		mem_Release( records[i].sourceFile );
+		records[i].sourceFile = NULL;
+		records[i].textureID = 0;
+	}
+
+	for( int i = 0; i < HASH_SIZE; ++i ) {
+		hashSlots[i] = -1;
+	}
+
+	firstFreeRecord = -1;
+	lastUsedID = 0;
+	lastUsedRecord = -1;
+	residentBytes = 0;
+	evictedBytes = 0;
+	numPending = 0;
+}
+
+/*
+Sets how many bytes of texture memory we want to stay under, 0 means there's no limit.
+*/
+void texMgr_SetBudget( size_t budgetBytes )
+{
+	budget = budgetBytes;
+}
+
+/*
+Starts tracking a texture that was just created.
+*/
+void texMgr_Register( GLuint textureID, int width, int height, int bytesPerPixel )
+{
+	if( textureID == 0 ) {
+		return;
+	}
+
+	// the id may have been reused without us being told the old texture was destroyed
+	texMgr_Unregister( textureID );
+
+	int idx = firstFreeRecord;
+	if( idx < 0 ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Texture manager full, texture %u won't be tracked.", textureID );
+		return;
+	}
+	firstFreeRecord = records[idx].nextFree;
+
+	ManagedTexture* record = &( records[idx] );
+	record->textureID = textureID;
+	record->width = width;
+	record->height = height;
+	record->bytes = (size_t)width * (size_t)height * (size_t)bytesPerPixel;
+	record->evicted = 0;
+	record->reloading = 0;
+	record->lastUsedFrame = currentFrame;
+	record->sourceFile = NULL;
+	record->nextFree = -1;
+
+	int slot = hashTexture( textureID );
+	while( hashSlots[slot] >= 0 ) {
+		slot = ( slot + 1 ) & HASH_MASK;
+	}
+	hashSlots[slot] = idx;
+
+	residentBytes += record->bytes;
+}
+
+/*
+Marks a tracked texture as being loaded from the file, so it can be evicted and loaded again later. The texture must
+ have been created from the RGBA pixels of the file.
+*/
+void texMgr_SetSourceFile( GLuint textureID, const char* fileName )
+{
+	ManagedTexture* record = findRecord( textureID );
+	if( record == NULL ) {
+		return;
+	}
+
+	mem_Release( record->sourceFile );
+	size_t size = SDL_strlen( fileName ) + 1;
+	record->sourceFile = mem_Allocate( size );
+	if( record->sourceFile != NULL ) {
+		SDL_strlcpy( record->sourceFile, fileName, size );
+	}
+}
+
+/*
+Stops tracking a texture, call this when it's destroyed.
+*/
+void texMgr_Unregister( GLuint textureID )
+{
+	int slot = findSlot( textureID );
+	if( slot < 0 ) {
+		return;
+	}
+
+	int idx = hashSlots[slot];
+	ManagedTexture* record = &( records[idx] );
+	if( record->evicted ) {
+		evictedBytes -= record->bytes;
+	} else {
+		residentBytes -= record->bytes;
+	}
+
+	// if the file is still being decoded it's ignored when it's done
+	if( record->reloading ) {
+		record->reloading = 0;
+		--numPending;
+	}
+
+	mem_Release( record->sourceFile );
+	record->sourceFile = NULL;
+	record->textureID = 0;
+	record->nextFree = firstFreeRecord;
+	firstFreeRecord = idx;
+
+	clearSlot( slot );
+
+	if( lastUsedRecord == idx ) {
+		lastUsedID = 0;
+		lastUsedRecord = -1;
+	}
+}
+
+/*
+Releases the storage for the texture, the texture object stays valid. A single clear pixel is left in its place so
+ anything drawn with it until it's loaded again doesn't show up.
+*/
+static void evict( ManagedTexture* record )
+{
+	static const uint8_t clearPixel[4] = { 0, 0, 0, 0 };
+
+	assert( !record->evicted );
+
+	GL( glBindTexture( GL_TEXTURE_2D, record->textureID ) );
+	GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, clearPixel ) );
+	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+
+	record->evicted = 1;
+	residentBytes -= record->bytes;
+	evictedBytes += record->bytes;
+	++numEvicted;
+}
+
+/*
+Puts the decoded pixels back into an evicted texture, if it failed the texture is left empty and won't be tried again.
+*/
+static void refill( ManagedTexture* record, const uint8_t* pixels, int width, int height )
+{
+	assert( record->evicted );
+
+	record->evicted = 0;
+	evictedBytes -= record->bytes;
+
+	if( pixels == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, "Unable to reload evicted texture %s", record->sourceFile );
+		mem_Release( record->sourceFile );
+		record->sourceFile = NULL;
+		record->bytes = 0;
+		return;
+	}
+
+	GL( glBindTexture( GL_TEXTURE_2D, record->textureID ) );
+	GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels ) );
+	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+
+	// the file could have changed, but anything drawing it is using uvs so the size doesn't matter
+	record->width = width;
+	record->height = height;
+	record->bytes = (size_t)width * (size_t)height * 4;
+	residentBytes += record->bytes;
+	++numReloaded;
+}
+
+/*
+Called by the texture loader once the file for an evicted texture has been decoded again. The texture could have been
+ destroyed while it was being decoded, and its id reused.
+*/
+static void reloadDecoded( const uint8_t* pixels, int width, int height, void* data )
+{
+	ManagedTexture* record = findRecord( (GLuint)(uintptr_t)data );
+	if( ( record == NULL ) || !record->reloading ) {
+		return;
+	}
+
+	record->reloading = 0;
+	--numPending;
+	refill( record, pixels, width, height );
+}
+
+/*
+Has the file for an evicted texture decoded on the texture loader threads, the texture stays empty until it's done.
+ If the loader can't take it the file is decoded here instead.
+*/
+static void reload( ManagedTexture* record )
+{
+	assert( record->evicted );
+
+	if( texLoader_QueueDecode( record->sourceFile, reloadDecoded, (void*)(uintptr_t)record->textureID ) >= 0 ) {
+		record->reloading = 1;
+		++numPending;
+		return;
+	}
+
+	uint8_t* pixels;
+	int width, height;
+	if( gfxUtil_DecodeImageFile( record->sourceFile, &pixels, &width, &height ) < 0 ) {
+		refill( record, NULL, 0, 0 );
+		return;
+	}
+
+	refill( record, pixels, width, height );
+	gfxUtil_ReleaseDecodedImage( pixels );
+}
+
+/*
+Marks the texture as being drawn this frame. If it was evicted the file is decoded again in the background, and the
+ texture is empty until it's done.
+*/
+void texMgr_MarkUsed( GLuint textureID )
+{
+	if( textureID != lastUsedID ) {
+		int slot = findSlot( textureID );
+		if( slot < 0 ) {
+			return;
+		}
+		lastUsedID = textureID;
+		lastUsedRecord = hashSlots[slot];
+	}
+
+	ManagedTexture* record = &( records[lastUsedRecord] );
+	record->lastUsedFrame = currentFrame;
+	if( record->evicted && !record->reloading ) {
+		reload( record );
+	}
+}
+
+/*
+Ends the frame, evicting textures that haven't been drawn recently until we're back under the budget. Textures drawn
+ in this frame or the one before it are never evicted, the render thread could still be using them.
+*/
+void texMgr_EndFrame( void )
+{
+	while( ( budget > 0 ) && ( residentBytes > budget ) ) {
+		// doesn't happen often, so just search for the least recently used one each time
+		ManagedTexture* oldest = NULL;
+		for( int i = 0; i < MAX_MANAGED_TEXTURES; ++i ) {
+			ManagedTexture* record = &( records[i] );
+			if( ( record->textureID == 0 ) || record->evicted || ( record->sourceFile == NULL ) ||
+				( ( record->lastUsedFrame + 1 ) >= currentFrame ) ) {
+				continue;
+			}
+
+			if( ( oldest == NULL ) || ( record->lastUsedFrame < oldest->lastUsedFrame ) ) {
+				oldest = record;
+			}
+		}
+
+		if( oldest == NULL ) {
+			break;
+		}
+		evict( oldest );
+	}
+
+	lastFrameNumEvicted = numEvicted;
+	lastFrameNumReloaded = numReloaded;
+	numEvicted = numReloaded = 0;
+	++currentFrame;
+}
+
+/*
+Gets how many bytes of texture data are resident and how many have been evicted, how many textures were evicted and
+ reloaded during the last frame, and how many are waiting to be reloaded.
+*/
+void texMgr_GetStats( size_t* outResidentBytes, size_t* outEvictedBytes, int* outNumEvicted, int* outNumReloaded,
+	int* outNumPending )
+{
+	if( outResidentBytes != NULL ) {
+		(*outResidentBytes) = residentBytes;
+	}
+
+	if( outEvictedBytes != NULL ) {
+		(*outEvictedBytes) = evictedBytes;
+	}
+
+	if( outNumEvicted != NULL ) {
+		(*outNumEvicted) = lastFrameNumEvicted;
+	}
+
+	if( outNumReloaded != NULL ) {
+		(*outNumReloaded) = lastFrameNumReloaded;
+	}
+
+	if( outNumPending != NULL ) {
+		(*outNumPending) = numPending;
+	}
+}
\ No newline at end of file
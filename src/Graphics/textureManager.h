@@ -0,0 +1,63 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <stddef.h>
+#include "../Others/glew.h"
+
+/*
+Keeps track of how much memory the textures are using and keeps it under a budget. Textures that were loaded from a
+ file can be evicted when they haven't been drawn in a while, the texture object stays valid but its storage is
+ released, and it's loaded from the file again in the background the next time it's drawn. Everything here must be called from the main thread.
+*/
+
+/*
+Sets up the texture tracking, there's no budget until one is set.
+*/
+void texMgr_Init( void );
+
+/*
+Releases everything used for tracking the textures, doesn't touch the textures themselves.
+*/
+void texMgr_ShutDown( void );
+
+/*
+Sets how many bytes of texture memory we want to stay under, 0 means there's no limit.
+*/
+void texMgr_SetBudget( size_t budgetBytes );
+
+/*
+Starts tracking a texture that was just created.
+*/
+void texMgr_Register( GLuint textureID, int width, int height, int bytesPerPixel );
+
+/*
+Marks a tracked texture as being loaded from the file, so it can be evicted and loaded again later. The texture must
+ have been created from the RGBA pixels of the file.
+*/
+void texMgr_SetSourceFile( GLuint textureID, const char* fileName );
+
+/*
+Stops tracking a texture, call this when it's destroyed.
+*/
+void texMgr_Unregister( GLuint textureID );
+
+/*
+Marks the texture as being drawn this frame. If it was evicted the file is decoded again in the background, and the
+ texture is empty until it's done.
+*/
+void texMgr_MarkUsed( GLuint textureID );
+
+/*
+Ends the frame, evicting textures that haven't been drawn recently until we're back under the budget. Textures drawn
+ in this frame or the one before it are never evicted, the render thread could still be using them.
+*/
+void texMgr_EndFrame( void );
+
+/*
+Gets how many bytes of texture data are resident and how many have been evicted, how many textures were evicted and
+ reloaded during the last frame, and how many are waiting to be reloaded.
+*/
+void texMgr_GetStats( size_t* outResidentBytes, size_t* outEvictedBytes, int* outNumEvicted, int* outNumReloaded,
+	int* outNumPending );
+
+#endif /* inclusion guard */
\ No newline at end of file
@@ -1,12 +1,16 @@
 #include "triRendering.h"
 
+#include <string.h>
+
 //#include "../Others/glew.h"
 //#include <SDL_opengl.h>
 
 #include "../Math/matrix4.h"
+#include "../Math/mathUtil.h"
 #include "camera.h"
 #include "shaderManager.h"
 #include "glDebugging.h"
+#include "renderCapture.h"
 
 typedef struct {
 	Vector3 pos;
@@ -18,44 +22,94 @@ typedef struct {
 	GLuint vertexIndices[3];
 	float zPos;
 	unsigned int camFlags;
+	unsigned int visibleCams; // one bit per camera id, generated when rendering
 	GLuint texture;
 
-	ShaderType shaderType;
+	int program;
 } Triangle;
 
+// a run of sorted triangles that share the same render state and the same set of cameras that can see them
+typedef struct {
+	int firstIndex;
+	int indexCount;
+	unsigned int visibleCams;
+	GLuint texture;
+	int program;
+} TriangleBatch;
+
 /*
 Ok, so what do we want to optimize for?
 I'd think transferring memory.
 So we have the vertices we transfer at the beginning of the rendering
 Once that is done we generate index buffers to represent what each camera can see
+The triangles are sorted by which cameras can see them, so each camera just draws ranges of a single index buffer
 */
 #define MAX_TRIS ( ( 1024 * 10 ) * 2 )
 #define MAX_VERTS ( MAX_TRIS * 3 )
 
+// the second half of the indices and batches is used by cameras that need a merged set of triangle groups
+#define MAX_INDICES ( MAX_VERTS * 2 )
+#define MAX_BATCHES ( MAX_TRIS * 2 )
+
 typedef struct {
 	Triangle triangles[MAX_TRIS];
 	Vertex vertices[MAX_VERTS];
-	GLuint indices[MAX_VERTS];
+	GLuint indices[MAX_INDICES];
+	TriangleBatch batches[MAX_BATCHES];
 	GLuint VAO;
 	GLuint VBO;
 	GLuint IBO;
 	int lastTriIndex;
+	int lastVertIndex;
 	int lastIndexBufferIndex;
+	int lastBatchIndex;
+	int groupCounts[NUM_CAMERAS];
+	int camFirstBatch[NUM_CAMERAS];
+	int camLastBatch[NUM_CAMERAS];
 } TriangleList;
 
-TriangleList solidTriangles;
-TriangleList transparentTriangles;
+typedef struct {
+	TriangleList solid;
+	TriangleList transparent;
+} TriangleFrame;
+
+// the main thread fills one frame while the render thread draws the other, they're swapped when a frame is submitted
+#define NUM_TRIANGLE_FRAMES 2
+static TriangleFrame frames[NUM_TRIANGLE_FRAMES];
+static int writeFrame = 0;
+static int readFrame = 1;
+
+// the state of all the cameras that are rendering this frame
+static CameraSnapshot* renderCameras;
+static int numRenderCameras;
+
+static Triangle* mergeScratch[MAX_TRIS];
+
+#define MAX_MULTI_DRAW 64
 
 #define Z_ORDER_OFFSET ( 1.0f / (float)( 2 * ( MAX_TRIS + 1 ) ) )
 
-static ShaderProgram shaderPrograms[NUM_SHADERS];
+// each shader type has a variant without the alpha test, so opaque triangles don't prevent early depth rejection
+typedef enum {
+	SV_OPAQUE,
+	SV_ALPHA_TEST,
+	NUM_SHADER_VARIANTS
+} ShaderVariant;
+
+// the opaque variants come first, so they're drawn before anything that has to be alpha tested
+#define NUM_PROGRAMS ( NUM_SHADERS * NUM_SHADER_VARIANTS )
+#define PROGRAM_IDX( shader, variant ) ( ( (int)(variant) * NUM_SHADERS ) + (int)(shader) )
+
+static ShaderProgram shaderPrograms[NUM_PROGRAMS];
+
+static TriRendererStats frameStats;
 
 int triRenderer_LoadShaders( void )
 {
-	ShaderDefinition shaderDefs[3];
-	ShaderProgramDefinition progDefs[NUM_SHADERS];
+	ShaderDefinition shaderDefs[7];
+	ShaderProgramDefinition progDefs[NUM_PROGRAMS];
 
-	shaders_Destroy( shaderPrograms, NUM_SHADERS );
+	shaders_Destroy( shaderPrograms, NUM_PROGRAMS );
 
 	// Sprite shader
 	shaderDefs[0].fileName = NULL;
@@ -77,6 +131,18 @@ int triRenderer_LoadShaders( void )
 	shaderDefs[1].fileName = NULL;
 	shaderDefs[1].type = GL_FRAGMENT_SHADER;
 	shaderDefs[1].shaderText =	"#version 330\n"
+								"in vec2 vTex;\n"
+								"in vec4 vCol;\n"
+								"uniform sampler2D textureUnit0;\n"
+								"out vec4 outCol;\n"
+								"void main( void )\n"
+								"{\n"
+								"	outCol = texture2D(textureUnit0, vTex) * vCol;\n"
+								"}\n";
+
+	shaderDefs[2].fileName = NULL;
+	shaderDefs[2].type = GL_FRAGMENT_SHADER;
+	shaderDefs[2].shaderText =	"#version 330\n"
 								"in vec2 vTex;\n"
 								"in vec4 vCol;\n"
 								"uniform sampler2D textureUnit0;\n"
@@ -90,9 +156,21 @@ int triRenderer_LoadShaders( void )
 								"}\n";
 
 	// for rendering fonts
-	shaderDefs[2].fileName = NULL;
-	shaderDefs[2].type = GL_FRAGMENT_SHADER;
-	shaderDefs[2].shaderText =	"#version 330\n"
+	shaderDefs[3].fileName = NULL;
+	shaderDefs[3].type = GL_FRAGMENT_SHADER;
+	shaderDefs[3].shaderText =	"#version 330\n"
+								"in vec2 vTex;\n"
+								"in vec4 vCol;\n"
+								"uniform sampler2D textureUnit0;\n"
+								"out vec4 outCol;\n"
+								"void main( void )\n"
+								"{\n"
+								"	outCol = vec4( vCol.r, vCol.g, vCol.b, texture2D(textureUnit0, vTex).a * vCol.a );\n"
+								"}\n";
+
+	shaderDefs[4].fileName = NULL;
+	shaderDefs[4].type = GL_FRAGMENT_SHADER;
+	shaderDefs[4].shaderText =	"#version 330\n"
 								"in vec2 vTex;\n"
 								"in vec4 vCol;\n"
 								"uniform sampler2D textureUnit0;\n"
@@ -105,18 +183,54 @@ int triRenderer_LoadShaders( void )
 								"	}\n"
 								"}\n";
 
-	progDefs[0].fragmentShader = 1;
-	progDefs[0].vertexShader = 0;
-	progDefs[0].geometryShader = -1;
-	progDefs[0].uniformNames = "vpMatrix textureUnit0";
+	// for rendering distance field fonts, the edge is smoothed over about a pixel on screen whatever the scale is
+	shaderDefs[5].fileName = NULL;
+	shaderDefs[5].type = GL_FRAGMENT_SHADER;
+	shaderDefs[5].shaderText =	"#version 330\n"
+								"in vec2 vTex;\n"
+								"in vec4 vCol;\n"
+								"uniform sampler2D textureUnit0;\n"
+								"out vec4 outCol;\n"
+								"void main( void )\n"
+								"{\n"
+								"	float dist = texture2D(textureUnit0, vTex).a;\n"
+								"	float edgeWidth = fwidth( dist ) * 0.5f;\n"
+								"	float alpha = smoothstep( 0.5f - edgeWidth, 0.5f + edgeWidth, dist );\n"
+								"	outCol = vec4( vCol.r, vCol.g, vCol.b, alpha * vCol.a );\n"
+								"}\n";
+
+	shaderDefs[6].fileName = NULL;
+	shaderDefs[6].type = GL_FRAGMENT_SHADER;
+	shaderDefs[6].shaderText =	"#version 330\n"
+								"in vec2 vTex;\n"
+								"in vec4 vCol;\n"
+								"uniform sampler2D textureUnit0;\n"
+								"out vec4 outCol;\n"
+								"void main( void )\n"
+								"{\n"
+								"	float dist = texture2D(textureUnit0, vTex).a;\n"
+								"	float edgeWidth = fwidth( dist ) * 0.5f;\n"
+								"	float alpha = smoothstep( 0.5f - edgeWidth, 0.5f + edgeWidth, dist );\n"
+								"	outCol = vec4( vCol.r, vCol.g, vCol.b, alpha * vCol.a );\n"
+								"	if( outCol.w <= 0.0f ) {\n"
+								"		discard;\n"
+								"	}\n"
+								"}\n";
 
-	progDefs[1].fragmentShader = 2;
-	progDefs[1].vertexShader = 0;
-	progDefs[1].geometryShader = -1;
-	progDefs[1].uniformNames = "vpMatrix textureUnit0";
+	// fragment shaders for each shader type, in { opaque, alpha tested } pairs
+	int fragmentShaders[NUM_SHADERS][NUM_SHADER_VARIANTS] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+	for( int shader = 0; shader < NUM_SHADERS; ++shader ) {
+		for( int variant = 0; variant < NUM_SHADER_VARIANTS; ++variant ) {
+			int idx = PROGRAM_IDX( shader, variant );
+			progDefs[idx].fragmentShader = fragmentShaders[shader][variant];
+			progDefs[idx].vertexShader = 0;
+			progDefs[idx].geometryShader = -1;
+			progDefs[idx].uniformNames = "vpMatrix textureUnit0";
+		}
+	}
 
 	if( shaders_Load( &( shaderDefs[0] ), sizeof( shaderDefs ) / sizeof( ShaderDefinition ),
-		progDefs, shaderPrograms, NUM_SHADERS ) <= 0 ) {
+		progDefs, shaderPrograms, NUM_PROGRAMS ) <= 0 ) {
 		SDL_LogInfo( SDL_LOG_CATEGORY_VIDEO, "Error compiling image shaders.\n" );
 		return -1;
 	}
@@ -156,6 +270,8 @@ static int createTriListGLObjects( TriangleList* triList )
 
 	triList->lastIndexBufferIndex = -1;
 	triList->lastTriIndex = -1;
+	triList->lastVertIndex = -1;
+	triList->lastBatchIndex = -1;
 
 	return 0;
 }
@@ -166,7 +282,7 @@ Initializes all the stuff needed for rendering the triangles.
 */
 int triRenderer_Init( void )
 {
-	for( int i = 0; i < NUM_SHADERS; ++i ) {
+	for( int i = 0; i < NUM_PROGRAMS; ++i ) {
 		shaderPrograms[i].programID = 0;
 	}
 
@@ -174,31 +290,35 @@ int triRenderer_Init( void )
 		return -1;
 	}
 
-	if( ( createTriListGLObjects( &solidTriangles ) < 0 ) ||
-		( createTriListGLObjects( &transparentTriangles ) < 0 ) ) {
-		return -1;
+	for( int i = 0; i < NUM_TRIANGLE_FRAMES; ++i ) {
+		if( ( createTriListGLObjects( &( frames[i].solid ) ) < 0 ) ||
+			( createTriListGLObjects( &( frames[i].transparent ) ) < 0 ) ) {
+			return -1;
+		}
 	}
 
 	return 0;
 }
 
 int addTriangle( TriangleList* triList, Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2,
-	ShaderType shader, GLuint texture, Color color, int camFlags, char depth )
+	int program, GLuint texture, Color color, int camFlags, char depth )
 {
-	if( triList->lastTriIndex >= ( MAX_TRIS - 1 ) ) {
+	if( ( triList->lastTriIndex >= ( MAX_TRIS - 1 ) ) || ( triList->lastVertIndex >= ( MAX_VERTS - 3 ) ) ) {
 		SDL_LogVerbose( SDL_LOG_CATEGORY_RENDER, "Triangle list full." );
 		return -1;
 	}
 
-	float z = (float)depth + ( Z_ORDER_OFFSET * ( solidTriangles.lastTriIndex + transparentTriangles.lastTriIndex + 2 ) );
+	TriangleFrame* frame = &( frames[writeFrame] );
+	float z = (float)depth + ( Z_ORDER_OFFSET * ( frame->solid.lastTriIndex + frame->transparent.lastTriIndex + 2 ) );
 
 	int idx = triList->lastTriIndex + 1;
 	triList->lastTriIndex = idx;
 	triList->triangles[idx].camFlags = camFlags;
 	triList->triangles[idx].texture = texture;
 	triList->triangles[idx].zPos = z;
-	triList->triangles[idx].shaderType = shader;
-	int baseIdx = idx * 3;
+	triList->triangles[idx].program = program;
+	int baseIdx = triList->lastVertIndex + 1;
+	triList->lastVertIndex += 3;
 
 	vec2ToVec3( &( pos0 ), z, &( triList->vertices[baseIdx].pos ) );
 	triList->vertices[baseIdx].col = color;
@@ -222,34 +342,188 @@ int addTriangle( TriangleList* triList, Vector2 pos0, Vector2 pos1, Vector2 pos2
 We'll assume the array has three vertices in it.
  Return a value < 0 if there's a problem.
 */
-int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader, GLuint texture, Color color, int camFlags, char depth, int transparent )
+int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader, GLuint texture, Color color, int camFlags, char depth,
+	TransparencyType transparency )
 {
 	return triRenderer_Add( positions[0], positions[1], positions[2], uvs[0], uvs[1], uvs[2],
-		shader, texture, color, camFlags, depth, transparent );
+		shader, texture, color, camFlags, depth, transparency );
 }
 
 int triRenderer_Add( Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2, ShaderType shader, GLuint texture,
-	Color color, int camFlags, char depth, int transparent )
+	Color color, int camFlags, char depth, TransparencyType transparency )
 {
-	if( transparent ) {
-		return addTriangle( &transparentTriangles, pos0, pos1, pos2, uv0, uv1, uv2, shader, texture, color, camFlags, depth );
-	} else {
-		return addTriangle( &solidTriangles, pos0, pos1, pos2, uv0, uv1, uv2, shader, texture, color, camFlags, depth );
+	if( renderCapture_IsCapturing( ) ) {
+		renderCapture_AddTriangle( pos0, pos1, pos2, uv0, uv1, uv2, shader, texture, color, camFlags, depth, transparency );
+	}
+
+	TriangleFrame* frame = &( frames[writeFrame] );
+	switch( transparency ) {
+	case TT_OPAQUE:
+		return addTriangle( &( frame->solid ), pos0, pos1, pos2, uv0, uv1, uv2, PROGRAM_IDX( shader, SV_OPAQUE ),
+			texture, color, camFlags, depth );
+	case TT_ALPHA_TEST:
+		return addTriangle( &( frame->solid ), pos0, pos1, pos2, uv0, uv1, uv2, PROGRAM_IDX( shader, SV_ALPHA_TEST ),
+			texture, color, camFlags, depth );
+	default:
+		// blended triangles still use the alpha test so completely clear pixels don't write to the depth buffer
+		return addTriangle( &( frame->transparent ), pos0, pos1, pos2, uv0, uv1, uv2, PROGRAM_IDX( shader, SV_ALPHA_TEST ),
+			texture, color, camFlags, depth );
 	}
 }
 
 /*
-Clears out all the triangles currently stored.
+Adds a quad made of the triangles ( 0, 1, 2 ) and ( 1, 2, 3 ), the four vertices are written once and shared by both.
+ The two triangles don't overlap so they can share a depth even when they're blended.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_AddQuad( const Vector2* positions, const Vector2* uvs, ShaderType shader, GLuint texture, Color color,
+	int camFlags, char depth, TransparencyType transparency )
+{
+	if( renderCapture_IsCapturing( ) ) {
+		renderCapture_AddTriangle( positions[0], positions[1], positions[2], uvs[0], uvs[1], uvs[2],
+			shader, texture, color, camFlags, depth, transparency );
+		renderCapture_AddTriangle( positions[1], positions[2], positions[3], uvs[1], uvs[2], uvs[3],
+			shader, texture, color, camFlags, depth, transparency );
+	}
+
+	TriangleFrame* frame = &( frames[writeFrame] );
+	TriangleList* triList = ( transparency == TT_TRANSLUCENT ) ? &( frame->transparent ) : &( frame->solid );
+	if( ( triList->lastTriIndex >= ( MAX_TRIS - 2 ) ) || ( triList->lastVertIndex >= ( MAX_VERTS - 4 ) ) ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_RENDER, "Triangle list full." );
+		return -1;
+	}
+
+	// blended triangles still use the alpha test so completely clear pixels don't write to the depth buffer
+	int program = PROGRAM_IDX( shader, ( transparency == TT_OPAQUE ) ? SV_OPAQUE : SV_ALPHA_TEST );
+	float z = (float)depth + ( Z_ORDER_OFFSET * ( frame->solid.lastTriIndex + frame->transparent.lastTriIndex + 2 ) );
+
+	int baseVert = triList->lastVertIndex + 1;
+	for( int i = 0; i < 4; ++i ) {
+		Vertex* vert = &( triList->vertices[baseVert + i] );
+		vec2ToVec3( &( positions[i] ), z, &( vert->pos ) );
+		vert->col = color;
+		vert->uv = uvs[i];
+	}
+	triList->lastVertIndex += 4;
+
+	for( int i = 0; i < 2; ++i ) {
+		int idx = ++( triList->lastTriIndex );
+		Triangle* tri = &( triList->triangles[idx] );
+		tri->camFlags = camFlags;
+		tri->texture = texture;
+		tri->zPos = z + ( Z_ORDER_OFFSET * i );
+		tri->program = program;
+		tri->vertexIndices[0] = baseVert + i;
+		tri->vertexIndices[1] = baseVert + i + 1;
+		tri->vertexIndices[2] = baseVert + i + 2;
+	}
+
+	return 0;
+}
+
+/*
+Adds a mesh where the triangles share vertices, positions and uvs are x/y pairs and every three indices make up a
+ triangle. The vertices are only written once and each triangle just references them, offset is added to every
+ position. Blended meshes are split up into separate triangles since each one needs its own depth to be sorted by.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_AddMesh( const float* positions, const float* uvs, int numVerts, const int* indices, int numIndices,
+	Vector2 offset, ShaderType shader, GLuint texture, Color color, int camFlags, char depth, TransparencyType transparency )
+{
+	int numTris = numIndices / 3;
+
+	if( renderCapture_IsCapturing( ) || ( transparency == TT_TRANSLUCENT ) ) {
+		for( int i = 0; i < numTris; ++i ) {
+			Vector2 triPos[3];
+			Vector2 triUVs[3];
+			for( int v = 0; v < 3; ++v ) {
+				int vert = indices[( i * 3 ) + v];
+				triPos[v].x = positions[vert * 2] + offset.x;
+				triPos[v].y = positions[( vert * 2 ) + 1] + offset.y;
+				triUVs[v].x = uvs[vert * 2];
+				triUVs[v].y = uvs[( vert * 2 ) + 1];
+			}
+
+			if( transparency == TT_TRANSLUCENT ) {
+				if( triRenderer_AddVertices( triPos, triUVs, shader, texture, color, camFlags, depth, transparency ) < 0 ) {
+					return -1;
+				}
+			} else {
+				renderCapture_AddTriangle( triPos[0], triPos[1], triPos[2], triUVs[0], triUVs[1], triUVs[2],
+					shader, texture, color, camFlags, depth, transparency );
+			}
+		}
+
+		if( transparency == TT_TRANSLUCENT ) {
+			return 0;
+		}
+	}
+
+	TriangleFrame* frame = &( frames[writeFrame] );
+	TriangleList* triList = &( frame->solid );
+	if( ( ( triList->lastTriIndex + numTris ) >= MAX_TRIS ) || ( ( triList->lastVertIndex + numVerts ) >= MAX_VERTS ) ) {
+		SDL_LogVerbose( SDL_LOG_CATEGORY_RENDER, "Triangle list full." );
+		return -1;
+	}
+
+	int program = PROGRAM_IDX( shader, ( transparency == TT_OPAQUE ) ? SV_OPAQUE : SV_ALPHA_TEST );
+
+	// the vertices share the depth of the first triangle, the triangles still get increasing depths so they sort the
+	//  same way they would have if they were added separately
+	float z = (float)depth + ( Z_ORDER_OFFSET * ( frame->solid.lastTriIndex + frame->transparent.lastTriIndex + 2 ) );
+
+	int baseVert = triList->lastVertIndex + 1;
+	for( int i = 0; i < numVerts; ++i ) {
+		Vertex* vert = &( triList->vertices[baseVert + i] );
+		vert->pos.x = positions[i * 2] + offset.x;
+		vert->pos.y = positions[( i * 2 ) + 1] + offset.y;
+		vert->pos.z = z;
+		vert->col = color;
+		vert->uv.x = uvs[i * 2];
+		vert->uv.y = uvs[( i * 2 ) + 1];
+	}
+	triList->lastVertIndex += numVerts;
+
+	for( int i = 0; i < numTris; ++i ) {
+		int idx = ++( triList->lastTriIndex );
+		Triangle* tri = &( triList->triangles[idx] );
+		tri->camFlags = camFlags;
+		tri->texture = texture;
+		tri->zPos = z + ( Z_ORDER_OFFSET * i );
+		tri->program = program;
+		tri->vertexIndices[0] = baseVert + indices[i * 3];
+		tri->vertexIndices[1] = baseVert + indices[( i * 3 ) + 1];
+		tri->vertexIndices[2] = baseVert + indices[( i * 3 ) + 2];
+	}
+
+	return 0;
+}
+
+/*
+Clears out all the triangles stored in the frame being filled.
 */
 void triRenderer_Clear( void )
 {
-	transparentTriangles.lastTriIndex = -1;
-	solidTriangles.lastTriIndex = -1;
+	frames[writeFrame].transparent.lastTriIndex = -1;
+	frames[writeFrame].transparent.lastVertIndex = -1;
+	frames[writeFrame].solid.lastTriIndex = -1;
+	frames[writeFrame].solid.lastVertIndex = -1;
 }
 
-static int sortShaderTypes( ShaderType st1, ShaderType st2 )
+/*
+Makes the frame that was just filled the one that will be drawn, and the one that was drawn the one to fill.
+ Only call this when nothing is rendering.
+*/
+void triRenderer_SwapFrames( void )
+{
+	int temp = writeFrame;
+	writeFrame = readFrame;
+	readFrame = temp;
+}
+
+static int sortPrograms( int prog1, int prog2 )
 {
-	return( (int)st1 - (int)st2 );
+	return( prog1 - prog2 );
 }
 
 static int sortByRenderState( const void* p1, const void* p2 )
@@ -257,9 +531,9 @@ static int sortByRenderState( const void* p1, const void* p2 )
 	Triangle* tri1 = (Triangle*)p1;
 	Triangle* tri2 = (Triangle*)p2;
 
-	int stDiff = sortShaderTypes( tri1->shaderType, tri2->shaderType );
-	if( stDiff != 0 ) {
-		return stDiff;
+	int progDiff = sortPrograms( tri1->program, tri2->program );
+	if( progDiff != 0 ) {
+		return progDiff;
 	}
 
 	if( tri1->texture < tri2->texture ) {
@@ -268,6 +542,20 @@ static int sortByRenderState( const void* p1, const void* p2 )
 		return 1;
 	}
 
+	// partition each render state by the cameras that can see it
+	if( tri1->visibleCams < tri2->visibleCams ) {
+		return -1;
+	} else if( tri1->visibleCams > tri2->visibleCams ) {
+		return 1;
+	}
+
+	// front to back, so the depth test can reject as much as possible before running the fragment shader
+	if( tri1->zPos > tri2->zPos ) {
+		return -1;
+	} else if( tri1->zPos < tri2->zPos ) {
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -278,92 +566,309 @@ static int sortByDepth( const void* p1, const void* p2 )
 	return ( ( ( tri1->zPos ) - ( tri2->zPos ) ) > 0.0f ) ? 1 : -1;
 }
 
+static int sortByCamerasThenDepth( const void* p1, const void* p2 )
+{
+	Triangle* tri1 = (Triangle*)p1;
+	Triangle* tri2 = (Triangle*)p2;
+
+	if( tri1->visibleCams < tri2->visibleCams ) {
+		return -1;
+	} else if( tri1->visibleCams > tri2->visibleCams ) {
+		return 1;
+	}
+
+	return sortByDepth( p1, p2 );
+}
+
+static int sortPtrsByDepth( const void* p1, const void* p2 )
+{
+	return sortByDepth( *(Triangle**)p1, *(Triangle**)p2 );
+}
+
+/*
+Figures out which cameras will draw each triangle, testing the flags and culling against what each camera can see.
+*/
+static void findVisibleCameras( TriangleList* triList )
+{
+	for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+		Triangle* tri = &( triList->triangles[i] );
+		Vector3* p0 = &( triList->vertices[tri->vertexIndices[0]].pos );
+		Vector3* p1 = &( triList->vertices[tri->vertexIndices[1]].pos );
+		Vector3* p2 = &( triList->vertices[tri->vertexIndices[2]].pos );
+
+		Vector2 triMin, triMax;
+		triMin.x = MIN( p0->x, MIN( p1->x, p2->x ) );
+		triMin.y = MIN( p0->y, MIN( p1->y, p2->y ) );
+		triMax.x = MAX( p0->x, MAX( p1->x, p2->x ) );
+		triMax.y = MAX( p0->y, MAX( p1->y, p2->y ) );
+
+		tri->visibleCams = 0;
+		for( int c = 0; c < numRenderCameras; ++c ) {
+			CameraSnapshot* cam = &( renderCameras[c] );
+			if( ( tri->camFlags & cam->flags ) == 0 ) {
+				continue;
+			}
+
+			if( ( triMax.x < cam->viewMin.x ) || ( triMin.x > cam->viewMax.x ) ||
+				( triMax.y < cam->viewMin.y ) || ( triMin.y > cam->viewMax.y ) ) {
+				continue;
+			}
+
+			tri->visibleCams |= ( 1 << cam->id );
+		}
+	}
+}
+
+/*
+Adds the triangle to the end of the index buffer, creating a new batch if the render state or set of cameras changes.
+*/
+static void addTriangleToBatches( TriangleList* triList, Triangle* tri, unsigned int visibleCams, int forceNewBatch )
+{
+	TriangleBatch* batch = NULL;
+	if( !forceNewBatch && ( triList->lastBatchIndex >= 0 ) ) {
+		batch = &( triList->batches[triList->lastBatchIndex] );
+	}
+
+	if( ( batch == NULL ) || ( batch->visibleCams != visibleCams ) ||
+		( batch->program != tri->program ) || ( batch->texture != tri->texture ) ) {
+		++triList->lastBatchIndex;
+		batch = &( triList->batches[triList->lastBatchIndex] );
+		batch->firstIndex = triList->lastIndexBufferIndex + 1;
+		batch->indexCount = 0;
+		batch->visibleCams = visibleCams;
+		batch->program = tri->program;
+		batch->texture = tri->texture;
+	}
+
+	triList->indices[++triList->lastIndexBufferIndex] = tri->vertexIndices[0];
+	triList->indices[++triList->lastIndexBufferIndex] = tri->vertexIndices[1];
+	triList->indices[++triList->lastIndexBufferIndex] = tri->vertexIndices[2];
+	batch->indexCount += 3;
+}
+
+/*
+Creates the index buffer and the batches each camera will draw from the sorted triangles. Culled triangles are skipped.
+*/
+static void generateBatches( TriangleList* triList )
+{
+	unsigned int lastGroup = 0;
+
+	triList->lastIndexBufferIndex = -1;
+	triList->lastBatchIndex = -1;
+	for( int c = 0; c < NUM_CAMERAS; ++c ) {
+		triList->groupCounts[c] = 0;
+		triList->camFirstBatch[c] = -1;
+		triList->camLastBatch[c] = -1;
+	}
+
+	for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+		Triangle* tri = &( triList->triangles[i] );
+		if( tri->visibleCams == 0 ) {
+			continue;
+		}
+
+		// count the number of separate groups of triangles each camera will have to go through
+		if( tri->visibleCams != lastGroup ) {
+			for( int c = 0; c < NUM_CAMERAS; ++c ) {
+				if( tri->visibleCams & ( 1 << c ) ) {
+					++triList->groupCounts[c];
+				}
+			}
+			lastGroup = tri->visibleCams;
+		}
+
+		addTriangleToBatches( triList, tri, tri->visibleCams, 0 );
+	}
+}
+
+/*
+For lists where the draw order matters a camera that sees multiple groups needs them merged back into a single ordered set,
+ these are stored after the shared batches.
+*/
+static void generateMergedBatches( TriangleList* triList, int ( *compare )( const void*, const void* ) )
+{
+	for( int c = 0; c < numRenderCameras; ++c ) {
+		int id = renderCameras[c].id;
+		unsigned int camBit = ( 1 << id );
+		if( triList->groupCounts[id] <= 1 ) {
+			continue;
+		}
+
+		int numTris = 0;
+		for( int i = 0; i <= triList->lastTriIndex; ++i ) {
+			if( triList->triangles[i].visibleCams & camBit ) {
+				mergeScratch[numTris++] = &( triList->triangles[i] );
+			}
+		}
+
+		if( ( triList->lastIndexBufferIndex + ( numTris * 3 ) ) >= MAX_INDICES ) {
+			SDL_LogVerbose( SDL_LOG_CATEGORY_RENDER, "No room to merge triangles for camera %i, draw order may be wrong.", id );
+			continue;
+		}
+
+		SDL_qsort( mergeScratch, numTris, sizeof( Triangle* ), compare );
+
+		triList->camFirstBatch[id] = triList->lastBatchIndex + 1;
+		for( int i = 0; i < numTris; ++i ) {
+			addTriangleToBatches( triList, mergeScratch[i], camBit, ( i == 0 ) );
+		}
+		triList->camLastBatch[id] = triList->lastBatchIndex;
+	}
+}
+
 static void generateVertexArray( TriangleList* triList )
 {
 	GL( glBindBuffer( GL_ARRAY_BUFFER, triList->VBO ) );
-	GL( glBufferSubData( GL_ARRAY_BUFFER, 0, sizeof( Vertex ) * ( ( triList->lastTriIndex + 1 ) * 3 ), triList->vertices ) );
+	size_t size = sizeof( Vertex ) * ( triList->lastVertIndex + 1 );
+	GL( glBufferSubData( GL_ARRAY_BUFFER, 0, size, triList->vertices ) );
+	frameStats.uploadBytes += size;
+}
+
+static void generateIndexArray( TriangleList* triList )
+{
+	if( triList->lastIndexBufferIndex < 0 ) {
+		return;
+	}
+
+	GL( glBindVertexArray( triList->VAO ) );
+	GL( glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, triList->IBO ) );
+	size_t size = sizeof( GLuint ) * ( triList->lastIndexBufferIndex + 1 );
+	GL( glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, size, triList->indices ) );
+	frameStats.uploadBytes += size;
 }
 
-static void drawTriangles( int currCamera, TriangleList* triList )
+static void drawRanges( GLsizei* counts, const GLvoid** offsets, int numRanges )
 {
-	// create the index buffers to access the vertex buffer
-	//  TODO: Test to see if having the index buffer or the vertex buffer in order is faster
+	if( numRanges == 1 ) {
+		GL( glDrawElements( GL_TRIANGLES, counts[0], GL_UNSIGNED_INT, offsets[0] ) );
+		++frameStats.numDrawCalls;
+	} else if( numRanges > 1 ) {
+		GL( glMultiDrawElements( GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, numRanges ) );
+		++frameStats.numDrawCalls;
+	}
+}
+
+static void drawTriangles( CameraSnapshot* camera, TriangleList* triList )
+{
+	GLsizei counts[MAX_MULTI_DRAW];
+	const GLvoid* offsets[MAX_MULTI_DRAW];
+	int numRanges = 0;
+
+	int lastBoundProgram = -1;
 	GLuint lastBoundTexture = 0;
-	int triIdx = 0;
-	ShaderType lastBoundShader = NUM_SHADERS;
-	Matrix4 vpMat;
-	unsigned int camFlags = 0;
+	int textureBound = 0;
+
+	unsigned int camBit = ( 1 << camera->id );
+	int firstBatch = 0;
+	int lastBatch = triList->lastBatchIndex;
+	if( triList->camFirstBatch[camera->id] >= 0 ) {
+		firstBatch = triList->camFirstBatch[camera->id];
+		lastBatch = triList->camLastBatch[camera->id];
+	} else if( triList->groupCounts[camera->id] == 0 ) {
+		return;
+	}
 
 	// we'll only be accessing the one vertex array
 	GL( glBindVertexArray( triList->VAO ) );
 
-	do {
-		GLuint texture = triList->triangles[triIdx].texture;
-		triList->lastIndexBufferIndex = -1;
+	for( int i = firstBatch; i <= lastBatch; ++i ) {
+		TriangleBatch* batch = &( triList->batches[i] );
+		if( ( batch->visibleCams & camBit ) == 0 ) {
+			continue;
+		}
 
-		if( ( triIdx <= triList->lastTriIndex ) && ( triList->triangles[triIdx].shaderType != lastBoundShader ) ) {
-			// next shader, bind and set up
-			lastBoundShader = triList->triangles[triIdx].shaderType;
+		// batches with the same state are sorted next to each other, so we can send them all at once
+		if( ( batch->program != lastBoundProgram ) || !textureBound || ( batch->texture != lastBoundTexture ) ||
+			( numRanges >= MAX_MULTI_DRAW ) ) {
+			drawRanges( counts, offsets, numRanges );
+			numRanges = 0;
+		}
 
-			camFlags = cam_GetFlags( currCamera );
-			cam_GetVPMatrix( currCamera, &vpMat );
+		if( batch->program != lastBoundProgram ) {
+			// next shader, bind and set up
+			lastBoundProgram = batch->program;
 
-			GL( glUseProgram( shaderPrograms[lastBoundShader].programID ) );
-			GL( glUniformMatrix4fv( shaderPrograms[lastBoundShader].uniformLocs[0], 1, GL_FALSE, &( vpMat.m[0] ) ) );
-			GL( glUniform1i( shaderPrograms[lastBoundShader].uniformLocs[1], 0 ) );
+			GL( glUseProgram( shaderPrograms[lastBoundProgram].programID ) );
+			GL( glUniformMatrix4fv( shaderPrograms[lastBoundProgram].uniformLocs[0], 1, GL_FALSE, &( camera->vpMat.m[0] ) ) );
+			GL( glUniform1i( shaderPrograms[lastBoundProgram].uniformLocs[1], 0 ) );
 		}
 
-		// gather the list of all the triangles to be drawn
-		while( ( triIdx <= triList->lastTriIndex ) && ( triList->triangles[triIdx].texture == texture ) &&
-				( triList->triangles[triIdx].shaderType == lastBoundShader ) ) {
-			if( ( triList->triangles[triIdx].camFlags & camFlags ) != 0 ) {
-				triList->indices[++triList->lastIndexBufferIndex] = triList->triangles[triIdx].vertexIndices[0];
-				triList->indices[++triList->lastIndexBufferIndex] = triList->triangles[triIdx].vertexIndices[1];
-				triList->indices[++triList->lastIndexBufferIndex] = triList->triangles[triIdx].vertexIndices[2];
-			}
-			++triIdx;
+		if( !textureBound || ( batch->texture != lastBoundTexture ) ) {
+			lastBoundTexture = batch->texture;
+			textureBound = 1;
+			GL( glBindTexture( GL_TEXTURE_2D, lastBoundTexture ) );
 		}
 
-		// send the indices of the vertex array to draw, if there is any
-		if( triList->lastIndexBufferIndex < 0 ) {
-			continue;
-		}
-		GL( glBindTexture( GL_TEXTURE_2D, texture ) );
-		GL( glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, sizeof( GLuint ) * ( triList->lastIndexBufferIndex + 1 ), triList->indices ) );
-		GL( glDrawElements( GL_TRIANGLES, triList->lastIndexBufferIndex + 1, GL_UNSIGNED_INT, NULL ) );
-	} while( triIdx <= triList->lastTriIndex );
+		counts[numRanges] = batch->indexCount;
+		offsets[numRanges] = (const GLvoid*)( sizeof( GLuint ) * batch->firstIndex );
+		++numRanges;
+	}
+
+	drawRanges( counts, offsets, numRanges );
 }
 
 /*
-Draws out all the triangles.
+Draws out all the triangles in the frame that was last swapped in, as seen by the cameras passed in.
 */
-void triRenderer_Render( void )
+void triRenderer_Render( CameraSnapshot* cameras, int numCameras )
 {
-	SDL_qsort( solidTriangles.triangles, solidTriangles.lastTriIndex + 1, sizeof( Triangle ), sortByRenderState );
-	SDL_qsort( transparentTriangles.triangles, transparentTriangles.lastTriIndex + 1, sizeof( Triangle ), sortByDepth );
+	TriangleList* solidTriangles = &( frames[readFrame].solid );
+	TriangleList* transparentTriangles = &( frames[readFrame].transparent );
+	renderCameras = cameras;
+	numRenderCameras = numCameras;
+
+	memset( &frameStats, 0, sizeof( frameStats ) );
+	frameStats.numTriangles = ( solidTriangles->lastTriIndex + 1 ) + ( transparentTriangles->lastTriIndex + 1 );
+
+	// figure out who can see what once, then sort so each camera's triangles are in contiguous ranges
+	findVisibleCameras( solidTriangles );
+	findVisibleCameras( transparentTriangles );
+
+	SDL_qsort( solidTriangles->triangles, solidTriangles->lastTriIndex + 1, sizeof( Triangle ), sortByRenderState );
+	SDL_qsort( transparentTriangles->triangles, transparentTriangles->lastTriIndex + 1, sizeof( Triangle ), sortByCamerasThenDepth );
 
-	// now that the triangles have been sorted create the vertex arrays
-	generateVertexArray( &solidTriangles );
-	generateVertexArray( &transparentTriangles );
+	// now that the triangles have been sorted create the vertex and index arrays
+	generateBatches( solidTriangles );
+	generateBatches( transparentTriangles );
+	generateMergedBatches( transparentTriangles, sortPtrsByDepth );
+	frameStats.numBatches = ( solidTriangles->lastBatchIndex + 1 ) + ( transparentTriangles->lastBatchIndex + 1 );
+
+	generateVertexArray( solidTriangles );
+	generateVertexArray( transparentTriangles );
+	generateIndexArray( solidTriangles );
+	generateIndexArray( transparentTriangles );
 
 	GL( glDisable( GL_CULL_FACE ) );
 	GL( glEnable( GL_DEPTH_TEST ) );
 	GL( glDepthMask( GL_TRUE ) );
 	GL( glDepthFunc( GL_LESS ) );
 
-	// render triangles
+	// render triangles, the scissor test limits the depth clear to the area each camera covers
 	// TODO: We're ignoring any issues with cameras and transparency, probably want to handle this better.
-	for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
+	GL( glEnable( GL_SCISSOR_TEST ) );
+	for( int i = 0; i < numRenderCameras; ++i ) {
+		int* viewport = renderCameras[i].viewport;
+		GL( glViewport( viewport[0], viewport[1], viewport[2], viewport[3] ) );
+		GL( glScissor( viewport[0], viewport[1], viewport[2], viewport[3] ) );
 		GL( glClear( GL_DEPTH_BUFFER_BIT ) );
 		
 		GL( glDisable( GL_BLEND ) );
-		drawTriangles( currCamera, &solidTriangles );
+		drawTriangles( &( renderCameras[i] ), solidTriangles );
 
 		GL( glEnable( GL_BLEND ) );
 		GL( glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA ) );
-		drawTriangles( currCamera, &transparentTriangles );
+		drawTriangles( &( renderCameras[i] ), transparentTriangles );
 	}
+	GL( glDisable( GL_SCISSOR_TEST ) );
 
 	GL( glBindVertexArray( 0 ) );
 	GL( glUseProgram( 0 ) );
+}
+
+/*
+Gets what was done during the last call to triRenderer_Render.
+*/
+void triRenderer_GetStats( TriRendererStats* outStats )
+{
+	(*outStats) = frameStats;
 }
\ No newline at end of file
@@ -6,13 +6,30 @@
 
 #include "../Math/vector2.h"
 #include "color.h"
+#include "camera.h"
 
 typedef enum {
 	ST_DEFAULT,
 	ST_ALPHA_ONLY,
+	ST_SDF, // the alpha is a signed distance field, 0.5 is the edge
 	NUM_SHADERS
 } ShaderType;
 
+// how the alpha of a triangle needs to be handled, determines which list and shader variant it's drawn with
+typedef enum {
+	TT_OPAQUE,		// every pixel is solid, no alpha testing or blending
+	TT_ALPHA_TEST,	// pixels are either completely solid or completely clear
+	TT_TRANSLUCENT	// has partially transparent pixels, needs to be blended
+} TransparencyType;
+
+// what was done during the last call to triRenderer_Render
+typedef struct {
+	int numTriangles;
+	int numBatches;
+	int numDrawCalls;
+	size_t uploadBytes;
+} TriRendererStats;
+
 /*
 Makes all the shaders reload.
 */
@@ -28,18 +45,47 @@ int triRenderer_Init( void );
 We'll assume the array has three vertices in it.
  Return a value < 0 if there's a problem.
 */
-int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader, GLuint texture, Color color, int camFlags, char depth, int transparent );
+int triRenderer_AddVertices( Vector2* positions, Vector2* uvs, ShaderType shader, GLuint texture, Color color, int camFlags, char depth,
+	TransparencyType transparency );
 int triRenderer_Add( Vector2 pos0, Vector2 pos1, Vector2 pos2, Vector2 uv0, Vector2 uv1, Vector2 uv2, ShaderType shader, GLuint texture,
-	Color color, int camFlags, char depth, int transparent );
+	Color color, int camFlags, char depth, TransparencyType transparency );
 
 /*
-Clears out all the triangles currently stored.
+Adds a quad made of the triangles ( 0, 1, 2 ) and ( 1, 2, 3 ), the four vertices are written once and shared by both.
+ The two triangles don't overlap so they can share a depth even when they're blended.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_AddQuad( const Vector2* positions, const Vector2* uvs, ShaderType shader, GLuint texture, Color color,
+	int camFlags, char depth, TransparencyType transparency );
+
+/*
+Adds a mesh where the triangles share vertices, positions and uvs are x/y pairs and every three indices make up a
+ triangle. The vertices are only written once and each triangle just references them, offset is added to every
+ position. Blended meshes are split up into separate triangles since each one needs its own depth to be sorted by.
+ Returns a value < 0 if there's a problem.
+*/
+int triRenderer_AddMesh( const float* positions, const float* uvs, int numVerts, const int* indices, int numIndices,
+	Vector2 offset, ShaderType shader, GLuint texture, Color color, int camFlags, char depth, TransparencyType transparency );
+
+/*
+Clears out all the triangles stored in the frame being filled.
 */
 void triRenderer_Clear( void );
 
 /*
-Draws out all the triangles.
+Makes the frame that was just filled the one that will be drawn, and the one that was drawn the one to fill.
+ Only call this when nothing is rendering.
+*/
+void triRenderer_SwapFrames( void );
+
+/*
+Draws out all the triangles in the frame that was last swapped in, as seen by the cameras passed in.
+*/
+void triRenderer_Render( CameraSnapshot* cameras, int numCameras );
+
+/*
+Gets what was done during the last call to triRenderer_Render.
 */
-void triRenderer_Render( void );
+void triRenderer_GetStats( TriRendererStats* outStats );
 
 #endif /* inclusion guard */
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "cacheFile.h"
+
+#include <SDL_filesystem.h>
+#include <SDL_stdinc.h>
+
+#define CACHE_ORG "Oszmot"
+#define CACHE_APP "The Halls of Oszmot"
+
+// ends with a path separator, NULL until the first cache file is asked for
+static char* prefPath = NULL;
+
+/*
+Builds the name of the cache file for an asset, the file name of the asset without its directory followed by the
+ extension. Assets in different directories can share a name, so the cache file has to hold something to check it
+ was made from the right one.
+ Returns <0 if there's nowhere to put cache files or the name doesn't fit.
+*/
+int cacheFile_GetName( const char* assetFileName, const char* extension, char* outName, size_t nameSize )
+{
+	if( prefPath == NULL ) {
+		prefPath = SDL_GetPrefPath( CACHE_ORG, CACHE_APP );
+		if( prefPath == NULL ) {
+			return -1;
+		}
+	}
+
+	const char* baseName = assetFileName;
+	for( const char* c = assetFileName; *c != 0; ++c ) {
+		if( ( *c == '/' ) || ( *c == '\\' ) ) {
+			baseName = c + 1;
+		}
+	}
+
+	int length = SDL_snprintf( outName, nameSize, "%s%s%s", prefPath, baseName, extension );
+	if( ( length < 0 ) || ( (size_t)length >= nameSize ) ) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Frees up what was used to find the pref directory.
+*/
+void cacheFile_ShutDown( void )
+{
+	SDL_free( prefPath );
+	prefPath = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <stddef.h>
+
+/*
+Cache files made from assets are kept in the user's pref directory, the directory the assets are in may not be
+ writable.
+*/
+
+/*
+Builds the name of the cache file for an asset, the file name of the asset without its directory followed by the
+ extension. Assets in different directories can share a name, so the cache file has to hold something to check it
+ was made from the right one.
+ Returns <0 if there's nowhere to put cache files or the name doesn't fit.
+*/
+int cacheFile_GetName( const char* assetFileName, const char* extension, char* outName, size_t nameSize );
+
+/*
+Frees up what was used to find the pref directory.
+*/
+void cacheFile_ShutDown( void );
+
+#endif /* inclusion guard */
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "jobs.h"
+
+#include <SDL_log.h>
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include <SDL_cpuinfo.h>
+#include <assert.h>
+
+#define MAX_JOB_THREADS 16
+
+static SDL_Thread* workers[MAX_JOB_THREADS];
+static int numWorkers = 0;
+
+// chunks are handed out and counted under the mutex, there's only a handful per job so it isn't worth anything fancier
+static SDL_mutex* jobMutex = NULL;
+static SDL_cond* workCond = NULL;
+static SDL_cond* doneCond = NULL;
+static int quitWorkers;
+
+// the current job, nothing is left to claim once nextChunk reaches numChunks
+static JobRangeFunc jobFunc = NULL;
+static void* jobData = NULL;
+static int jobCount;
+static int jobChunkSize;
+static int numChunks;
+static int nextChunk;
+static int chunksDone;
+
+/*
+Claims the next chunk and runs it, must be called with the mutex locked, which is still locked when it returns.
+ Returns 0 if there was nothing left to claim.
+*/
+static int runNextChunk( void )
+{
+	if( nextChunk >= numChunks ) {
+		return 0;
+	}
+
+	int chunk = nextChunk++;
+	JobRangeFunc func = jobFunc;
+	void* data = jobData;
+	int first = chunk * jobChunkSize;
+	int count = SDL_min( jobChunkSize, jobCount - first );
+	SDL_UnlockMutex( jobMutex );
+
+	func( first, count, data );
+
+	SDL_LockMutex( jobMutex );
+	++chunksDone;
+	if( chunksDone >= numChunks ) {
+		SDL_CondSignal( doneCond );
+	}
+
+	return 1;
+}
+
+static int workerMain( void* data )
+{
+	SDL_LockMutex( jobMutex );
+	for( ;; ) {
+		while( ( nextChunk >= numChunks ) && !quitWorkers ) {
+			SDL_CondWait( workCond, jobMutex );
+		}
+
+		if( quitWorkers ) {
+			break;
+		}
+
+		runNextChunk( );
+	}
+	SDL_UnlockMutex( jobMutex );
+
+	return 0;
+}
+
+/*
+Starts up the worker threads. If numThreads is < 0 it will use two less than the number of cores, leaving room for the
+ main and render threads, if it's 0 everything is run on the thread that starts it.
+ Returns < 0 if there's a problem.
+*/
+int jobs_Init( int numThreads )
+{
+	if( numThreads < 0 ) {
+		numThreads = SDL_GetCPUCount( ) - 2;
+	}
+	numThreads = SDL_max( 0, SDL_min( numThreads, MAX_JOB_THREADS ) );
+
+	quitWorkers = 0;
+	jobFunc = NULL;
+	jobData = NULL;
+	numChunks = nextChunk = chunksDone = 0;
+
+	jobMutex = SDL_CreateMutex( );
+	workCond = SDL_CreateCond( );
+	doneCond = SDL_CreateCond( );
+	if( ( jobMutex == NULL ) || ( workCond == NULL ) || ( doneCond == NULL ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_SYSTEM, "Unable to create job synchronization: %s", SDL_GetError( ) );
+		return -1;
+	}
+
+	for( numWorkers = 0; numWorkers < numThreads; ++numWorkers ) {
+		workers[numWorkers] = SDL_CreateThread( workerMain, "jobs", NULL );
+		if( workers[numWorkers] == NULL ) {
+			// not fatal, the work still gets done with fewer threads
+			SDL_LogWarn( SDL_LOG_CATEGORY_SYSTEM, "Unable to create job thread: %s", SDL_GetError( ) );
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Stops the worker threads, shouldn't be called while any work is running.
+*/
+void jobs_ShutDown( void )
+{
+	if( jobMutex != NULL ) {
+		SDL_LockMutex( jobMutex );
+		quitWorkers = 1;
+		SDL_CondBroadcast( workCond );
+		SDL_UnlockMutex( jobMutex );
+	}
+
+	for( int i = 0; i < numWorkers; ++i ) {
+		SDL_WaitThread( workers[i], NULL );
+		workers[i] = NULL;
+	}
+	numWorkers = 0;
+
+	SDL_DestroyCond( doneCond );
+	doneCond = NULL;
+	SDL_DestroyCond( workCond );
+	workCond = NULL;
+	SDL_DestroyMutex( jobMutex );
+	jobMutex = NULL;
+}
+
+/*
+Returns how many worker threads there are, not counting the thread that starts the work.
+*/
+int jobs_GetNumWorkers( void )
+{
+	return numWorkers;
+}
+
+/*
+Calls func for every item from 0 to count - 1, split up into chunks of at most chunkSize items that are spread across
+ the workers and the calling thread. Returns once every chunk is done. The chunks can run in any order, so func must
+ not depend on any other chunk.
+*/
+void jobs_ParallelFor( int count, int chunkSize, JobRangeFunc func, void* data )
+{
+	assert( func != NULL );
+	assert( chunkSize > 0 );
+
+	if( count <= 0 ) {
+		return;
+	}
+
+	// nobody to share with
+	if( ( numWorkers <= 0 ) || ( count <= chunkSize ) ) {
+		func( 0, count, data );
+		return;
+	}
+
+	SDL_LockMutex( jobMutex );
+	assert( chunksDone >= numChunks );
+
+	jobFunc = func;
+	jobData = data;
+	jobCount = count;
+	jobChunkSize = chunkSize;
+	numChunks = ( count + chunkSize - 1 ) / chunkSize;
+	chunksDone = 0;
+	nextChunk = 0;
+	SDL_CondBroadcast( workCond );
+
+	while( runNextChunk( ) ) ;
+
+	while( chunksDone < numChunks ) {
+		SDL_CondWait( doneCond, jobMutex );
+	}
+
+	jobFunc = NULL;
+	jobData = NULL;
+	SDL_UnlockMutex( jobMutex );
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/*
+A pool of worker threads for splitting independent work up into chunks. The thread that starts the work helps with it
+ and doesn't return until every chunk is done, so the work is finished at a known point each time. Work should only
+ be started from the main thread.
+*/
+
+// called for each chunk of the work, processes the items from first to first + count - 1
+typedef void (*JobRangeFunc)( int first, int count, void* data );
+
+/*
+Starts up the worker threads. If numThreads is < 0 it will use two less than the number of cores, leaving room for the
+ main and render threads, if it's 0 everything is run on the thread that starts it.
+ Returns < 0 if there's a problem.
+*/
+int jobs_Init( int numThreads );
+
+/*
+Stops the worker threads, shouldn't be called while any work is running.
+*/
+void jobs_ShutDown( void );
+
+/*
+Returns how many worker threads there are, not counting the thread that starts the work.
+*/
+int jobs_GetNumWorkers( void );
+
+/*
+Calls func for every item from 0 to count - 1, split up into chunks of at most chunkSize items that are spread across
+ the workers and the calling thread. Returns once every chunk is done. The chunks can run in any order, so func must
+ not depend on any other chunk.
+*/
+void jobs_ParallelFor( int count, int chunkSize, JobRangeFunc func, void* data );
+
+#endif /* inclusion guard */
\ No newline at end of file
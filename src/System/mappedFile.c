@@ -0,0 +1,98 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+/*
+Maps the entire file into memory, empty files can't be mapped.
+ Returns < 0 if there's a problem.
+*/
+int mappedFile_Open( const char* fileName, MappedFile* outFile )
+{
+	outFile->data = NULL;
+	outFile->size = 0;
+
+#ifdef _WIN32
+	outFile->mappingHandle = NULL;
+	outFile->fileHandle = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if( outFile->fileHandle == INVALID_HANDLE_VALUE ) {
+		return -1;
+	}
+
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx( outFile->fileHandle, &fileSize ) || ( fileSize.QuadPart == 0 ) ) {
+		mappedFile_Close( outFile );
+		return -1;
+	}
+
+	outFile->mappingHandle = CreateFileMappingA( outFile->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+	if( outFile->mappingHandle == NULL ) {
+		mappedFile_Close( outFile );
+		return -1;
+	}
+
+	outFile->data = (const uint8_t*)MapViewOfFile( outFile->mappingHandle, FILE_MAP_READ, 0, 0, 0 );
+	if( outFile->data == NULL ) {
+		mappedFile_Close( outFile );
+		return -1;
+	}
+	outFile->size = (size_t)fileSize.QuadPart;
+#else
+	int fd = open( fileName, O_RDONLY );
+	if( fd < 0 ) {
+		return -1;
+	}
+
+	struct stat fileStat;
+	if( ( fstat( fd, &fileStat ) != 0 ) || ( fileStat.st_size == 0 ) ) {
+		close( fd );
+		return -1;
+	}
+
+	// the mapping stays valid after the file is closed
+	void* mapping = mmap( NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( mapping == MAP_FAILED ) {
+		return -1;
+	}
+
+	outFile->data = (const uint8_t*)mapping;
+	outFile->size = (size_t)fileStat.st_size;
+#endif
+
+	return 0;
+}
+
+/*
+Unmaps the file, anything pointing into the data is invalid after this.
+*/
+void mappedFile_Close( MappedFile* file )
+{
+#ifdef _WIN32
+	if( file->data != NULL ) {
+		UnmapViewOfFile( file->data );
+	}
+	if( file->mappingHandle != NULL ) {
+		CloseHandle( file->mappingHandle );
+		file->mappingHandle = NULL;
+	}
+	if( ( file->fileHandle != NULL ) && ( file->fileHandle != INVALID_HANDLE_VALUE ) ) {
+		CloseHandle( file->fileHandle );
+	}
+	file->fileHandle = NULL;
+#else
+	if( file->data != NULL ) {
+		munmap( (void*)file->data, file->size );
+	}
+#endif
+
+	file->data = NULL;
+	file->size = 0;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Read only memory mapping of an entire file, the operating system pages the data in as it's touched so nothing is read
+ that isn't used.
+*/
+typedef struct {
+	const uint8_t* data; // NULL if nothing is mapped
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+} MappedFile;
+
+/*
+Maps the entire file into memory, empty files can't be mapped.
+ Returns < 0 if there's a problem.
+*/
+int mappedFile_Open( const char* fileName, MappedFile* outFile );
+
+/*
+Unmaps the file, anything pointing into the data is invalid after this.
+*/
+void mappedFile_Close( MappedFile* file );
+
+#endif /* inclusion guard */
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "memory.h"
 
 #include <SDL_log.h>
+#include <SDL_mutex.h>
 #include <assert.h>
 #include <stdint.h>
 #include <string.h>
@@ -43,6 +44,10 @@ typedef struct {
 
 static Memory memoryBlock;
 
+// assets are decoded on worker threads so everything that touches the blocks is guarded, needs to be recursive
+//  since resizing can allocate
+static SDL_mutex* memoryLock = NULL;
+
 #ifdef TEST_CLEAR_VALUES
 static void testingSetMemory( void* start, size_t size, uint8_t val )
 {
@@ -200,6 +205,11 @@ int mem_Init( size_t totalSize )
 
 	createNewBlock( memoryBlock.memory, NULL, NULL, totalSize - sizeof( MemoryBlockHeader ), __FILE__, __LINE__ );
 
+	memoryLock = SDL_CreateMutex( );
+	if( memoryLock == NULL ) {
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -208,6 +218,9 @@ void mem_CleanUp( void )
 	// invalidates all the pointers
 	SDL_free( memoryBlock.memory );
 	memoryBlock.memory = NULL;
+
+	SDL_DestroyMutex( memoryLock );
+	memoryLock = NULL;
 }
 
 void mem_Log( void )
@@ -235,6 +248,8 @@ void* mem_Allocate_Data( size_t size, const char* fileName, const int line )
 {
 	assert( memoryBlock.memory != NULL );
 
+	SDL_LockMutex( memoryLock );
+
 	// we'll just do first fit, if we can't find a spot we'll just return NULL
 	char* result = NULL;
 
@@ -269,6 +284,8 @@ void* mem_Allocate_Data( size_t size, const char* fileName, const int line )
 		header->size = size;
 	}
 
+	SDL_UnlockMutex( memoryLock );
+
 	assert( result != NULL );
 	return (void*)result;
 }
@@ -290,6 +307,7 @@ void* mem_Resize_Data( void* memory, size_t newSize, const char* fileName, const
 	// or we could just assert
 	void* result = memory;
 
+	SDL_LockMutex( memoryLock );
 	if( memory != NULL ) {
 		MemoryBlockHeader* header = (MemoryBlockHeader*)( ( (char*)memory ) - sizeof( MemoryBlockHeader ) );
 		if( newSize > header->size ) {
@@ -300,6 +318,7 @@ void* mem_Resize_Data( void* memory, size_t newSize, const char* fileName, const
 	} else {
 		result = mem_Allocate( newSize );
 	}
+	SDL_UnlockMutex( memoryLock );
 
 	assert( result != NULL );
 	return result;
@@ -315,6 +334,8 @@ void mem_Release_Data( void* memory, const char* fileName, const int line )
 	
 	// set the associated block as not in use, and merge with nearby blocks if they're
 	//  not in use
+	SDL_LockMutex( memoryLock );
+
 	MemoryBlockHeader* header = (MemoryBlockHeader*)( ((char*)memory) - sizeof( MemoryBlockHeader ) );
 	header->flags &= ~IN_USE_FLAG;
 
@@ -322,4 +343,6 @@ void mem_Release_Data( void* memory, const char* fileName, const int line )
 	
 	header = condenseMemoryBlocks( header, fileName, line );
 	testingSetMemory( (void*)( ( (char*)header ) + sizeof( MemoryBlockHeader ) ), header->size, 0xFF );
+
+	SDL_UnlockMutex( memoryLock );
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+/*
+Render benchmark, replays a frame saved with renderCapture_Request over and over and reports how long the triangle
+ renderer took to process it, along with how many pixels were drawn. The replay runs on the render thread, the same as in the game. Everything is drawn
+ into a hidden window, to run it without a display use the offscreen video driver (SDL_VIDEODRIVER=offscreen) or a
+ software GL like Mesa's llvmpipe.
+
+ Usage: benchRender <capture file> [iterations]
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <SDL_main.h>
+#include <SDL.h>
+
+#include "../Graphics/graphics.h"
+#include "../Graphics/triRendering.h"
+#include "../Graphics/renderCapture.h"
+#include "../Graphics/glDebugging.h"
+#include "../System/memory.h"
+#include "../Utils/stretchyBuffer.h"
+
+#define DEFAULT_ITERATIONS 500
+#define WARM_UP_ITERATIONS 10
+
+static SDL_Window* window = NULL;
+
+typedef struct {
+	double min;
+	double max;
+	double total;
+} Timing;
+
+// everything the replay needs, the triangle renderer can only be used on the render thread
+typedef struct {
+	RenderCapture* capture;
+	GLuint* textureMap;
+	CameraSnapshot cameras[NUM_CAMERAS];
+	int numCameras;
+	GLuint timerQuery;
+	GLuint samplesQuery;
+	Uint64 cpuCounter;
+	GLuint64 gpuNanoseconds;
+	GLuint samplesPassed;
+	TriRendererStats stats;
+} ReplayJob;
+
+static void timing_Reset( Timing* timing )
+{
+	timing->min = DBL_MAX;
+	timing->max = 0.0;
+	timing->total = 0.0;
+}
+
+static void timing_Add( Timing* timing, double value )
+{
+	timing->min = SDL_min( timing->min, value );
+	timing->max = SDL_max( timing->max, value );
+	timing->total += value;
+}
+
+static void setupRenderThread( void* data )
+{
+	ReplayJob* job = (ReplayJob*)data;
+
+	// vsync would only get in the way
+	SDL_GL_SetSwapInterval( 0 );
+	GL( glGenQueries( 1, &( job->timerQuery ) ) );
+	GL( glGenQueries( 1, &( job->samplesQuery ) ) );
+}
+
+static void destroyQueries( void* data )
+{
+	ReplayJob* job = (ReplayJob*)data;
+
+	GL( glDeleteQueries( 1, &( job->timerQuery ) ) );
+	GL( glDeleteQueries( 1, &( job->samplesQuery ) ) );
+}
+
+static void replayFrame( void* data )
+{
+	ReplayJob* job = (ReplayJob*)data;
+
+	GL( glBeginQuery( GL_TIME_ELAPSED, job->timerQuery ) );
+	// the textures are solid so nothing is thrown out by the alpha test, this is every pixel that was drawn
+	GL( glBeginQuery( GL_SAMPLES_PASSED, job->samplesQuery ) );
+	Uint64 startCounter = SDL_GetPerformanceCounter( );
+
+	triRenderer_Clear( );
+	renderCapture_SubmitTriangles( job->capture, job->textureMap );
+	triRenderer_SwapFrames( );
+	triRenderer_Render( job->cameras, job->numCameras );
+
+	job->cpuCounter = SDL_GetPerformanceCounter( ) - startCounter;
+	GL( glEndQuery( GL_SAMPLES_PASSED ) );
+	GL( glEndQuery( GL_TIME_ELAPSED ) );
+
+	// waits until the gpu has finished, so each iteration starts with nothing queued up
+	GL( glGetQueryObjectui64v( job->timerQuery, GL_QUERY_RESULT, &( job->gpuNanoseconds ) ) );
+	GL( glGetQueryObjectuiv( job->samplesQuery, GL_QUERY_RESULT, &( job->samplesPassed ) ) );
+	triRenderer_GetStats( &( job->stats ) );
+}
+
+static void cleanUp( void )
+{
+	gfx_ShutDown( );
+	SDL_DestroyWindow( window );
+	window = NULL;
+	SDL_Quit( );
+	mem_CleanUp( );
+}
+
+static int initEverything( int width, int height )
+{
+	mem_Init( 64 * 1024 * 1024 );
+
+	SDL_SetMainReady( );
+	if( SDL_Init( SDL_INIT_VIDEO ) != 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, SDL_GetError( ) );
+		return -1;
+	}
+	atexit( cleanUp );
+
+	// need at least 3.3 for the timer queries
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
+	SDL_GL_SetAttribute( SDL_GL_DEPTH_SIZE, 24 );
+	SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
+
+	window = SDL_CreateWindow( "benchRender", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+		width, height, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL );
+	if( window == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, SDL_GetError( ) );
+		return -1;
+	}
+
+	if( gfx_Init( window ) < 0 ) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Creates a blank texture for each one in the capture, they're the same size so sampling them costs about the same.
+*/
+static GLuint* createTextures( RenderCapture* capture )
+{
+	GLuint* textureMap = NULL;
+	int numTextures = sb_Count( capture->sbTextures );
+	if( numTextures <= 0 ) {
+		return NULL;
+	}
+
+	sb_Add( textureMap, numTextures );
+	GL( glGenTextures( numTextures, textureMap ) );
+
+	for( int i = 0; i < numTextures; ++i ) {
+		int width = SDL_max( 1, capture->sbTextures[i].width );
+		int height = SDL_max( 1, capture->sbTextures[i].height );
+
+		// solid white so nothing gets thrown out by the alpha test
+		unsigned char* pixels = mem_Allocate( width * height * 4 );
+		memset( pixels, 0xff, width * height * 4 );
+
+		GL( glBindTexture( GL_TEXTURE_2D, textureMap[i] ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
+		GL( glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels ) );
+
+		mem_Release( pixels );
+	}
+	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+
+	// they're used by the render thread's context
+	GL( glFinish( ) );
+
+	return textureMap;
+}
+
+int main( int argc, char** argv )
+{
+	RenderCapture capture;
+	int iterations = DEFAULT_ITERATIONS;
+
+	if( argc < 2 ) {
+		SDL_Log( "Usage: %s <capture file> [iterations]", argv[0] );
+		return 1;
+	}
+
+	if( argc >= 3 ) {
+		iterations = SDL_max( 1, atoi( argv[2] ) );
+	}
+
+	// need the memory system before loading, but the size of the window comes from the capture
+	if( ( initEverything( 800, 600 ) < 0 ) || ( renderCapture_Load( argv[1], &capture ) < 0 ) ) {
+		return 1;
+	}
+
+	// render directly into the window at the size the frame was captured at
+	SDL_SetWindowSize( window, capture.renderWidth, capture.renderHeight );
+	gfx_SetRenderResolution( 0, 0 );
+	renderCapture_SetupCameras( &capture );
+
+	ReplayJob job;
+	memset( &job, 0, sizeof( job ) );
+	job.capture = &capture;
+	job.textureMap = createTextures( &capture );
+	job.numCameras = cam_TakeSnapshots( job.cameras );
+	gfx_RunOnRenderThread( setupRenderThread, &job );
+
+	Timing cpuTiming;
+	Timing gpuTiming;
+	timing_Reset( &cpuTiming );
+	timing_Reset( &gpuTiming );
+	double totalUploadBytes = 0.0;
+	double totalSamples = 0.0;
+	double counterToMS = 1000.0 / (double)SDL_GetPerformanceFrequency( );
+
+	for( int i = -WARM_UP_ITERATIONS; i < iterations; ++i ) {
+		SDL_PumpEvents( );
+		gfx_RunOnRenderThread( replayFrame, &job );
+
+		if( i < 0 ) {
+			continue;
+		}
+
+		timing_Add( &cpuTiming, (double)job.cpuCounter * counterToMS );
+		timing_Add( &gpuTiming, (double)job.gpuNanoseconds / 1000000.0 );
+		totalUploadBytes += (double)job.stats.uploadBytes;
+		totalSamples += (double)job.samplesPassed;
+	}
+
+	SDL_Log( "Capture: %s  %ix%i  %i cameras  %i textures  %i triangles", argv[1], capture.renderWidth, capture.renderHeight,
+		sb_Count( capture.sbCameras ), sb_Count( capture.sbTextures ), sb_Count( capture.sbTriangles ) );
+	SDL_Log( "Iterations: %i", iterations );
+	SDL_Log( "CPU submit ms: avg %.4f  min %.4f  max %.4f", cpuTiming.total / iterations, cpuTiming.min, cpuTiming.max );
+	SDL_Log( "GPU ms:        avg %.4f  min %.4f  max %.4f", gpuTiming.total / iterations, gpuTiming.min, gpuTiming.max );
+	SDL_Log( "Upload KB per frame: %.2f", ( totalUploadBytes / iterations ) / 1024.0 );
+	SDL_Log( "Pixels drawn per frame: %.0f  (%.2fx the screen)", totalSamples / iterations,
+		( totalSamples / iterations ) / ( (double)capture.renderWidth * (double)capture.renderHeight ) );
+	SDL_Log( "Batches: %i  Draw calls: %i", job.stats.numBatches, job.stats.numDrawCalls );
+
+	gfx_RunOnRenderThread( destroyQueries, &job );
+	if( job.textureMap != NULL ) {
+		GL( glDeleteTextures( sb_Count( job.textureMap ), job.textureMap ) );
+		sb_Release( job.textureMap );
+	}
+	renderCapture_Release( &capture );
+
+	return 0;
+}
\ No newline at end of file
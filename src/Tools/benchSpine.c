@@ -0,0 +1,228 @@
+/*
+Spine crowd benchmark, creates a crowd of instances of a skeleton playing an animation and times how long updating
+ them takes, first spread across the job threads and then with everything on the main thread. Both crowds are stepped
+ the same way, so their bones should end up in exactly the same place, which is checked at the end. The atlas textures
+ need a window, to run it without a display use the offscreen video driver (SDL_VIDEODRIVER=offscreen).
+
+ Usage: benchSpine <spine file base> <animation name> [instances] [iterations]
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <SDL_main.h>
+#include <SDL.h>
+
+#include "../Graphics/graphics.h"
+#include "../Graphics/spineGfx.h"
+#include "../System/jobs.h"
+#include "../System/memory.h"
+
+#define DEFAULT_INSTANCES 1500
+#define DEFAULT_ITERATIONS 300
+#define WARM_UP_ITERATIONS 10
+#define UPDATE_DT ( 1.0f / 60.0f )
+
+// how far apart in time each instance starts in the animation, so they're not all in the same pose
+#define STAGGER_SECONDS 0.037f
+
+static SDL_Window* window = NULL;
+
+typedef struct {
+	double min;
+	double max;
+	double total;
+} Timing;
+
+static void timing_Reset( Timing* timing )
+{
+	timing->min = DBL_MAX;
+	timing->max = 0.0;
+	timing->total = 0.0;
+}
+
+static void timing_Add( Timing* timing, double value )
+{
+	timing->min = SDL_min( timing->min, value );
+	timing->max = SDL_max( timing->max, value );
+	timing->total += value;
+}
+
+static void cleanUp( void )
+{
+	spine_CleanEverything( );
+	gfx_ShutDown( );
+	SDL_DestroyWindow( window );
+	window = NULL;
+	SDL_Quit( );
+	mem_CleanUp( );
+}
+
+static int initEverything( void )
+{
+	mem_Init( 256 * 1024 * 1024 );
+
+	SDL_SetMainReady( );
+	if( SDL_Init( SDL_INIT_VIDEO ) != 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, SDL_GetError( ) );
+		return -1;
+	}
+	atexit( cleanUp );
+
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
+	SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
+
+	window = SDL_CreateWindow( "benchSpine", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+		320, 240, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL );
+	if( window == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, SDL_GetError( ) );
+		return -1;
+	}
+
+	if( gfx_Init( window ) < 0 ) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+Creates the crowd, every instance plays the animation looping but starts at a different point in it. The ids of the
+ instances are stored in outIDs.
+ Returns < 0 if there's a problem.
+*/
+static int createCrowd( int templateIdx, const char* animName, int numInstances, int* outIDs )
+{
+	for( int i = 0; i < numInstances; ++i ) {
+		Vector2 pos;
+		pos.x = (float)( ( i % 50 ) * 20 );
+		pos.y = (float)( ( i / 50 ) * 20 );
+
+		int id = spine_CreateInstance( templateIdx, pos, 1, 0, NULL );
+		if( id < 0 ) {
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to create instance %i", i );
+			return -1;
+		}
+		outIDs[i] = id;
+
+		spTrackEntry* entry = spAnimationState_setAnimationByName( spine_GetInstanceAnimState( id ), 0, animName, 1 );
+		if( entry == NULL ) {
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to find animation %s", animName );
+			return -1;
+		}
+		entry->time = (float)i * STAGGER_SECONDS;
+	}
+
+	return 0;
+}
+
+/*
+Adds up where all the bones ended up, the crowds are set up the same way so this should match between runs.
+*/
+static double sumBonePositions( const int* ids, int numInstances )
+{
+	double sum = 0.0;
+	for( int i = 0; i < numInstances; ++i ) {
+		spSkeleton* skeleton = spine_GetInstanceSkeleton( ids[i] );
+		for( int b = 0; b < skeleton->bonesCount; ++b ) {
+			sum += (double)skeleton->bones[b]->worldX + (double)skeleton->bones[b]->worldY;
+		}
+	}
+	return sum;
+}
+
+/*
+Creates a crowd, times updating it, then cleans it up.
+ Returns < 0 if there's a problem.
+*/
+static int runCrowd( int templateIdx, const char* animName, int numInstances, int iterations, Timing* outTiming,
+	double* outBoneSum )
+{
+	int* ids = mem_Allocate( sizeof( int ) * numInstances );
+	if( ids == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate instance ids" );
+		return -1;
+	}
+
+	if( createCrowd( templateIdx, animName, numInstances, ids ) < 0 ) {
+		spine_CleanAllInstances( );
+		mem_Release( ids );
+		return -1;
+	}
+
+	double counterToMS = 1000.0 / (double)SDL_GetPerformanceFrequency( );
+	timing_Reset( outTiming );
+
+	for( int i = -WARM_UP_ITERATIONS; i < iterations; ++i ) {
+		Uint64 startCounter = SDL_GetPerformanceCounter( );
+		spine_UpdateInstances( UPDATE_DT );
+		Uint64 elapsed = SDL_GetPerformanceCounter( ) - startCounter;
+
+		if( i >= 0 ) {
+			timing_Add( outTiming, (double)elapsed * counterToMS );
+		}
+	}
+
+	(*outBoneSum) = sumBonePositions( ids, numInstances );
+	spine_CleanAllInstances( );
+	mem_Release( ids );
+	return 0;
+}
+
+int main( int argc, char** argv )
+{
+	int numInstances = DEFAULT_INSTANCES;
+	int iterations = DEFAULT_ITERATIONS;
+
+	if( argc < 3 ) {
+		SDL_Log( "Usage: %s <spine file base> <animation name> [instances] [iterations]", argv[0] );
+		return 1;
+	}
+
+	if( argc >= 4 ) {
+		numInstances = SDL_max( 1, atoi( argv[3] ) );
+	}
+
+	if( argc >= 5 ) {
+		iterations = SDL_max( 1, atoi( argv[4] ) );
+	}
+
+	if( initEverything( ) < 0 ) {
+		return 1;
+	}
+
+	int templateIdx = spine_LoadTemplate( argv[1] );
+	if( templateIdx < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to load spine files %s", argv[1] );
+		return 1;
+	}
+
+	Timing parallelTiming, serialTiming;
+	double parallelSum, serialSum;
+	int numWorkers = jobs_GetNumWorkers( );
+
+	if( runCrowd( templateIdx, argv[2], numInstances, iterations, &parallelTiming, &parallelSum ) < 0 ) {
+		return 1;
+	}
+
+	// run everything on the main thread for comparison
+	jobs_ShutDown( );
+	if( jobs_Init( 0 ) < 0 ) {
+		return 1;
+	}
+
+	if( runCrowd( templateIdx, argv[2], numInstances, iterations, &serialTiming, &serialSum ) < 0 ) {
+		return 1;
+	}
+
+	SDL_Log( "Skeleton: %s  animation: %s  %i instances", argv[1], argv[2], numInstances );
+	SDL_Log( "Iterations: %i", iterations );
+	SDL_Log( "Parallel ms (%i workers + main): avg %.4f  min %.4f  max %.4f", numWorkers,
+		parallelTiming.total / iterations, parallelTiming.min, parallelTiming.max );
+	SDL_Log( "Serial ms:                      avg %.4f  min %.4f  max %.4f",
+		serialTiming.total / iterations, serialTiming.min, serialTiming.max );
+	SDL_Log( "Speed up: %.2fx", serialTiming.total / SDL_max( parallelTiming.total, DBL_MIN ) );
+	SDL_Log( "Results match: %s", ( parallelSum == serialSum ) ? "yes" : "NO" );
+
+	return ( parallelSum == serialSum ) ? 0 : 1;
+}
\ No newline at end of file
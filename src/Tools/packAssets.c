@@ -0,0 +1,245 @@
+/*
+Asset packer, decodes images and parses sprite sheet definitions ahead of time and stores the results in a single
+ file the game can memory map, see assetPack.h for the layout. The names stored are the paths as they're passed in,
+ which should match what the game uses to load them, so run it from the same directory the game runs from.
+
+ Usage: packAssets <output file> <asset files...>
+  .ss files are stored as sprite sheets, anything else is treated as an image
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <SDL_main.h>
+#include <SDL.h>
+
+#include "../Graphics/assetPack.h"
+#include "../Graphics/gfxUtil.h"
+#include "../Graphics/imageSheets.h"
+#include "../System/memory.h"
+
+typedef struct {
+	const char* fileName;
+	char name[ASSET_PACK_NAME_LEN];
+} PackInput;
+
+static int compareInputs( const void* a, const void* b )
+{
+	return strncmp( ( (const PackInput*)a )->name, ( (const PackInput*)b )->name, ASSET_PACK_NAME_LEN );
+}
+
+static int isSpriteSheet( const char* fileName )
+{
+	const char* ext = strrchr( fileName, '.' );
+	return ( ( ext != NULL ) && ( SDL_strcasecmp( ext, ".ss" ) == 0 ) );
+}
+
+/*
+Pads the file out so the next thing written starts on the pack alignment.
+*/
+static int alignFile( SDL_RWops* rwops )
+{
+	static const uint8_t padding[ASSET_PACK_ALIGNMENT] = { 0 };
+	Sint64 pos = SDL_RWtell( rwops );
+	size_t padSize = (size_t)( ( ASSET_PACK_ALIGNMENT - ( pos % ASSET_PACK_ALIGNMENT ) ) % ASSET_PACK_ALIGNMENT );
+	if( ( padSize > 0 ) && ( SDL_RWwrite( rwops, padding, 1, padSize ) != padSize ) ) {
+		return -1;
+	}
+	return 0;
+}
+
+/*
+Writes the decoded pixels out, filling in the image parts of the entry.
+*/
+static int writePixels( SDL_RWops* rwops, const uint8_t* pixels, int width, int height, PackEntry* entry )
+{
+	AlphaInfo alpha;
+	gfxUtil_ClassifyAlpha( pixels, width, height, 4, &alpha );
+
+	entry->width = (uint32_t)width;
+	entry->height = (uint32_t)height;
+	entry->textureFlags = (uint32_t)alpha.flags;
+	entry->opaqueMin = alpha.opaqueMin;
+	entry->opaqueMax = alpha.opaqueMax;
+
+	size_t size = (size_t)width * (size_t)height * 4;
+	if( alignFile( rwops ) < 0 ) {
+		return -1;
+	}
+
+	entry->pixelsOffset = (uint64_t)SDL_RWtell( rwops );
+	if( SDL_RWwrite( rwops, pixels, 1, size ) != size ) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int writeImage( SDL_RWops* rwops, const char* fileName, PackEntry* entry )
+{
+	uint8_t* pixels;
+	int width, height;
+
+	if( gfxUtil_DecodeImageFile( fileName, &pixels, &width, &height ) < 0 ) {
+		return -1;
+	}
+
+	entry->type = PET_IMAGE;
+	int result = writePixels( rwops, pixels, width, height, entry );
+
+	gfxUtil_ReleaseDecodedImage( pixels );
+	return result;
+}
+
+/*
+Writes out the sprite rectangles and the alpha of each sprite.
+*/
+static int writeSprites( SDL_RWops* rwops, const uint8_t* pixels, int width, int height, int numSprites,
+	Vector2* mins, Vector2* maxes, PackEntry* entry )
+{
+	AlphaInfo* alphas = mem_Allocate( sizeof( AlphaInfo ) * numSprites );
+	if( alphas == NULL ) {
+		return -1;
+	}
+
+	for( int i = 0; i < numSprites; ++i ) {
+		gfxUtil_ClassifyAlphaRect( pixels, width, height, 4, (int)mins[i].x, (int)mins[i].y,
+			(int)( maxes[i].x - mins[i].x ), (int)( maxes[i].y - mins[i].y ), &( alphas[i] ) );
+	}
+
+	int result = 0;
+	entry->numSprites = (uint32_t)numSprites;
+	if( alignFile( rwops ) < 0 ) {
+		result = -1;
+	} else {
+		entry->spritesOffset = (uint64_t)SDL_RWtell( rwops );
+		if( ( SDL_RWwrite( rwops, mins, sizeof( Vector2 ), numSprites ) != (size_t)numSprites ) ||
+			( SDL_RWwrite( rwops, maxes, sizeof( Vector2 ), numSprites ) != (size_t)numSprites ) ||
+			( SDL_RWwrite( rwops, alphas, sizeof( AlphaInfo ), numSprites ) != (size_t)numSprites ) ) {
+			result = -1;
+		}
+	}
+
+	mem_Release( alphas );
+	return result;
+}
+
+static int writeSpriteSheet( SDL_RWops* rwops, const char* fileName, PackEntry* entry )
+{
+	char imgFileName[256];
+	Vector2* mins = NULL;
+	Vector2* maxes = NULL;
+	uint8_t* pixels;
+	int width, height;
+
+	int numSprites = img_ReadSpriteSheetFile( fileName, imgFileName, sizeof( imgFileName ), &mins, &maxes );
+	if( numSprites < 0 ) {
+		return -1;
+	}
+
+	int result = -1;
+	if( gfxUtil_DecodeImageFile( imgFileName, &pixels, &width, &height ) >= 0 ) {
+		entry->type = PET_SPRITE_SHEET;
+		if( ( writePixels( rwops, pixels, width, height, entry ) >= 0 ) &&
+			( writeSprites( rwops, pixels, width, height, numSprites, mins, maxes, entry ) >= 0 ) ) {
+			result = 0;
+		}
+		gfxUtil_ReleaseDecodedImage( pixels );
+	}
+
+	mem_Release( mins );
+	mem_Release( maxes );
+	return result;
+}
+
+int main( int argc, char** argv )
+{
+	if( argc < 3 ) {
+		SDL_Log( "Usage: %s <output file> <asset files...>", argv[0] );
+		return 1;
+	}
+
+	SDL_SetMainReady( );
+	mem_Init( 256 * 1024 * 1024 );
+
+	int numInputs = argc - 2;
+	PackInput* inputs = mem_Allocate( sizeof( PackInput ) * numInputs );
+	PackEntry* entries = mem_Allocate( sizeof( PackEntry ) * numInputs );
+	memset( entries, 0, sizeof( PackEntry ) * numInputs );
+
+	for( int i = 0; i < numInputs; ++i ) {
+		inputs[i].fileName = argv[i + 2];
+		if( SDL_strlen( inputs[i].fileName ) >= ASSET_PACK_NAME_LEN ) {
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Asset name too long: %s", inputs[i].fileName );
+			return 1;
+		}
+
+		// the game always uses forward slashes
+		SDL_strlcpy( inputs[i].name, inputs[i].fileName, ASSET_PACK_NAME_LEN );
+		for( char* c = inputs[i].name; *c != 0; ++c ) {
+			if( *c == '\\' ) {
+				*c = '/';
+			}
+		}
+	}
+
+	// the game does a binary search to find the assets
+	qsort( inputs, numInputs, sizeof( PackInput ), compareInputs );
+
+	SDL_RWops* rwops = SDL_RWFromFile( argv[1], "wb" );
+	if( rwops == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to open %s: %s", argv[1], SDL_GetError( ) );
+		return 1;
+	}
+
+	// write a placeholder for the header and entries, they're filled in once we know where everything is
+	PackHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, ASSET_PACK_MAGIC, sizeof( header.magic ) );
+	header.version = ASSET_PACK_VERSION;
+	header.numEntries = (uint32_t)numInputs;
+
+	if( ( SDL_RWwrite( rwops, &header, sizeof( header ), 1 ) != 1 ) ||
+		( SDL_RWwrite( rwops, entries, sizeof( PackEntry ), numInputs ) != (size_t)numInputs ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error writing to %s", argv[1] );
+		SDL_RWclose( rwops );
+		return 1;
+	}
+
+	size_t totalPixels = 0;
+	for( int i = 0; i < numInputs; ++i ) {
+		PackEntry* entry = &( entries[i] );
+		memcpy( entry->name, inputs[i].name, ASSET_PACK_NAME_LEN );
+
+		int result;
+		if( isSpriteSheet( inputs[i].fileName ) ) {
+			result = writeSpriteSheet( rwops, inputs[i].fileName, entry );
+		} else {
+			result = writeImage( rwops, inputs[i].fileName, entry );
+		}
+
+		if( result < 0 ) {
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to pack %s", inputs[i].fileName );
+			SDL_RWclose( rwops );
+			return 1;
+		}
+
+		totalPixels += entry->width * entry->height;
+		SDL_Log( "Packed %s: %ux%u", entry->name, entry->width, entry->height );
+	}
+
+	if( ( SDL_RWseek( rwops, sizeof( header ), RW_SEEK_SET ) < 0 ) ||
+		( SDL_RWwrite( rwops, entries, sizeof( PackEntry ), numInputs ) != (size_t)numInputs ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error writing entries to %s", argv[1] );
+		SDL_RWclose( rwops );
+		return 1;
+	}
+
+	SDL_RWclose( rwops );
+
+	SDL_Log( "Wrote %i assets, %.2f MB of pixels, to %s", numInputs, (double)( totalPixels * 4 ) / ( 1024.0 * 1024.0 ), argv[1] );
+
+	mem_Release( entries );
+	mem_Release( inputs );
+	mem_CleanUp( );
+
+	return 0;
+}
\ No newline at end of file
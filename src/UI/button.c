@@ -9,6 +9,7 @@
 #include "../Graphics/images.h"
 #include "../Math/vector3.h"
 #include "../Graphics/camera.h"
+#include "../Graphics/graphics.h"
 #include "text.h"
 
 #define MAX_BUTTONS 32
@@ -137,8 +138,10 @@ void btn_Process( void )
 
 	/* see if the mouse is positioned over any buttons */
 	SDL_GetMouseState( &mouseX, &mouseY );
-	mousePos.x = (float)mouseX;
-	mousePos.y = (float)mouseY;
+	Vector2 renderMousePos;
+	gfx_WindowToRenderPos( mouseX, mouseY, &renderMousePos );
+	mousePos.x = renderMousePos.x;
+	mousePos.y = renderMousePos.y;
 
 	for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
 		unsigned int camFlags = cam_GetFlags( currCamera );
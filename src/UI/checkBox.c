@@ -7,6 +7,7 @@
 #include "../Math/vector3.h"
 #include "../Math/matrix4.h"
 #include "../Graphics/camera.h"
+#include "../Graphics/graphics.h"
 
 #define MAX_CHECK_BOXES 32
 #define TEXT_LEN 32
@@ -155,8 +156,10 @@ void chkBox_Process( void )
 
 	/* see if the mouse is positioned over any buttons */
 	SDL_GetMouseState( &mouseX, &mouseY );
-	mousePos.x = (float)mouseX;
-	mousePos.y = (float)mouseY;
+	Vector2 renderMousePos;
+	gfx_WindowToRenderPos( mouseX, mouseY, &renderMousePos );
+	mousePos.x = renderMousePos.x;
+	mousePos.y = renderMousePos.y;
 
 	for( int currCamera = cam_StartIteration( ); currCamera != -1; currCamera = cam_GetNextActiveCam( ) ) {
 		unsigned int camFlags = cam_GetFlags( currCamera );
@@ -1,14 +1,15 @@
 #include "text.h"
 
-// TODO: Ability to cache string images
-
 #include <SDL_log.h>
 #include <SDL_rwops.h>
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "../System/memory.h"
-
-#include <stb_rect_pack.h>
+#include "../System/mappedFile.h"
+#include "../System/cacheFile.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #define STBTT_malloc(x,u)	((void)(u),mem_Allocate(x))
@@ -17,20 +18,94 @@
 
 #include "../Utils/stretchyBuffer.h"
 #include "../Graphics/images.h"
+#include "../Graphics/graphics.h"
+#include "../Graphics/glDebugging.h"
+
+typedef enum {
+	GS_UNLOADED, // hasn't been rasterized yet, or was evicted from the atlas
+	GS_LOADED,
+	GS_MISSING // the font doesn't have it
+} GlyphState;
 
 typedef struct {
 	int codepoint;
-	int imageID;
+	int imageID; // -1 if there's nothing to draw
 	float advance;
+	Vector2 center; // of the image, relative to the pen position on the base line
+	int shelf; // the atlas shelf the image is in, -1 if it's not in one
+	GlyphState state;
 } Glyph;
 
-#define MAX_FONTS 32
+// the visible ASCII characters are looked up directly, everything else is searched for
+#define FIRST_DIRECT_GLYPH 0x20
+#define LAST_DIRECT_GLYPH 0x7E
+#define NUM_DIRECT_GLYPHS ( LAST_DIRECT_GLYPH - FIRST_DIRECT_GLYPH + 1 )
+
+// rasterized glyphs are saved in a file in the user's pref directory so later runs don't have to rasterize them again
+//  Layout, everything is little endian:
+//   GlyphCacheHeader
+//   GlyphCacheEntry[numGlyphs], sorted by codepoint
+//   the single channel pixels of each glyph, width * height bytes
+#define GLYPH_CACHE_MAGIC "GLYC"
+#define GLYPH_CACHE_VERSION 1
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint64_t key; // hash of everything that affects the glyphs, the file is ignored if it doesn't match
+	uint32_t numGlyphs;
+	uint32_t reserved;
+} GlyphCacheHeader;
+
+enum {
+	GCF_MISSING = 0x1, // the font doesn't have the glyph
+};
+
 typedef struct {
-	// this will be sorted by the codepoint entry in all the structs, make it easier to search
-	//  could also preprocess strings to just be a list of indices into the buffer
+	int32_t codepoint;
+	uint32_t flags;
+	float advance;
+	int32_t x; // of the bitmap, relative to the pen position on the base line
+	int32_t y;
+	int32_t width; // 0 if there's nothing to draw
+	int32_t height;
+	uint32_t reserved;
+	uint64_t pixelsOffset; // from the start of the file
+} GlyphCacheEntry;
+
+// the glyphs rasterized from a font file, shared by every font loaded from that file that can use them
+#define MAX_TYPEFACES 32
+typedef struct {
+	char* fileName; // NULL if the typeface isn't being used
+	uint8_t* fileData; // stb_truetype reads from this whenever a glyph is rasterized
+	stbtt_fontinfo info;
+	FontType type;
+	float bakeHeight; // the pixel height the glyphs are rasterized at
+	float scale;
+	int refCount;
+
+	Glyph directGlyphs[NUM_DIRECT_GLYPHS];
+	// everything else, sorted by the codepoint so it can be binary searched
 	// will be a stretchy buffer
-	Glyph* glyphsBuffer;
-	int packageID;
+	Glyph* sbGlyphs;
+
+	// glyphs saved by earlier runs
+	uint64_t cacheKey;
+	MappedFile cacheFile;
+	const GlyphCacheEntry* cacheEntries;
+	int numCacheEntries;
+
+	// glyphs rasterized since the cache was loaded, sorted by codepoint, the pixel offsets are into sbNewCachePixels
+	//  these are added to the cache file when the typeface is released
+	// will be stretchy buffers
+	GlyphCacheEntry* sbNewCacheEntries;
+	uint8_t* sbNewCachePixels;
+} Typeface;
+
+#define MAX_FONTS 32
+typedef struct {
+	Typeface* typeface; // NULL if the font isn't being used
+	float drawScale; // how much the glyphs of the typeface are scaled to get to this font's size
 
 	float descent;
 	float lineGap;
@@ -40,247 +115,1065 @@ typedef struct {
 } Font;
 
 static int missingChar = 0x3F; // '?'
+#define REPLACEMENT_CHARACTER 0xFFFD
 
+static Typeface typefaces[MAX_TYPEFACES] = { 0 };
 static Font fonts[MAX_FONTS] = { 0 };
-stbtt_pack_range fontPackRange = { 0 };
+
+// codepoints to rasterize as soon as a font is loaded, everything else is rasterized the first time it's used
+// will be a stretchy buffer
+static int* sbPreloadCodepoints = NULL;
+
+// distance fields are generated at one size and scaled to whatever size the font is, this is the size used and how
+//  many pixels the field extends past the edge of the glyph
+#define SDF_BAKE_HEIGHT 64.0f
+#define SDF_PADDING 6
+#define SDF_ON_EDGE_VALUE 128
+
+// the glyphs of every typeface of a type are rasterized into one alpha texture, it's split into horizontal shelves that
+//  glyphs are added to left to right, when it fills up the shelf that was used least recently is emptied
+#define ATLAS_SIZE 1024
+#define MAX_SHELVES 64
+#define GLYPH_PADDING 1
+#define SHELF_HEIGHT_STEP 4
+
+typedef struct {
+	int y;
+	int height;
+	int usedWidth;
+	unsigned int lastUsedFrame; // textFrame when a glyph in it was last used, 0 if it hasn't been
+} AtlasShelf;
+
+typedef struct {
+	Texture texture;
+	AtlasShelf shelves[MAX_SHELVES];
+	int numShelves;
+	int nextShelfY;
+} GlyphAtlas;
+
+static GlyphAtlas atlases[NUM_FONT_TYPES] = { 0 };
+
+// most text is drawn the same way every frame, so the position of each glyph is worked out once and kept around
+#define MAX_CACHED_LAYOUTS 64
+typedef struct {
+	char* text;
+	uint32_t hash;
+	int fontID;
+	HorizTextAlignment hAlign;
+	VertTextAlignment vAlign;
+
+	// all in one allocation, offsets first, then the image ids, then the text
+	Vector2* offsets; // from the position the string is drawn at
+	int* imageIDs;
+	int numGlyphs;
+	uint64_t shelfMask; // which shelves of the font's atlas the glyphs are in
+	int incomplete; // some glyphs were drawn as the missing character because the atlas was full
+	unsigned int createdFrame;
+
+	unsigned int lastUsed; // 0 if it's not being used
+} TextLayout;
+
+static TextLayout layouts[MAX_CACHED_LAYOUTS];
+static unsigned int layoutUseCounter = 0;
+
+// advanced by txt_BeginFrame( ), shelves used during the current frame are never emptied since strings drawn earlier in
+//  the frame are still waiting to be rendered with the glyphs in them
+static unsigned int textFrame = 1;
+
+// counts glyphs that couldn't be fit into the atlas, layouts made while it changes are only kept for the frame
+static unsigned int numAtlasFailures = 0;
+
+// glyph caches are saved every so often instead of only on shutdown so a crash doesn't lose everything rasterized
+#define GLYPH_CACHE_SAVE_INTERVAL_MS 5000
+static Uint32 lastGlyphCacheSave = 0;
+
+static void saveGlyphCache( Typeface* typeface );
+
+static void initGlyph( Glyph* glyph, int codepoint )
+{
+	glyph->codepoint = codepoint;
+	glyph->imageID = -1;
+	glyph->advance = 0.0f;
+	glyph->center = VEC2_ZERO;
+	glyph->shelf = -1;
+	glyph->state = GS_UNLOADED;
+}
 
 /*
-Sets up the default codepoints to load and clears out any currently loaded fonts.
+Finds the glyph for the codepoint, adding an unloaded one if the typeface doesn't have one yet.
+ Returns NULL if there's a problem. Adding a glyph can move the other glyphs that aren't looked up directly.
 */
-int txt_Init( void )
+static Glyph* findOrAddGlyph( Typeface* typeface, int codepoint )
+{
+	if( ( codepoint >= FIRST_DIRECT_GLYPH ) && ( codepoint <= LAST_DIRECT_GLYPH ) ) {
+		return &( typeface->directGlyphs[codepoint - FIRST_DIRECT_GLYPH] );
+	}
+
+	int count = sb_Count( typeface->sbGlyphs );
+	int low = 0;
+	int high = count;
+	while( low < high ) {
+		int mid = ( low + high ) / 2;
+		if( typeface->sbGlyphs[mid].codepoint < codepoint ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	if( ( low < count ) && ( typeface->sbGlyphs[low].codepoint == codepoint ) ) {
+		return &( typeface->sbGlyphs[low] );
+	}
+
+	sb_Add( typeface->sbGlyphs, 1 );
+	if( sb_Count( typeface->sbGlyphs ) != ( count + 1 ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to add glyph for codepoint %i", codepoint );
+		return NULL;
+	}
+
+	memmove( &( typeface->sbGlyphs[low + 1] ), &( typeface->sbGlyphs[low] ), sizeof( Glyph ) * ( count - low ) );
+	initGlyph( &( typeface->sbGlyphs[low] ), codepoint );
+	return &( typeface->sbGlyphs[low] );
+}
+
+static void releaseLayout( TextLayout* layout )
+{
+	mem_Release( layout->offsets );
+	layout->offsets = NULL;
+	layout->imageIDs = NULL;
+	layout->text = NULL;
+	layout->numGlyphs = 0;
+	layout->shelfMask = 0;
+	layout->lastUsed = 0;
+}
+
+/*
+Throws out all the cached layouts that use the font, or all of them if fontID is negative.
+*/
+static void clearLayouts( int fontID )
+{
+	for( int i = 0; i < MAX_CACHED_LAYOUTS; ++i ) {
+		if( ( layouts[i].lastUsed != 0 ) && ( ( fontID < 0 ) || ( layouts[i].fontID == fontID ) ) ) {
+			releaseLayout( &( layouts[i] ) );
+		}
+	}
+}
+
+static void unloadGlyph( Glyph* glyph )
+{
+	if( glyph->imageID >= 0 ) {
+		img_Clean( glyph->imageID );
+	}
+	initGlyph( glyph, glyph->codepoint );
+}
+
+/*
+Empties the shelf, every glyph in it will have to be rasterized again and every layout using them is thrown out.
+*/
+static void evictShelf( FontType type, int shelfIdx )
+{
+	// the last frame could still be drawing from it
+	gfx_WaitForRenderThread( );
+
+	for( int t = 0; t < MAX_TYPEFACES; ++t ) {
+		Typeface* typeface = &( typefaces[t] );
+		if( ( typeface->fileName == NULL ) || ( typeface->type != type ) ) {
+			continue;
+		}
+
+		for( int i = 0; i < NUM_DIRECT_GLYPHS; ++i ) {
+			if( typeface->directGlyphs[i].shelf == shelfIdx ) {
+				unloadGlyph( &( typeface->directGlyphs[i] ) );
+			}
+		}
+
+		int count = sb_Count( typeface->sbGlyphs );
+		for( int i = 0; i < count; ++i ) {
+			if( typeface->sbGlyphs[i].shelf == shelfIdx ) {
+				unloadGlyph( &( typeface->sbGlyphs[i] ) );
+			}
+		}
+	}
+
+	uint64_t bit = (uint64_t)1 << shelfIdx;
+	for( int i = 0; i < MAX_CACHED_LAYOUTS; ++i ) {
+		TextLayout* layout = &( layouts[i] );
+		if( ( layout->lastUsed != 0 ) && ( layout->shelfMask & bit ) &&
+			( fonts[layout->fontID].typeface->type == type ) ) {
+			releaseLayout( layout );
+		}
+	}
+
+	atlases[type].shelves[shelfIdx].usedWidth = 0;
+}
+
+/*
+Finds space in the atlas for a glyph of the size, padding included. Prefers a shelf close to the height of the glyph,
+ then starting a new shelf, then any shelf it'll fit in, and finally empties the least recently used shelf it'll fit
+ in. Shelves used during the current frame are never emptied.
+ Returns the index of the shelf it goes in, or -1 if there's no room.
+*/
+static int findAtlasSpace( FontType type, int width, int height, int* outX, int* outY )
+{
+	GlyphAtlas* atlas = &( atlases[type] );
+	int shelfIdx = -1;
+
+	// a similar height, so not too much space is wasted
+	for( int i = 0; i < atlas->numShelves; ++i ) {
+		AtlasShelf* shelf = &( atlas->shelves[i] );
+		if( ( shelf->height >= height ) && ( shelf->height <= ( height + ( height / 4 ) + SHELF_HEIGHT_STEP ) ) &&
+			( ( shelf->usedWidth + width ) <= ATLAS_SIZE ) ) {
+			if( ( shelfIdx < 0 ) || ( shelf->height < atlas->shelves[shelfIdx].height ) ) {
+				shelfIdx = i;
+			}
+		}
+	}
+
+	// a new shelf
+	if( shelfIdx < 0 ) {
+		int shelfHeight = ( ( height + SHELF_HEIGHT_STEP - 1 ) / SHELF_HEIGHT_STEP ) * SHELF_HEIGHT_STEP;
+		if( ( atlas->numShelves < MAX_SHELVES ) && ( ( atlas->nextShelfY + shelfHeight ) <= ATLAS_SIZE ) ) {
+			shelfIdx = atlas->numShelves;
+			++atlas->numShelves;
+			atlas->shelves[shelfIdx].y = atlas->nextShelfY;
+			atlas->shelves[shelfIdx].height = shelfHeight;
+			atlas->shelves[shelfIdx].usedWidth = 0;
+			atlas->shelves[shelfIdx].lastUsedFrame = 0;
+			atlas->nextShelfY += shelfHeight;
+		}
+	}
+
+	// anything it'll fit in
+	if( shelfIdx < 0 ) {
+		for( int i = 0; i < atlas->numShelves; ++i ) {
+			AtlasShelf* shelf = &( atlas->shelves[i] );
+			if( ( shelf->height >= height ) && ( ( shelf->usedWidth + width ) <= ATLAS_SIZE ) ) {
+				if( ( shelfIdx < 0 ) || ( shelf->height < atlas->shelves[shelfIdx].height ) ) {
+					shelfIdx = i;
+				}
+			}
+		}
+	}
+
+	// out of room, make some
+	if( shelfIdx < 0 ) {
+		for( int i = 0; i < atlas->numShelves; ++i ) {
+			AtlasShelf* shelf = &( atlas->shelves[i] );
+			if( ( shelf->height >= height ) && ( width <= ATLAS_SIZE ) && ( shelf->lastUsedFrame != textFrame ) ) {
+				if( ( shelfIdx < 0 ) || ( shelf->lastUsedFrame < atlas->shelves[shelfIdx].lastUsedFrame ) ) {
+					shelfIdx = i;
+				}
+			}
+		}
+
+		if( shelfIdx < 0 ) {
+			return -1;
+		}
+		evictShelf( type, shelfIdx );
+	}
+
+	(*outX) = atlas->shelves[shelfIdx].usedWidth;
+	(*outY) = atlas->shelves[shelfIdx].y;
+	atlas->shelves[shelfIdx].usedWidth += width;
+	return shelfIdx;
+}
+
+/*
+Creates the texture all the glyphs of the type are put in, it starts out clear. Distance fields are meant to be
+ interpolated so they're filtered linearly.
+ Returns <0 if there's a problem.
+*/
+static int createAtlas( FontType type )
 {
-	// add the visible ASCII characters
-	for( int c = 0x20; c <= 0x7E; ++c ) {
-		txt_AddCharacterToLoad( c );
+	GlyphAtlas* atlas = &( atlases[type] );
+
+	uint8_t* clear = mem_Allocate( ATLAS_SIZE * ATLAS_SIZE );
+	if( clear == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate memory for glyph atlas" );
+		return -1;
+	}
+	memset( clear, 0, ATLAS_SIZE * ATLAS_SIZE );
+
+	int result = gfxUtil_CreateTextureFromAlphaBitmap( clear, ATLAS_SIZE, ATLAS_SIZE, &( atlas->texture ) );
+	mem_Release( clear );
+	if( result < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to create glyph atlas" );
+		atlas->texture.textureID = 0;
+		return -1;
+	}
+
+	if( type == FONT_SDF ) {
+		GL( glBindTexture( GL_TEXTURE_2D, atlas->texture.textureID ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR ) );
+		GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
+		GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+	}
+
+	atlas->numShelves = 0;
+	atlas->nextShelfY = 0;
+	return 0;
+}
+
+/*
+Finds where the codepoint is, or would go, in the sorted entries.
+*/
+static int findCacheEntry( const GlyphCacheEntry* entries, int count, int codepoint )
+{
+	int low = 0;
+	int high = count;
+	while( low < high ) {
+		int mid = ( low + high ) / 2;
+		if( entries[mid].codepoint < codepoint ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+/*
+Looks for the codepoint in the glyphs saved by earlier runs and the ones rasterized since then.
+ Returns NULL if it isn't there, otherwise the entry with the pixels put into outPixels.
+*/
+static const GlyphCacheEntry* findCachedGlyph( Typeface* typeface, int codepoint, const uint8_t** outPixels )
+{
+	int idx = findCacheEntry( typeface->cacheEntries, typeface->numCacheEntries, codepoint );
+	if( ( idx < typeface->numCacheEntries ) && ( typeface->cacheEntries[idx].codepoint == codepoint ) ) {
+		(*outPixels) = typeface->cacheFile.data + typeface->cacheEntries[idx].pixelsOffset;
+		return &( typeface->cacheEntries[idx] );
+	}
+
+	int numNew = sb_Count( typeface->sbNewCacheEntries );
+	idx = findCacheEntry( typeface->sbNewCacheEntries, numNew, codepoint );
+	if( ( idx < numNew ) && ( typeface->sbNewCacheEntries[idx].codepoint == codepoint ) ) {
+		(*outPixels) = typeface->sbNewCachePixels + typeface->sbNewCacheEntries[idx].pixelsOffset;
+		return &( typeface->sbNewCacheEntries[idx] );
+	}
+
+	return NULL;
+}
+
+/*
+Rasterizes the glyph for the codepoint, as coverage for bitmap typefaces and a distance field for SDF typefaces, and
+ adds it to the glyphs to be saved in the cache.
+ Returns NULL if there's a problem.
+*/
+static const GlyphCacheEntry* rasterizeGlyphBitmap( Typeface* typeface, int codepoint, const uint8_t** outPixels )
+{
+	GlyphCacheEntry entry;
+	memset( &entry, 0, sizeof( entry ) );
+	entry.codepoint = codepoint;
+
+	uint8_t* bitmap = NULL;
+	int glyphIndex = stbtt_FindGlyphIndex( &( typeface->info ), codepoint );
+	if( ( glyphIndex == 0 ) && ( codepoint != missingChar ) ) {
+		entry.flags |= GCF_MISSING;
+	} else {
+		int advance, leftSideBearing;
+		stbtt_GetGlyphHMetrics( &( typeface->info ), glyphIndex, &advance, &leftSideBearing );
+		entry.advance = (float)advance * typeface->scale;
+
+		int width = 0, height = 0, x = 0, y = 0;
+		if( typeface->type == FONT_SDF ) {
+			bitmap = stbtt_GetGlyphSDF( &( typeface->info ), typeface->scale, glyphIndex, SDF_PADDING, SDF_ON_EDGE_VALUE,
+				(float)SDF_ON_EDGE_VALUE / (float)SDF_PADDING, &width, &height, &x, &y );
+		} else {
+			int x1, y1;
+			stbtt_GetGlyphBitmapBox( &( typeface->info ), glyphIndex, typeface->scale, typeface->scale, &x, &y, &x1, &y1 );
+			width = x1 - x;
+			height = y1 - y;
+			if( ( width > 0 ) && ( height > 0 ) ) {
+				bitmap = mem_Allocate( width * height );
+				if( bitmap == NULL ) {
+					SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate bitmap for codepoint %i", codepoint );
+					return NULL;
+				}
+				stbtt_MakeGlyphBitmap( &( typeface->info ), bitmap, width, height, width, typeface->scale, typeface->scale, glyphIndex );
+			}
+		}
+
+		// nothing to draw, like a space
+		if( bitmap != NULL ) {
+			entry.x = x;
+			entry.y = y;
+			entry.width = width;
+			entry.height = height;
+		}
+	}
+
+	size_t pixelsSize = (size_t)entry.width * (size_t)entry.height;
+	entry.pixelsOffset = (uint64_t)sb_Count( typeface->sbNewCachePixels );
+	if( pixelsSize > 0 ) {
+		uint8_t* pixels = sb_Add( typeface->sbNewCachePixels, (int)pixelsSize );
+		memcpy( pixels, bitmap, pixelsSize );
+	}
+
+	if( typeface->type == FONT_SDF ) {
+		stbtt_FreeSDF( bitmap, NULL );
+	} else {
+		mem_Release( bitmap );
+	}
+
+	int count = sb_Count( typeface->sbNewCacheEntries );
+	int idx = findCacheEntry( typeface->sbNewCacheEntries, count, codepoint );
+	sb_Add( typeface->sbNewCacheEntries, 1 );
+	memmove( &( typeface->sbNewCacheEntries[idx + 1] ), &( typeface->sbNewCacheEntries[idx] ), sizeof( GlyphCacheEntry ) * ( count - idx ) );
+	typeface->sbNewCacheEntries[idx] = entry;
+
+	(*outPixels) = typeface->sbNewCachePixels + entry.pixelsOffset;
+	return &( typeface->sbNewCacheEntries[idx] );
+}
+
+/*
+Copies the glyph into the atlas, rasterizing it first if it isn't in the cache. If the typeface doesn't have the glyph
+ it's marked as missing.
+ Returns <0 if there's a problem, the glyph is left unloaded so it'll be tried again.
+*/
+static int rasterizeGlyph( Typeface* typeface, Glyph* glyph )
+{
+	const uint8_t* bitmap;
+	const GlyphCacheEntry* entry = findCachedGlyph( typeface, glyph->codepoint, &bitmap );
+	if( entry == NULL ) {
+		entry = rasterizeGlyphBitmap( typeface, glyph->codepoint, &bitmap );
+		if( entry == NULL ) {
+			return -1;
+		}
+	}
+
+	if( entry->flags & GCF_MISSING ) {
+		glyph->state = GS_MISSING;
+		return 0;
+	}
+
+	glyph->advance = entry->advance;
+
+	int width = entry->width;
+	int height = entry->height;
+	if( ( width <= 0 ) || ( height <= 0 ) ) {
+		// nothing to draw, like a space
+		glyph->state = GS_LOADED;
+		return 0;
+	}
+
+	GlyphAtlas* atlas = &( atlases[typeface->type] );
+	if( ( atlas->texture.textureID == 0 ) && ( createAtlas( typeface->type ) < 0 ) ) {
+		return -1;
+	}
+
+	// the padding is cleared so nothing left over from an evicted glyph ends up next to it
+	int paddedWidth = width + GLYPH_PADDING;
+	int paddedHeight = height + GLYPH_PADDING;
+	int atlasX, atlasY;
+	int shelfIdx = findAtlasSpace( typeface->type, paddedWidth, paddedHeight, &atlasX, &atlasY );
+	if( shelfIdx < 0 ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_APPLICATION, "No room in glyph atlas for codepoint %i", glyph->codepoint );
+		return -1;
+	}
+
+	static const uint8_t clearPadding[ATLAS_SIZE] = { 0 };
+	GL( glBindTexture( GL_TEXTURE_2D, atlas->texture.textureID ) );
+	GL( glPixelStorei( GL_UNPACK_ALIGNMENT, 1 ) );
+	GL( glTexSubImage2D( GL_TEXTURE_2D, 0, atlasX, atlasY, width, height, GL_ALPHA, GL_UNSIGNED_BYTE, bitmap ) );
+	GL( glTexSubImage2D( GL_TEXTURE_2D, 0, atlasX + width, atlasY, GLYPH_PADDING, paddedHeight, GL_ALPHA, GL_UNSIGNED_BYTE, clearPadding ) );
+	GL( glTexSubImage2D( GL_TEXTURE_2D, 0, atlasX, atlasY + height, width, GLYPH_PADDING, GL_ALPHA, GL_UNSIGNED_BYTE, clearPadding ) );
+	GL( glPixelStorei( GL_UNPACK_ALIGNMENT, 4 ) );
+	GL( glBindTexture( GL_TEXTURE_2D, 0 ) );
+
+	AlphaInfo alpha;
+	gfxUtil_ClassifyAlpha( bitmap, width, height, 1, &alpha );
+
+	Vector2 min = { (float)atlasX, (float)atlasY };
+	Vector2 max = { (float)( atlasX + width ), (float)( atlasY + height ) };
+	glyph->imageID = img_CreateFromTextureRect( &( atlas->texture ), min, max, &alpha,
+		( typeface->type == FONT_SDF ) ? ST_SDF : ST_ALPHA_ONLY );
+	if( glyph->imageID < 0 ) {
+		return -1;
+	}
+
+	glyph->center.x = (float)entry->x + ( (float)width / 2.0f );
+	glyph->center.y = (float)entry->y + ( (float)height / 2.0f );
+	glyph->shelf = shelfIdx;
+	glyph->state = GS_LOADED;
+	return 0;
+}
+
+/*
+Gets the glyph to draw for the codepoint from the typeface, rasterizing it if it hasn't been yet. If the typeface
+ doesn't have it, or there's no room left in the atlas for it this frame, then the glyph for the missing character
+ is used.
+ Returns NULL if there's a problem. The glyph is only valid until the next glyph is looked up.
+*/
+static Glyph* getTypefaceGlyph( Typeface* typeface, int codepoint )
+{
+	Glyph* glyph = findOrAddGlyph( typeface, codepoint );
+	if( glyph == NULL ) {
+		return NULL;
+	}
+
+	if( ( glyph->state == GS_UNLOADED ) && ( rasterizeGlyph( typeface, glyph ) < 0 ) ) {
+		++numAtlasFailures;
+		if( codepoint != missingChar ) {
+			return getTypefaceGlyph( typeface, missingChar );
+		}
+	}
+
+	if( glyph->state == GS_MISSING ) {
+		return getTypefaceGlyph( typeface, missingChar );
+	}
+
+	if( glyph->shelf >= 0 ) {
+		atlases[typeface->type].shelves[glyph->shelf].lastUsedFrame = textFrame;
 	}
 
+	return glyph;
+}
+
+static Glyph* getCodepointGlyph( int fontID, int codepoint )
+{
+	return getTypefaceGlyph( fonts[fontID].typeface, codepoint );
+}
+
+/*
+Clears out any currently loaded fonts and cached layouts.
+*/
+int txt_Init( void )
+{
 	for( int i = 0; i < MAX_FONTS; ++i ) {
-		if( fonts[i].glyphsBuffer != NULL ) {
-			sb_Release( fonts[i].glyphsBuffer );
+		if( fonts[i].typeface != NULL ) {
+			txt_UnloadFont( i );
 		}
-		fonts[i].glyphsBuffer = NULL;
 	}
 
+	clearLayouts( -1 );
+
 	return 0;
 }
 
 /*
-Adds a codepoint to the set of codepoints to get glyphs for when loading a font. This does
- not currently cause any currently loaded fonts to be reloaded, so they will not be able to
- display this codepoint if it had not previously been added.
+Starts a new frame of text, call it whenever the draw instructions are cleared. Glyphs used since the last call can
+ be pushed out of the atlas after this. Every few seconds any newly rasterized glyphs are saved to the caches.
+*/
+void txt_BeginFrame( void )
+{
+	++textFrame;
+	if( textFrame == 0 ) {
+		// wrapped around, the order doesn't matter that much so just start everything over
+		for( int t = 0; t < NUM_FONT_TYPES; ++t ) {
+			for( int i = 0; i < atlases[t].numShelves; ++i ) {
+				atlases[t].shelves[i].lastUsedFrame = 0;
+			}
+		}
+		textFrame = 1;
+	}
+
+	Uint32 now = SDL_GetTicks( );
+	if( ( now - lastGlyphCacheSave ) >= GLYPH_CACHE_SAVE_INTERVAL_MS ) {
+		lastGlyphCacheSave = now;
+		for( int i = 0; i < MAX_TYPEFACES; ++i ) {
+			if( typefaces[i].fileName != NULL ) {
+				saveGlyphCache( &( typefaces[i] ) );
+			}
+		}
+	}
+}
+
+/*
+Unloads all the fonts, saving any glyphs that were rasterized so they won't need to be next time.
+*/
+void txt_ShutDown( void )
+{
+	for( int i = 0; i < MAX_FONTS; ++i ) {
+		if( fonts[i].typeface != NULL ) {
+			txt_UnloadFont( i );
+		}
+	}
+
+	clearLayouts( -1 );
+}
+
+/*
+Adds a codepoint to the set of codepoints to rasterize as soon as a font is loaded, and rasterizes it for the fonts
+ that are already loaded. Anything not added is rasterized the first time it's drawn, so this is only needed to
+ avoid doing that in the middle of the game.
 */
 void txt_AddCharacterToLoad( int c )
 {
 	// check to see if the character already exists
-	int cnt = sb_Count( fontPackRange.array_of_unicode_codepoints );
+	int cnt = sb_Count( sbPreloadCodepoints );
 	for( int i = 0; i < cnt; ++i ) {
-		if( fontPackRange.array_of_unicode_codepoints[i] == c ) {
+		if( sbPreloadCodepoints[i] == c ) {
 			return;
 		}
 	}
 
-	sb_Push( fontPackRange.array_of_unicode_codepoints, c );
-	fontPackRange.num_chars = sb_Count( fontPackRange.array_of_unicode_codepoints );
+	sb_Push( sbPreloadCodepoints, c );
+
+	for( int i = 0; i < MAX_TYPEFACES; ++i ) {
+		if( typefaces[i].fileName != NULL ) {
+			getTypefaceGlyph( &( typefaces[i] ), c );
+		}
+	}
 }
 
 /*
-Loads the font at fileName, with a height of pixelHeight.
- Returns an ID to be used when displaying a string, returns -1 if there was an issue.
+Reads the entire file into memory.
+ Returns NULL if there's a problem.
 */
-int txt_LoadFont( const char* fileName, float pixelHeight )
+static uint8_t* readFontFile( const char* fileName, size_t* outSize )
 {
-	uint8_t* buffer = NULL;
-	unsigned char* bmpBuffer = NULL;
-	stbtt_fontinfo font;
-	int newFont = 0;
-	Vector2* mins = NULL;
-	Vector2* maxes = NULL;
-	int* retIDs;
-	Glyph* glyphStorage = NULL; // temporary storage, used to reduce memory fragmentation
-
-	// find an unused font ID
-	while( fonts[newFont].glyphsBuffer != NULL ) {
-		++newFont;
+	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "rb" );
+	if( rwopsFile == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error opening font file %s", fileName );
+		return NULL;
 	}
-	if( newFont >= MAX_FONTS ) {
-		newFont = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to find empty font to use for %s", fileName );
+
+	uint8_t* data = NULL;
+	Sint64 size = SDL_RWsize( rwopsFile );
+	if( size <= 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to get size of font file %s", fileName );
 		goto clean_up;
 	}
 
-	sb_Add( glyphStorage, fontPackRange.num_chars );
-	if( glyphStorage == NULL ) {
-		newFont = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate glyphs for %s", fileName );
+	data = mem_Allocate( (size_t)size );
+	if( data == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error allocating font data buffer for %s", fileName );
 		goto clean_up;
 	}
 
-	// create storage for all the characters
-	fontPackRange.chardata_for_range = mem_Allocate( sizeof( stbtt_packedchar ) * fontPackRange.num_chars );
-	fontPackRange.font_size = pixelHeight;
-	if( fontPackRange.chardata_for_range == NULL ) {
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error allocating range data for %s", fileName );
-		newFont = -1;
-		goto clean_up;
+	if( SDL_RWread( rwopsFile, data, 1, (size_t)size ) != (size_t)size ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error reading font file %s", fileName );
+		mem_Release( data );
+		data = NULL;
+	} else {
+		(*outSize) = (size_t)size;
 	}
-	
-	// now load the file
-	//  some temporary memory for loading the file
-	size_t bufferSize = 1024 * 1024;
-	buffer = mem_Allocate( bufferSize * sizeof( uint8_t ) ); // megabyte sized buffer, should never load a file larger than this
-	if( buffer == NULL ) {
-		SDL_LogWarn( SDL_LOG_CATEGORY_APPLICATION, "Error allocating font data buffer for %s", fileName );
-		newFont = -1;
-		goto clean_up;
+
+clean_up:
+	SDL_RWclose( rwopsFile );
+	return data;
+}
+
+/*
+Hashes everything that changes what the glyphs of the typeface look like.
+*/
+static uint64_t glyphCacheKey( const uint8_t* fileData, size_t fileSize, FontType type, float bakeHeight )
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for( size_t i = 0; i < fileSize; ++i ) {
+		hash ^= fileData[i];
+		hash *= 1099511628211ull;
 	}
 
-	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "r" );
-	if( rwopsFile == NULL ) {
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Error opening font file %s", fileName );
-		newFont = -1;
-		goto clean_up;
+	int32_t settings[4];
+	settings[0] = (int32_t)type;
+	memcpy( &( settings[1] ), &bakeHeight, sizeof( float ) );
+	settings[2] = SDF_PADDING;
+	settings[3] = SDF_ON_EDGE_VALUE;
+	const uint8_t* settingsBytes = (const uint8_t*)settings;
+	for( size_t i = 0; i < sizeof( settings ); ++i ) {
+		hash ^= settingsBytes[i];
+		hash *= 1099511628211ull;
 	}
 
-	size_t numRead = SDL_RWread( rwopsFile, (void*)buffer, sizeof( uint8_t ), bufferSize );
-	if( numRead >= bufferSize ) {
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Too much data read in from file %s", fileName );
-		newFont = -1;
-		goto clean_up;
+	return hash;
+}
+
+static int getGlyphCacheFileName( Typeface* typeface, char* outName, size_t nameSize )
+{
+	char extension[32];
+	SDL_snprintf( extension, sizeof( extension ), ".%s%i.glyphs", ( typeface->type == FONT_SDF ) ? "sdf" : "bmp",
+		(int)typeface->bakeHeight );
+	return cacheFile_GetName( typeface->fileName, extension, outName, nameSize );
+}
+
+/*
+Maps the glyphs saved by an earlier run, if there's no cache or it was made from something different it's ignored.
+*/
+static void loadGlyphCache( Typeface* typeface )
+{
+	char cacheFileName[512];
+	typeface->cacheEntries = NULL;
+	typeface->numCacheEntries = 0;
+	if( ( getGlyphCacheFileName( typeface, cacheFileName, sizeof( cacheFileName ) ) < 0 ) ||
+		( mappedFile_Open( cacheFileName, &( typeface->cacheFile ) ) < 0 ) ) {
+		return;
 	}
 
-	// get some of the basic font stuff, need to do this so we can handle multiple lines of text
-	int ascent, descent, lineGap;
-	float scale;
-	stbtt_InitFont( &font, buffer, 0 );
-	stbtt_GetFontVMetrics( &font, &ascent, &descent, &lineGap );
-	scale = stbtt_ScaleForPixelHeight( &font, pixelHeight );
-	fonts[newFont].ascent = (float)ascent * scale;
-	fonts[newFont].descent = (float)descent * scale;
-	fonts[newFont].lineGap = (float)lineGap * scale;
-	fonts[newFont].nextLineDescent = fonts[newFont].ascent - fonts[newFont].descent + fonts[newFont].lineGap;
-	
-	// pack and create the 1 channel bitmap
-	// TODO: Better estimates of the width and height (find largest glyph we'll use and calculate using that?)
-	// TODO: clip the height to what we actually use
-	stbtt_pack_context packContext;
-	int bmpWidth = 1024;
-	int bmpHeight = 1024;
-	bmpBuffer = mem_Allocate( sizeof( unsigned char ) * bmpWidth * bmpHeight ); // the 4 allows room for expansion
-	if( bmpBuffer == NULL ) {
-		newFont = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate bitmap memory for %s", fileName );
-		goto clean_up;
+	const uint8_t* data = typeface->cacheFile.data;
+	size_t size = typeface->cacheFile.size;
+	const GlyphCacheHeader* header = (const GlyphCacheHeader*)data;
+	if( ( size < sizeof( GlyphCacheHeader ) ) ||
+		( memcmp( header->magic, GLYPH_CACHE_MAGIC, sizeof( header->magic ) ) != 0 ) ||
+		( header->version != GLYPH_CACHE_VERSION ) || ( header->key != typeface->cacheKey ) ||
+		( ( ( size - sizeof( GlyphCacheHeader ) ) / sizeof( GlyphCacheEntry ) ) < header->numGlyphs ) ) {
+		SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "Glyph cache %s is out of date, glyphs will be rasterized again", cacheFileName );
+		mappedFile_Close( &( typeface->cacheFile ) );
+		return;
 	}
-	// TODO: Test oversampling
-	if( !stbtt_PackBegin( &packContext, bmpBuffer, bmpWidth, bmpHeight, 0, 1, NULL ) ) {
-		newFont = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to begin packing ranges for %s", fileName );
-		goto clean_up;
+
+	const GlyphCacheEntry* entries = (const GlyphCacheEntry*)( header + 1 );
+	for( uint32_t i = 0; i < header->numGlyphs; ++i ) {
+		const GlyphCacheEntry* entry = &( entries[i] );
+		if( ( ( i > 0 ) && ( entry->codepoint <= entries[i - 1].codepoint ) ) ||
+			( entry->width < 0 ) || ( entry->width > ATLAS_SIZE ) || ( entry->height < 0 ) || ( entry->height > ATLAS_SIZE ) ||
+			( entry->pixelsOffset > size ) || ( ( (uint64_t)entry->width * (uint64_t)entry->height ) > ( size - entry->pixelsOffset ) ) ) {
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Glyph cache %s is corrupt, glyphs will be rasterized again", cacheFileName );
+			mappedFile_Close( &( typeface->cacheFile ) );
+			return;
+		}
 	}
-	int wasPacked = stbtt_PackFontRanges( &packContext, (unsigned char*)buffer, 0, &fontPackRange, 1 );
-	stbtt_PackEnd( &packContext );
-	if( !wasPacked ) {
-		newFont = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to pack ranges for %s", fileName );
-		goto clean_up;
+
+	typeface->cacheEntries = entries;
+	typeface->numCacheEntries = (int)header->numGlyphs;
+}
+
+/*
+Writes the glyphs out to the file, merging the ones from the loaded cache with the ones rasterized since then.
+ Returns <0 if there's a problem.
+*/
+static int writeGlyphCache( Typeface* typeface, const char* fileName )
+{
+	SDL_RWops* rwops = SDL_RWFromFile( fileName, "wb" );
+	if( rwops == NULL ) {
+		return -1;
 	}
 
-	// create all the glyphs for displaying
-	mins = mem_Allocate( sizeof( Vector2 ) * fontPackRange.num_chars );
-	maxes = mem_Allocate( sizeof( Vector2 ) * fontPackRange.num_chars );
-	retIDs = mem_Allocate( sizeof( int ) * fontPackRange.num_chars );
-	if( ( mins == NULL ) || ( maxes == NULL ) || ( retIDs == NULL ) ) {
-		newFont = -1;
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate image data for %s", fileName );
+	int numNew = sb_Count( typeface->sbNewCacheEntries );
+	int numGlyphs = typeface->numCacheEntries + numNew;
+	GlyphCacheEntry* entries = mem_Allocate( sizeof( GlyphCacheEntry ) * numGlyphs );
+	const uint8_t** sources = mem_Allocate( sizeof( const uint8_t* ) * numGlyphs );
+	int result = -1;
+	if( ( entries == NULL ) || ( sources == NULL ) ) {
 		goto clean_up;
 	}
 
-	// extract all the rectangles so we can split the image correctly
-	for( int i = 0; i < fontPackRange.num_chars; ++i ) {
-		mins[i].x = fontPackRange.chardata_for_range[i].x0;
-		mins[i].y = fontPackRange.chardata_for_range[i].y0;
-		maxes[i].x = fontPackRange.chardata_for_range[i].x1;
-		maxes[i].y = fontPackRange.chardata_for_range[i].y1;
+	// both lists are sorted and don't share any codepoints, so they can just be merged, the pixels follow the entries
+	uint64_t pixelsOffset = sizeof( GlyphCacheHeader ) + ( sizeof( GlyphCacheEntry ) * numGlyphs );
+	int oldIdx = 0;
+	int newIdx = 0;
+	for( int i = 0; i < numGlyphs; ++i ) {
+		if( ( newIdx >= numNew ) || ( ( oldIdx < typeface->numCacheEntries ) &&
+			( typeface->cacheEntries[oldIdx].codepoint < typeface->sbNewCacheEntries[newIdx].codepoint ) ) ) {
+			entries[i] = typeface->cacheEntries[oldIdx];
+			sources[i] = typeface->cacheFile.data + entries[i].pixelsOffset;
+			++oldIdx;
+		} else {
+			entries[i] = typeface->sbNewCacheEntries[newIdx];
+			sources[i] = typeface->sbNewCachePixels + entries[i].pixelsOffset;
+			++newIdx;
+		}
+
+		entries[i].pixelsOffset = pixelsOffset;
+		pixelsOffset += (uint64_t)entries[i].width * (uint64_t)entries[i].height;
 	}
 
-	// create the images for the glyphs and record everything
-	//  clamp to either on or off
-	fonts[newFont].packageID = img_SplitAlphaBitmap( bmpBuffer, bmpWidth, bmpHeight, fontPackRange.num_chars, ST_ALPHA_ONLY, mins, maxes, retIDs );
-	if( fonts[newFont].packageID < 0 ) {
-		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to split images for font %s", fileName );
-		newFont = -1;
+	GlyphCacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, GLYPH_CACHE_MAGIC, sizeof( header.magic ) );
+	header.version = GLYPH_CACHE_VERSION;
+	header.key = typeface->cacheKey;
+	header.numGlyphs = (uint32_t)numGlyphs;
+
+	if( ( SDL_RWwrite( rwops, &header, sizeof( header ), 1 ) != 1 ) ||
+		( SDL_RWwrite( rwops, entries, sizeof( GlyphCacheEntry ), numGlyphs ) != (size_t)numGlyphs ) ) {
 		goto clean_up;
 	}
 
-	fonts[newFont].glyphsBuffer = glyphStorage;
+	for( int i = 0; i < numGlyphs; ++i ) {
+		size_t pixelsSize = (size_t)entries[i].width * (size_t)entries[i].height;
+		if( ( pixelsSize > 0 ) && ( SDL_RWwrite( rwops, sources[i], 1, pixelsSize ) != pixelsSize ) ) {
+			goto clean_up;
+		}
+	}
 
-	for( int i = 0; i < fontPackRange.num_chars; ++i ) {
-		fonts[newFont].glyphsBuffer[i].codepoint = fontPackRange.array_of_unicode_codepoints[i];
-		fonts[newFont].glyphsBuffer[i].imageID = retIDs[i];
-		fonts[newFont].glyphsBuffer[i].advance = fontPackRange.chardata_for_range[i].xadvance;
+	result = 0;
 
-		// set the offset for each glyph, the x0, y0, x1, and y1 of the quad determines the coordinates of the rectangle to use to render
-		//  the glyph as an offset of it's position, so we just set the offset as the middle point of that rectangle
-		stbtt_aligned_quad quad;
-		float dummyX = 0.0f;
-		float dummyY = 0.0f;
-		Vector2 offset = { 0.0f, 0.0f };
-		stbtt_GetPackedQuad( fontPackRange.chardata_for_range, bmpWidth, bmpHeight, i, &dummyX, &dummyY, &quad, 0 );
+clean_up:
+	mem_Release( entries );
+	mem_Release( sources );
+	if( SDL_RWclose( rwops ) != 0 ) {
+		result = -1;
+	}
+	return result;
+}
 
-		offset.x = ( quad.x0 + quad.x1 ) / 2.0f;
-		offset.y = ( quad.y0 + quad.y1 ) / 2.0f;
-		img_SetOffset( retIDs[i], offset );
+/*
+Saves any glyphs that were rasterized since the cache was mapped, then maps the new file so they're read from there.
+ The new file is written out next to the old one first, the old one can't be replaced while it's mapped. If it can't
+ be saved the new glyphs are kept and it'll be tried again.
+*/
+static void saveGlyphCache( Typeface* typeface )
+{
+	if( sb_Count( typeface->sbNewCacheEntries ) <= 0 ) {
+		return;
 	}
 
-	// TODO: get a way to do this with fewer temporary allocations
-clean_up:
-	mem_Release( buffer );
-	mem_Release( bmpBuffer );
-	mem_Release( fontPackRange.chardata_for_range );
-	mem_Release( mins );
-	mem_Release( maxes );
-	fontPackRange.chardata_for_range = NULL;
-	fontPackRange.font_size = 0.0f;
+	char cacheFileName[512];
+	char tempFileName[520];
+	if( getGlyphCacheFileName( typeface, cacheFileName, sizeof( cacheFileName ) ) < 0 ) {
+		return;
+	}
+	SDL_snprintf( tempFileName, sizeof( tempFileName ), "%s.tmp", cacheFileName );
 
-	if( newFont < 0 ) {
-		// creating font failed, release pre-allocated storage
-		sb_Release( glyphStorage );
+	if( writeGlyphCache( typeface, tempFileName ) < 0 ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_APPLICATION, "Unable to save glyph cache %s", cacheFileName );
+		remove( tempFileName );
+		return;
 	}
 
-	return newFont;
+	mappedFile_Close( &( typeface->cacheFile ) );
+	remove( cacheFileName );
+	if( rename( tempFileName, cacheFileName ) != 0 ) {
+		SDL_LogWarn( SDL_LOG_CATEGORY_APPLICATION, "Unable to replace glyph cache %s", cacheFileName );
+		remove( tempFileName );
+	} else {
+		sb_Release( typeface->sbNewCacheEntries );
+		typeface->sbNewCacheEntries = NULL;
+		sb_Release( typeface->sbNewCachePixels );
+		typeface->sbNewCachePixels = NULL;
+	}
+
+	loadGlyphCache( typeface );
 }
 
-void txt_UnloadFont( int fontID )
+/*
+Saves the glyphs rasterized since the last save and releases everything used for the cache.
+*/
+static void closeGlyphCache( Typeface* typeface )
 {
-	assert( fontID >= 0 );
+	saveGlyphCache( typeface );
+
+	mappedFile_Close( &( typeface->cacheFile ) );
+	typeface->cacheEntries = NULL;
+	typeface->numCacheEntries = 0;
 
-	sb_Release( fonts[fontID].glyphsBuffer );
-	fonts[fontID].glyphsBuffer = NULL;
-	img_CleanPackage( fonts[fontID].packageID );
+	sb_Release( typeface->sbNewCacheEntries );
+	typeface->sbNewCacheEntries = NULL;
+	sb_Release( typeface->sbNewCachePixels );
+	typeface->sbNewCachePixels = NULL;
 }
 
-Glyph* getCodepointGlyph( int fontID, int codepoint )
+/*
+Finds the typeface for the file that can be used for a font of the type and height, loading it if there isn't one.
+ Distance fields can be scaled to any size so there's only ever one SDF typeface per file.
+ Returns NULL if there's a problem.
+*/
+static Typeface* acquireTypeface( const char* fileName, float pixelHeight, FontType type )
 {
-	Glyph* out = NULL;
-	int glyphCount = sb_Count( fonts[fontID].glyphsBuffer );
-	for( int i = 0; i < glyphCount; ++i ) {
-		if( fonts[fontID].glyphsBuffer[i].codepoint == codepoint ) {
-			return &( fonts[fontID].glyphsBuffer[i] );
+	float bakeHeight = ( type == FONT_SDF ) ? SDF_BAKE_HEIGHT : pixelHeight;
+
+	int freeTypeface = -1;
+	for( int i = 0; i < MAX_TYPEFACES; ++i ) {
+		Typeface* typeface = &( typefaces[i] );
+		if( typeface->fileName == NULL ) {
+			if( freeTypeface < 0 ) {
+				freeTypeface = i;
+			}
+		} else if( ( typeface->type == type ) && ( typeface->bakeHeight == bakeHeight ) &&
+			( SDL_strcmp( typeface->fileName, fileName ) == 0 ) ) {
+			++typeface->refCount;
+			return typeface;
 		}
 	}
 
-	return NULL;
+	if( freeTypeface < 0 ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to find empty typeface to use for %s", fileName );
+		return NULL;
+	}
+
+	// stb_truetype doesn't copy anything, so the file has to stay around as long as the typeface does
+	size_t fileSize;
+	uint8_t* fileData = readFontFile( fileName, &fileSize );
+	if( fileData == NULL ) {
+		return NULL;
+	}
+
+	Typeface* typeface = &( typefaces[freeTypeface] );
+	if( !stbtt_InitFont( &( typeface->info ), fileData, stbtt_GetFontOffsetForIndex( fileData, 0 ) ) ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to read font data from %s", fileName );
+		mem_Release( fileData );
+		return NULL;
+	}
+
+	size_t nameSize = SDL_strlen( fileName ) + 1;
+	typeface->fileName = mem_Allocate( nameSize );
+	if( typeface->fileName == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate typeface name for %s", fileName );
+		mem_Release( fileData );
+		return NULL;
+	}
+	SDL_strlcpy( typeface->fileName, fileName, nameSize );
+
+	typeface->fileData = fileData;
+	typeface->type = type;
+	typeface->bakeHeight = bakeHeight;
+	typeface->scale = stbtt_ScaleForPixelHeight( &( typeface->info ), bakeHeight );
+	typeface->refCount = 1;
+
+	typeface->sbNewCacheEntries = NULL;
+	typeface->sbNewCachePixels = NULL;
+	typeface->cacheKey = glyphCacheKey( fileData, fileSize, type, bakeHeight );
+	loadGlyphCache( typeface );
+
+	for( int i = 0; i < NUM_DIRECT_GLYPHS; ++i ) {
+		initGlyph( &( typeface->directGlyphs[i] ), FIRST_DIRECT_GLYPH + i );
+	}
+	typeface->sbGlyphs = NULL;
+
+	int cnt = sb_Count( sbPreloadCodepoints );
+	for( int i = 0; i < cnt; ++i ) {
+		getTypefaceGlyph( typeface, sbPreloadCodepoints[i] );
+	}
+
+	return typeface;
 }
 
 /*
-Gets the code point from a string, will advance the string past the current codepoint to the next.
+Stops the font using the typeface, the typeface is unloaded once nothing is using it.
+*/
+static void releaseTypeface( Typeface* typeface )
+{
+	--typeface->refCount;
+	if( typeface->refCount > 0 ) {
+		return;
+	}
+
+	for( int i = 0; i < NUM_DIRECT_GLYPHS; ++i ) {
+		unloadGlyph( &( typeface->directGlyphs[i] ) );
+	}
+
+	int count = sb_Count( typeface->sbGlyphs );
+	for( int i = 0; i < count; ++i ) {
+		unloadGlyph( &( typeface->sbGlyphs[i] ) );
+	}
+	sb_Release( typeface->sbGlyphs );
+	typeface->sbGlyphs = NULL;
+
+	closeGlyphCache( typeface );
+
+	// the space it used in the atlas is left alone, it'll be reused when the shelves are evicted
+	mem_Release( typeface->fileData );
+	typeface->fileData = NULL;
+	mem_Release( typeface->fileName );
+	typeface->fileName = NULL;
+}
+
+/*
+Loads the font at fileName, with a height of pixelHeight. Bitmap fonts are rasterized at that height, SDF fonts share
+ one set of distance fields for every size loaded from the same file. Only the codepoints added with
+ txt_AddCharacterToLoad( ) are rasterized now, everything else is rasterized when it's first drawn.
+ Returns an ID to be used when displaying a string, returns -1 if there was an issue.
 */
-int getUTF8CodePoint( const uint8_t** strData )
+int txt_LoadFont( const char* fileName, float pixelHeight, FontType type )
 {
-	// TODO: Get this working with actual UTF-8 and not just the ASCII subset
-	//  https://tools.ietf.org/html/rfc3629
-	int c = (**strData);
-	++(*strData);
+	assert( ( type >= 0 ) && ( type < NUM_FONT_TYPES ) );
+
+	// find an unused font ID
+	int newFont = 0;
+	while( ( newFont < MAX_FONTS ) && ( fonts[newFont].typeface != NULL ) ) {
+		++newFont;
+	}
+	if( newFont >= MAX_FONTS ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to find empty font to use for %s", fileName );
+		return -1;
+	}
+
+	Uint64 startCounter = SDL_GetPerformanceCounter( );
+	Typeface* typeface = acquireTypeface( fileName, pixelHeight, type );
+	if( typeface == NULL ) {
+		return -1;
+	}
+	SDL_LogVerbose( SDL_LOG_CATEGORY_APPLICATION, "Loaded font %s in %.2f ms, %i glyphs cached", fileName,
+		(double)( SDL_GetPerformanceCounter( ) - startCounter ) * 1000.0 / (double)SDL_GetPerformanceFrequency( ),
+		typeface->numCacheEntries );
+
+	Font* font = &( fonts[newFont] );
+	font->typeface = typeface;
+	font->drawScale = pixelHeight / typeface->bakeHeight;
+
+	// get some of the basic font stuff, need to do this so we can handle multiple lines of text
+	int ascent, descent, lineGap;
+	float scale = stbtt_ScaleForPixelHeight( &( typeface->info ), pixelHeight );
+	stbtt_GetFontVMetrics( &( typeface->info ), &ascent, &descent, &lineGap );
+	font->ascent = (float)ascent * scale;
+	font->descent = (float)descent * scale;
+	font->lineGap = (float)lineGap * scale;
+	font->nextLineDescent = font->ascent - font->descent + font->lineGap;
+
+	return newFont;
+}
+
+/*
+Frees up the font specified by fontID. Any glyphs rasterized for it are saved in a cache file in the user's pref
+ directory, so loading it again later doesn't have to rasterize them.
+*/
+void txt_UnloadFont( int fontID )
+{
+	assert( fontID >= 0 );
+
+	Font* font = &( fonts[fontID] );
+	if( font->typeface == NULL ) {
+		return;
+	}
+
+	clearLayouts( fontID );
+	releaseTypeface( font->typeface );
+	font->typeface = NULL;
+}
+
+/*
+Gets the code point from a string, will advance the string past the current codepoint to the next. Anything that
+ isn't valid UTF-8 comes back as the replacement character, and it never moves past the terminating 0.
+ https://tools.ietf.org/html/rfc3629
+*/
+static int getUTF8CodePoint( const uint8_t** strData )
+{
+	const uint8_t* str = (*strData);
+	int c = str[0];
+	if( c < 0x80 ) {
+		if( c != 0 ) {
+			++(*strData);
+		}
+		return c;
+	}
+
+	int numContinuations;
+	int minValue;
+	if( ( c & 0xE0 ) == 0xC0 ) {
+		numContinuations = 1;
+		minValue = 0x80;
+		c &= 0x1F;
+	} else if( ( c & 0xF0 ) == 0xE0 ) {
+		numContinuations = 2;
+		minValue = 0x800;
+		c &= 0x0F;
+	} else if( ( c & 0xF8 ) == 0xF0 ) {
+		numContinuations = 3;
+		minValue = 0x10000;
+		c &= 0x07;
+	} else {
+		// a continuation byte without a lead byte, or a lead byte that can't be used
+		++(*strData);
+		return REPLACEMENT_CHARACTER;
+	}
+
+	for( int i = 1; i <= numContinuations; ++i ) {
+		if( ( str[i] & 0xC0 ) != 0x80 ) {
+			// cut short, this also stops at the terminating 0
+			(*strData) += i;
+			return REPLACEMENT_CHARACTER;
+		}
+		c = ( c << 6 ) | ( str[i] & 0x3F );
+	}
+	(*strData) += numContinuations + 1;
+
+	// overlong encodings, surrogates, and anything past the last codepoint aren't allowed
+	if( ( c < minValue ) || ( c > 0x10FFFF ) || ( ( c >= 0xD800 ) && ( c <= 0xDFFF ) ) ) {
+		return REPLACEMENT_CHARACTER;
+	}
+
 	return c;
 }
 
@@ -298,7 +1191,9 @@ float calcStringRenderWidth( const uint8_t* str, int fontID )
 			// end of string/line do nothing
 		} else {
 			Glyph* glyph = getCodepointGlyph( fontID, codepoint );
-			width += glyph->advance;
+			if( glyph != NULL ) {
+				width += glyph->advance * fonts[fontID].drawScale;
+			}
 		}
 	} while( ( codepoint != 0 ) && ( codepoint != 0xA ) );
 
@@ -356,37 +1251,181 @@ void positionStringStartY( const uint8_t* str, int fontID, VertTextAlignment ali
 	}
 }
 
+static uint32_t hashString( const char* str )
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for( ; *str != 0; ++str ) {
+		hash ^= (uint8_t)( *str );
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 /*
-Draws a string on the screen. The base line is determined by pos.
+Works out where each glyph in the string goes relative to the position the string is drawn at.
+ Returns <0 if there's a problem.
 */
-void txt_DisplayString( const char* utf8Str, Vector2 pos, Color clr, HorizTextAlignment hAlign, VertTextAlignment vAlign,
-	int fontID, int camFlags, char depth )
+static int createLayout( const char* utf8Str, uint32_t hash, HorizTextAlignment hAlign, VertTextAlignment vAlign, int fontID,
+	TextLayout* outLayout )
 {
-	assert( utf8Str != NULL );
+	// count the glyphs first so everything can go in one allocation, this also rasterizes any that haven't been yet
+	unsigned int startAtlasFailures = numAtlasFailures;
+	int numGlyphs = 0;
+	const uint8_t* str = (const uint8_t*)utf8Str;
+	int codepoint;
+	while( ( codepoint = getUTF8CodePoint( &str ) ) != 0 ) {
+		if( codepoint != 0xA ) {
+			Glyph* glyph = getCodepointGlyph( fontID, codepoint );
+			if( ( glyph != NULL ) && ( glyph->imageID >= 0 ) ) {
+				++numGlyphs;
+			}
+		}
+	}
+
+	size_t textSize = strlen( utf8Str ) + 1;
+	uint8_t* data = mem_Allocate( ( ( sizeof( Vector2 ) + sizeof( int ) ) * numGlyphs ) + textSize );
+	if( data == NULL ) {
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "Unable to allocate text layout for %s", utf8Str );
+		return -1;
+	}
+
+	outLayout->offsets = (Vector2*)data;
+	outLayout->imageIDs = (int*)( outLayout->offsets + numGlyphs );
+	outLayout->text = (char*)( outLayout->imageIDs + numGlyphs );
+	memcpy( outLayout->text, utf8Str, textSize );
+	outLayout->hash = hash;
+	outLayout->fontID = fontID;
+	outLayout->hAlign = hAlign;
+	outLayout->vAlign = vAlign;
+	outLayout->shelfMask = 0;
 
-	// TODO: Alignment options?
-	// TODO: Handle missing codepoint correctly
 	// TODO: Handle multi-line text better (sometimes letters overlap right now)
-	const uint8_t* str = (uint8_t*)utf8Str;
-	Vector2 currPos = pos;
+	str = (const uint8_t*)utf8Str;
+	Vector2 currPos = VEC2_ZERO;
 	positionStringStartX( str, fontID, hAlign, &currPos );
 	positionStringStartY( str, fontID, vAlign, &currPos );
-	int codepoint = 0;
+	float drawScale = fonts[fontID].drawScale;
+	int glyphIdx = 0;
 	do {
 		codepoint = getUTF8CodePoint( &str );
 		if( codepoint == 0 ) {
 			// end of line do nothing
 		} else if( codepoint == 0xA ) {
 			// new line
-			currPos.x = pos.x;
+			currPos.x = 0.0f;
 			currPos.y += fonts[fontID].nextLineDescent;
 			positionStringStartX( str, fontID, hAlign, &currPos );
 		} else {
 			Glyph* glyph = getCodepointGlyph( fontID, codepoint );
 			if( glyph != NULL ) {
-				img_Draw_c( glyph->imageID, camFlags, currPos, currPos, clr, clr, depth );
-				currPos.x += glyph->advance;
+				// glyphs with nothing to draw still take up space
+				if( ( glyph->imageID >= 0 ) && ( glyphIdx < numGlyphs ) ) {
+					outLayout->imageIDs[glyphIdx] = glyph->imageID;
+					vec2_AddScaled( &currPos, &( glyph->center ), drawScale, &( outLayout->offsets[glyphIdx] ) );
+					outLayout->shelfMask |= (uint64_t)1 << glyph->shelf;
+					++glyphIdx;
+				}
+				currPos.x += glyph->advance * drawScale;
 			}
 		}
 	} while( codepoint != 0 );
+	outLayout->numGlyphs = glyphIdx;
+	outLayout->incomplete = ( numAtlasFailures != startAtlasFailures );
+	outLayout->createdFrame = textFrame;
+
+	return 0;
+}
+
+/*
+Marks the atlas shelves as being used this frame, so they won't be emptied while the layout is waiting to be drawn.
+*/
+static void touchShelves( GlyphAtlas* atlas, uint64_t shelfMask )
+{
+	for( int i = 0; shelfMask != 0; ++i, shelfMask >>= 1 ) {
+		if( shelfMask & 1 ) {
+			atlas->shelves[i].lastUsedFrame = textFrame;
+		}
+	}
+}
+
+/*
+Finds the cached layout for the string, creating it if there isn't one. When the cache is full the least recently
+ used layout is thrown out. Layouts that couldn't fit all their glyphs in the atlas are made again in later frames.
+ Returns NULL if there's a problem.
+*/
+static TextLayout* getLayout( const char* utf8Str, HorizTextAlignment hAlign, VertTextAlignment vAlign, int fontID )
+{
+	uint32_t hash = hashString( utf8Str );
+
+	++layoutUseCounter;
+	if( layoutUseCounter == 0 ) {
+		// wrapped around, the order doesn't matter that much so just start everything over
+		for( int i = 0; i < MAX_CACHED_LAYOUTS; ++i ) {
+			if( layouts[i].lastUsed != 0 ) {
+				layouts[i].lastUsed = 1;
+			}
+		}
+		layoutUseCounter = 2;
+	}
+
+	TextLayout* oldest = &( layouts[0] );
+	for( int i = 0; i < MAX_CACHED_LAYOUTS; ++i ) {
+		TextLayout* layout = &( layouts[i] );
+		if( ( layout->lastUsed != 0 ) && ( layout->hash == hash ) && ( layout->fontID == fontID ) &&
+			( layout->hAlign == hAlign ) && ( layout->vAlign == vAlign ) && ( strcmp( layout->text, utf8Str ) == 0 ) ) {
+			if( layout->incomplete && ( layout->createdFrame != textFrame ) ) {
+				// there may be room for the glyphs that were missing now
+				oldest = layout;
+				break;
+			}
+
+			layout->lastUsed = layoutUseCounter;
+			touchShelves( &( atlases[fonts[fontID].typeface->type] ), layout->shelfMask );
+			return layout;
+		}
+
+		if( layout->lastUsed < oldest->lastUsed ) {
+			oldest = layout;
+		}
+	}
+
+	if( oldest->lastUsed != 0 ) {
+		releaseLayout( oldest );
+	}
+
+	if( createLayout( utf8Str, hash, hAlign, vAlign, fontID, oldest ) < 0 ) {
+		return NULL;
+	}
+	oldest->lastUsed = layoutUseCounter;
+
+	return oldest;
+}
+
+/*
+Draws a string on the screen. The base line is determined by pos. The string is UTF-8, anything the font doesn't have
+ is drawn as a '?'.
+*/
+void txt_DisplayString( const char* utf8Str, Vector2 pos, Color clr, HorizTextAlignment hAlign, VertTextAlignment vAlign,
+	int fontID, int camFlags, char depth )
+{
+	txt_DisplayMovingString( utf8Str, pos, pos, clr, hAlign, vAlign, fontID, camFlags, depth );
+}
+
+/*
+Draws a string on the screen that moves from startPos to endPos over the frame, works like txt_DisplayString( ).
+*/
+void txt_DisplayMovingString( const char* utf8Str, Vector2 startPos, Vector2 endPos, Color clr, HorizTextAlignment hAlign,
+	VertTextAlignment vAlign, int fontID, int camFlags, char depth )
+{
+	assert( utf8Str != NULL );
+
+	// TODO: Alignment options?
+	TextLayout* layout = getLayout( utf8Str, hAlign, vAlign, fontID );
+	if( layout == NULL ) {
+		return;
+	}
+
+	img_DrawGlyphRun( layout->imageIDs, layout->offsets, layout->numGlyphs, (unsigned int)camFlags, startPos, endPos,
+		fonts[fontID].drawScale, clr, depth );
 }
\ No newline at end of file
@@ -17,33 +17,61 @@ typedef enum {
 	VERT_ALIGN_CENTER
 } VertTextAlignment;
 
+// how the glyphs of a font are rasterized
+typedef enum {
+	FONT_BITMAP, // coverage at the exact size of the font, crisp but every size needs its own glyphs
+	FONT_SDF, // signed distance fields that are scaled to the size of the font, one set of glyphs for every size
+	NUM_FONT_TYPES
+} FontType;
+
 /*
-Sets up the default codepoints to load and clears out any currently loaded fonts.
+Clears out any currently loaded fonts and cached layouts.
 */
 int txt_Init( void );
 
 /*
-Adds a codepoint to the set of codepoints to get glyphs for when loading a font. This does
- not currently cause any currently loaded fonts to be reloaded, so they will not be able to
- display this codepoint if it had not previously been added.
+Starts a new frame of text, call it whenever the draw instructions are cleared. Glyphs used since the last call can
+ be pushed out of the atlas after this. Every few seconds any newly rasterized glyphs are saved to the caches.
+*/
+void txt_BeginFrame( void );
+
+/*
+Unloads all the fonts, saving any glyphs that were rasterized so they won't need to be next time.
+*/
+void txt_ShutDown( void );
+
+/*
+Adds a codepoint to the set of codepoints to rasterize as soon as a font is loaded, and rasterizes it for the fonts
+ that are already loaded. Anything not added is rasterized the first time it's drawn, so this is only needed to
+ avoid doing that in the middle of the game.
 */
 void txt_AddCharacterToLoad( int c );
 
 /*
-Loads the font at fileName, with a height of pixelHeight.
+Loads the font at fileName, with a height of pixelHeight. Bitmap fonts are rasterized at that height, SDF fonts share
+ one set of distance fields for every size loaded from the same file. Only the codepoints added with
+ txt_AddCharacterToLoad( ) are rasterized now, everything else is rasterized when it's first drawn.
  Returns an ID to be used when displaying a string, returns -1 if there was an issue.
 */
-int txt_LoadFont( const char* fileName, float pixelHeight );
+int txt_LoadFont( const char* fileName, float pixelHeight, FontType type );
 
 /*
-Frees up the font specified by fontID.
+Frees up the font specified by fontID. Any glyphs rasterized for it are saved in a cache file in the user's pref
+ directory, so loading it again later doesn't have to rasterize them.
 */
 void txt_UnloadFont( int fontID );
 
 /*
-Draws a string on the screen. The base line is determined by pos.
+Draws a string on the screen. The base line is determined by pos. The string is UTF-8, anything the font doesn't have
+ is drawn as a '?'.
 */
 void txt_DisplayString( const char* utf8Str, Vector2 pos, Color clr, HorizTextAlignment hAlign, VertTextAlignment vAlign,
 	int fontID, int camFlags, char depth );
 
+/*
+Draws a string on the screen that moves from startPos to endPos over the frame, works like txt_DisplayString( ).
+*/
+void txt_DisplayMovingString( const char* utf8Str, Vector2 startPos, Vector2 endPos, Color clr, HorizTextAlignment hAlign,
+	VertTextAlignment vAlign, int fontID, int camFlags, char depth );
+
 #endif /* inclusion guard */
\ No newline at end of file
@@ -18,6 +18,7 @@
 #define sb_Push( p, v )	( sb__TestAndGrow( (p), 1 ), (p)[sb__Used(p)++] = (v) )
 #define sb_Pop( p, t )		( --sb__Used(p), ( sb__Used(p) >= 0 ) ? (t)( (p)[sb__Used(p)] ) : ( assert( "Nothing to pop" ), (t)0 ) )
 #define sb_Count( p )	( (p) ? sb__Used( p ) : 0 )
+#define sb_Clear( p )	( (p) ? ( sb__Used( (p) ) = 0, 0 ) : 0 )
 #define sb_Add( p, g )	( sb__TestAndGrow( (p), (g) ), sb__Used( (p) ) += (g), &(p)[sb__Used((p)) - (g)] )
 
 static void* sb__GrowData( void* p, int increment, size_t itemSize )
@@ -12,6 +12,7 @@
 #include "Math/Vector2.h"
 #include "Graphics/camera.h"
 #include "Graphics/graphics.h"
+#include "Graphics/renderCapture.h"
 #include "Math/MathUtil.h"
 #include "sound.h"
 #include "Utils/cfgFile.h"
@@ -24,6 +25,7 @@
 
 #include "System/memory.h"
 #include "System/systems.h"
+#include "System/cacheFile.h"
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
@@ -42,6 +44,9 @@ the second number is how many times per second it will update */
 
 void cleanUp( void )
 {
+	txt_ShutDown( );
+	gfx_ShutDown( );
+	cacheFile_ShutDown( );
 	SDL_DestroyWindow( window );
 	window = NULL;
 
@@ -98,6 +103,7 @@ int initEverything( void )
 	int greenSize;
 	int blueSize;
 	int depthSize;
+	int fixedResolution;
 
 	void* oglCFGFile = cfg_OpenFile( "opengl.cfg" );
 	cfg_GetInt( oglCFGFile, "MAJOR", 3, &majorVersion );
@@ -106,6 +112,7 @@ int initEverything( void )
 	cfg_GetInt( oglCFGFile, "GREEN_SIZE", 8, &greenSize );
 	cfg_GetInt( oglCFGFile, "BLUE_SIZE", 8, &blueSize );
 	cfg_GetInt( oglCFGFile, "DEPTH_SIZE", 16, &depthSize );
+	cfg_GetInt( oglCFGFile, "FIXED_RESOLUTION", 1, &fixedResolution );
 	cfg_CloseFile( oglCFGFile );
 
 	majorVersion = 2;
@@ -123,8 +130,13 @@ int initEverything( void )
 	// want it to be double buffered
     SDL_GL_SetAttribute( SDL_GL_DOUBLEBUFFER, 1 );
 
+	// when rendering at a fixed resolution the window can be any size, everything is scaled to fit it
+	Uint32 windowFlags = SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL;
+	if( fixedResolution ) {
+		windowFlags |= SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI;
+	}
 	window = SDL_CreateWindow( windowName, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-		WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL );
+		WINDOW_WIDTH, WINDOW_HEIGHT, windowFlags );
 	if( window == NULL ) {
 		SDL_LogError( SDL_LOG_CATEGORY_VIDEO, SDL_GetError( ) );
 		return -1;
@@ -135,6 +147,11 @@ int initEverything( void )
 	if( gfx_Init( window ) < 0 ) {
 		return -1;
 	}
+	if( fixedResolution ) {
+		if( gfx_SetRenderResolution( WINDOW_WIDTH, WINDOW_HEIGHT ) < 0 ) {
+			SDL_LogWarn( SDL_LOG_CATEGORY_VIDEO, "Unable to create fixed resolution render target, rendering directly to the window" );
+		}
+	}
 	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "Rendering successfully initialized" );
 
 	/* Load and create sounds and music */
@@ -143,8 +160,10 @@ int initEverything( void )
 	}
 	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "Mixer successfully initialized" );
 
+	int renderWidth, renderHeight;
+	gfx_GetRenderSize( &renderWidth, &renderHeight );
 	cam_Init( );
-	cam_SetProjectionMatrices( window );
+	cam_SetProjectionMatrices( renderWidth, renderHeight );
 	SDL_LogInfo( SDL_LOG_CATEGORY_APPLICATION, "Cameras successfully initialized" );
 
 	loadAllResources( );
@@ -172,6 +191,13 @@ void processEvents( int systemOnly )
 			running = 0;
 		}
 
+		// save everything rendered in the next frame so it can be replayed by the render benchmark
+		if( ( e.type == SDL_KEYDOWN ) && ( e.key.keysym.sym == SDLK_F12 ) ) {
+			char captureFileName[64];
+			SDL_snprintf( captureFileName, sizeof( captureFileName ), "frame_%u.rcap", SDL_GetTicks( ) );
+			renderCapture_Request( captureFileName );
+		}
+
 		if( systemOnly ) {
 			continue;
 		}
@@ -242,6 +268,7 @@ int main( int argc, char** argv )
 			/* set the new render positions */
 			renderDelta = PHYSICS_DELTA * (float)numPhysicsProcesses;
 			gfx_ClearDrawCommands( renderDelta );
+			txt_BeginFrame( );
 			cam_FinalizeStates( renderDelta );
 
 			/* render all the things */
@@ -252,8 +279,6 @@ int main( int argc, char** argv )
 		float dt = (float)tickDelta / 1000.0f;
 		cam_Update( dt );
 		gfx_Render( dt );
-		// flip here so we don't have to store the window anywhere else
-		SDL_GL_SwapWindow( window );
 	}
 
 	return 0;
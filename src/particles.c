@@ -6,8 +6,6 @@
 #include <string.h>
 
 struct Particle {
-	Vector2 currRenderPos;
-	Vector2 futureRenderPos;
 	Vector2 gravity;
 	Vector2 velocity;
 	float lifeTime;
@@ -15,9 +13,6 @@ struct Particle {
 	float fadeStart;
 	Color currColor;
 	Color futureColor;
-	float currScale;
-	float futureScale;
-	int image;
 	char layer;
 	unsigned int camFlags;
 };
@@ -27,6 +22,13 @@ struct Particle {
 int lastParticle;
 static struct Particle particles[MAX_NUM_PARTICLES];
 
+/* what's needed to draw the particles is kept in separate arrays so they can be passed straight to img_DrawBatch */
+static int particleImages[MAX_NUM_PARTICLES];
+static Vector2 particleCurrRenderPos[MAX_NUM_PARTICLES];
+static Vector2 particleFutureRenderPos[MAX_NUM_PARTICLES];
+static float particleCurrScale[MAX_NUM_PARTICLES];
+static float particleFutureScale[MAX_NUM_PARTICLES];
+
 void initParticles( )
 {
 	lastParticle = -1;
@@ -40,14 +42,14 @@ void spawnParticle( Vector2 startPos, Vector2 startVel, Vector2 gravity,
 	}
 
 	++lastParticle;
-	particles[lastParticle].currRenderPos = startPos;
-	particles[lastParticle].futureRenderPos = startPos;
+	particleCurrRenderPos[lastParticle] = startPos;
+	particleFutureRenderPos[lastParticle] = startPos;
 	particles[lastParticle].velocity = startVel;
 	particles[lastParticle].gravity = gravity;
 	particles[lastParticle].lifeTime = lifeTime;
 	particles[lastParticle].fadeStart = MIN( fadeStart, lifeTime );
 	particles[lastParticle].lifeElapsed = 0;
-	particles[lastParticle].image = image;
+	particleImages[lastParticle] = image;
 	particles[lastParticle].layer = layer;
 	particles[lastParticle].camFlags = camFlags;
 
@@ -56,7 +58,7 @@ void spawnParticle( Vector2 startPos, Vector2 startVel, Vector2 gravity,
 	particles[lastParticle].currColor.b = particles[lastParticle].futureColor.b = 1.0f;
 	particles[lastParticle].currColor.a = particles[lastParticle].futureColor.a = 1.0f;
 
-	particles[lastParticle].currScale = particles[lastParticle].futureScale = 1.0f;
+	particleCurrScale[lastParticle] = particleFutureScale[lastParticle] = 1.0f;
 }
 
 void particlesPhysicsTick( float dt )
@@ -70,11 +72,11 @@ void particlesPhysicsTick( float dt )
 
 		fadeAmt = inverseLerp( particles[i].fadeStart, particles[i].lifeTime, particles[i].lifeElapsed );
 		particles[i].futureColor.a = lerp( 1.0f, 0.0f, fadeAmt );
-		particles[i].futureScale = lerp( 1.0f, 0.0f, fadeAmt );
+		particleFutureScale[i] = lerp( 1.0f, 0.0f, fadeAmt );
 
-		particles[i].currRenderPos = particles[i].futureRenderPos;
+		particleCurrRenderPos[i] = particleFutureRenderPos[i];
 		vec2_AddScaled( &particles[i].velocity, &particles[i].gravity, dt, &particles[i].velocity );
-		vec2_AddScaled( &particles[i].futureRenderPos, &particles[i].velocity, dt, &particles[i].futureRenderPos );
+		vec2_AddScaled( &particleFutureRenderPos[i], &particles[i].velocity, dt, &particleFutureRenderPos[i] );
 	}
 
 	/* destroy all the dead particles, we won't worry about preserving order but should do some tests to see
@@ -82,6 +84,11 @@ void particlesPhysicsTick( float dt )
 	for( i = 0; i <= lastParticle; ++i ) {
 		if( particles[i].lifeElapsed >= particles[i].lifeTime ) {
 			particles[i] = particles[lastParticle];
+			particleImages[i] = particleImages[lastParticle];
+			particleCurrRenderPos[i] = particleCurrRenderPos[lastParticle];
+			particleFutureRenderPos[i] = particleFutureRenderPos[lastParticle];
+			particleCurrScale[i] = particleCurrScale[lastParticle];
+			particleFutureScale[i] = particleFutureScale[lastParticle];
 			--lastParticle;
 			--i;
 		}
@@ -90,11 +97,26 @@ void particlesPhysicsTick( float dt )
 
 void particlesDraw( )
 {
+	/* particles next to each other that share the camera and layer are drawn together, usually they'll all
+	    come from the same emitter so this ends up being one batch */
+	int batchStart = 0;
+	for( int i = 1; i <= ( lastParticle + 1 ); ++i ) {
+		if( ( i <= lastParticle ) && ( particles[i].camFlags == particles[batchStart].camFlags ) &&
+			( particles[i].layer == particles[batchStart].layer ) ) {
+			continue;
+		}
+
+		img_DrawBatch_s( &particleImages[batchStart], particles[batchStart].camFlags,
+			&particleCurrRenderPos[batchStart], &particleFutureRenderPos[batchStart],
+			&particleCurrScale[batchStart], &particleFutureScale[batchStart], i - batchStart, particles[batchStart].layer );
+		batchStart = i;
+	}
+
+	if( lastParticle >= 0 ) {
+		memcpy( particleCurrRenderPos, particleFutureRenderPos, sizeof( particleCurrRenderPos[0] ) * ( lastParticle + 1 ) );
+		memcpy( particleCurrScale, particleFutureScale, sizeof( particleCurrScale[0] ) * ( lastParticle + 1 ) );
+	}
 	for( int i = 0; i <= lastParticle; ++i ) {
-		img_Draw_s( particles[i].image, particles[i].camFlags, particles[i].currRenderPos, particles[i].futureRenderPos,
-			particles[i].currScale, particles[i].futureScale, particles[i].layer );
-		particles[i].currRenderPos = particles[i].futureRenderPos;
 		particles[i].currColor = particles[i].futureColor;
-		particles[i].currScale = particles[i].futureScale;
 	}
 }
\ No newline at end of file